@@ -18,6 +18,41 @@ int main(int argc,char *argv[])
     
     //testBldNetworkClient( iTestType, sInterfaceIp );
     //return(0);
+
+    // BldTestApp -bench [nPackets] [sizeData] [interfaceIp]
+    if ( argc >= 2 && strcmp(argv[1], "-bench") == 0 ) {
+        benchBldNetworkClient( argc >= 3 ? atoi(argv[2]) : 0, argc >= 4 ? atoi(argv[3]) : 0,
+                               argc >= 5 ? argv[4] : NULL );
+        return(0);
+    }
+
+    // BldTestApp -bench-producers [nPackets] [sizeData] [maxProducers]
+    if ( argc >= 2 && strcmp(argv[1], "-bench-producers") == 0 ) {
+        benchBldSendPacket( argc >= 3 ? atoi(argv[2]) : 0, argc >= 4 ? atoi(argv[3]) : 0,
+                            argc >= 5 ? atoi(argv[4]) : 0 );
+        return(0);
+    }
+
+    // BldTestApp -bench-header [nIterations]
+    if ( argc >= 2 && strcmp(argv[1], "-bench-header") == 0 ) {
+        benchBldPacketHeader( argc >= 3 ? atoi(argv[2]) : 0 );
+        return(0);
+    }
+
+    // BldTestApp -bench-swap [nElements] [nIterations], checks the byte swap kernels first
+    if ( argc >= 2 && strcmp(argv[1], "-bench-swap") == 0 ) {
+        return benchBldByteSwap( argc >= 3 ? atoi(argv[2]) : 0, argc >= 4 ? atoi(argv[3]) : 0 );
+    }
+
+    // BldTestApp -check-fields: field table parsing, layout and packing
+    if ( argc >= 2 && strcmp(argv[1], "-check-fields") == 0 ) {
+        return checkBldFields();
+    }
+
+    // BldTestApp -check-pvlist: PV list entries and array bounds
+    if ( argc >= 2 && strcmp(argv[1], "-check-pvlist") == 0 ) {
+        return checkBldPvList();
+    }
     
     if(argc>=2) {    
         iocsh(argv[1]);
@@ -1,12 +1,22 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <malloc.h>
+#include <string.h>
+#include <new>
+#include <vector>
 
 #ifdef __rtems__
 #include <rtems.h>
 #endif
 
+#include "epicsAtomic.h"
+#include "epicsEvent.h"
+#include "epicsMutex.h"
+#include "epicsThread.h"
+#include "epicsTime.h"
 #include "bldNetworkClient.h"
+#include "bldByteSwap.h"
+#include "bldPacket.h"
 #include "bldPvClient.h"
 
 extern "C" 
@@ -130,6 +140,528 @@ int testBldAPI_C(char* sInterfaceIp)
     return 0;
 }
 
+/*
+ * Send-path microbenchmark
+ *
+ * Times iPackets back-to-back sendRawData() calls of iSizeData bytes for
+ * each network client mode and reports packets per second. With iBurst > 1
+ * the packets go out iBurst at a time through sendBurst() instead.
+ */
+static double benchSendRate(const char* sTransport, unsigned int uFlags, int iBurst, int iPackets, int iSizeData,
+  char* sInterfaceIp)
+{
+    const unsigned int uAddr = 239<<24 | 255<<16 | 0<<8 | 1; // multicast address
+    const unsigned int uPort = 50000;
+    const unsigned char ucTTL = 1; // keep the benchmark traffic on the local segment
+
+    EpicsBld::BldNetworkClientInterface* pBldNetworkClient = 
+      EpicsBld::BldNetworkClientFactory::createBldTransport(sTransport, uAddr, uPort, iSizeData, 
+      ucTTL, sInterfaceIp, uFlags);
+
+    if ( iBurst < 1 ) iBurst = 1;
+    char* pData = (char*) calloc(iSizeData, iBurst);
+    int iFailed = 0;
+    epicsTimeStamp tsStart, tsEnd;
+    epicsTimeGetCurrent(&tsStart);
+    if ( iBurst == 1 )
+    {
+        for (int iPacket = 0; iPacket < iPackets; iPacket++)
+            iFailed += (pBldNetworkClient->sendRawData(iSizeData, pData) != 0);
+    }
+    else
+    {
+        for (int iPacket = 0; iPacket < iPackets; iPacket += iBurst)
+            iFailed += (pBldNetworkClient->sendBurst(pData, iSizeData, iBurst) != 0);
+    }
+    epicsTimeGetCurrent(&tsEnd);
+
+    free(pData);
+    delete pBldNetworkClient;
+
+    double dfSeconds = epicsTimeDiffInSeconds(&tsEnd, &tsStart);
+    if ( iFailed != 0 )
+        printf( "[Error] benchSendRate() : %d of %d sends failed\n", iFailed, iPackets );
+    return (dfSeconds > 0 ? iPackets / dfSeconds : 0);
+}
+
+int benchBldNetworkClient(int iPackets, int iSizeData, char* sInterfaceIp)
+{
+    if ( iPackets <= 0 )  iPackets = 100000;
+    if ( iSizeData <= 0 ) iSizeData = 256;
+
+    const int iBurst = 16;
+    double dfNull        = benchSendRate("null", 0, 1, iPackets, iSizeData, sInterfaceIp);
+    double dfUnconnected = benchSendRate("udp", 0, 1, iPackets, iSizeData, sInterfaceIp);
+    double dfConnected   = benchSendRate("udp", BLD_NETWORK_CONNECTED, 1, iPackets, iSizeData, sInterfaceIp);
+    double dfBurst       = benchSendRate("udp", BLD_NETWORK_CONNECTED, iBurst, iPackets, iSizeData, sInterfaceIp);
+    double dfUring       = benchSendRate("udp", BLD_NETWORK_CONNECTED | BLD_NETWORK_IO_URING, 1, iPackets,
+      iSizeData, sInterfaceIp);
+    double dfSqPoll      = benchSendRate("udp", BLD_NETWORK_CONNECTED | BLD_NETWORK_IO_URING | BLD_NETWORK_SQPOLL,
+      1, iPackets, iSizeData, sInterfaceIp);
+
+    printf( "%d packets of %d bytes\n", iPackets, iSizeData );
+    printf( "  null:        %10.0f pkts/sec (client overhead only)\n", dfNull );
+    printf( "  unconnected: %10.0f pkts/sec\n", dfUnconnected );
+    printf( "  connected:   %10.0f pkts/sec (%+.1f%%)\n", dfConnected,
+      (dfUnconnected > 0 ? 100.0 * (dfConnected - dfUnconnected) / dfUnconnected : 0) );
+    printf( "  burst of %d: %10.0f pkts/sec (%+.1f%%)\n", iBurst, dfBurst,
+      (dfUnconnected > 0 ? 100.0 * (dfBurst - dfUnconnected) / dfUnconnected : 0) );
+    printf( "  io_uring:    %10.0f pkts/sec (%+.1f%%)\n", dfUring,
+      (dfUnconnected > 0 ? 100.0 * (dfUring - dfUnconnected) / dfUnconnected : 0) );
+    printf( "  sqpoll:      %10.0f pkts/sec (%+.1f%%)\n", dfSqPoll,
+      (dfUnconnected > 0 ? 100.0 * (dfSqPoll - dfUnconnected) / dfUnconnected : 0) );
+    return 0;
+}
+
+/*
+ * bldSendPacket() contention benchmark
+ *
+ * iProducers threads share one BLD client, first on the null transport,
+ * then on connected udp to 239.255.0.1. They send iPackets packets between them, either straight into BldSendPacket() or
+ * serialized by an external mutex as drivers had to before. Reports packets
+ * per second for 1, 2, 4, ... iMaxProducers producers.
+ */
+struct BenchProducer
+{
+    int             iBldClientId;
+    int             iProducer;
+    int             iProducers;
+    int             iPackets;
+    int             iSizeData;
+    epicsMutexId    externalLock;   /// NULL: call BldSendPacket() directly
+    int*            piGo;
+    int             iFailed;
+    epicsEventId    done;
+};
+
+static void benchProducerThread(void* pArg)
+{
+    BenchProducer* pProducer = (BenchProducer*) pArg;
+    char* pData = (char*) calloc(pProducer->iSizeData, 1);
+
+    while ( epicsAtomicGetIntT(pProducer->piGo) == 0 )
+        epicsThreadSleep(0);
+
+    for (int iPacket = 0; iPacket < pProducer->iPackets; iPacket++)
+    {
+        // Interleave the producers' fiducials, so none sees its own as a duplicate
+        epicsTimeStamp ts;
+        ts.secPastEpoch = iPacket;
+        ts.nsec         = (iPacket * pProducer->iProducers + pProducer->iProducer) % FIDUCIAL_INVALID;
+
+        if ( pProducer->externalLock != NULL )
+            epicsMutexMustLock(pProducer->externalLock);
+        pProducer->iFailed += (BldSendPacket(pProducer->iBldClientId, 0, 0, &ts, pData, pProducer->iSizeData) != 0);
+        if ( pProducer->externalLock != NULL )
+            epicsMutexUnlock(pProducer->externalLock);
+    }
+
+    free(pData);
+    epicsEventSignal(pProducer->done);
+}
+
+static double benchPacketRate(int iBldClientId, int iProducers, bool bExternalLock, int iPackets, int iSizeData)
+{
+    BenchProducer* pProducers = new BenchProducer[iProducers];
+    epicsMutexId externalLock = ( bExternalLock ? epicsMutexMustCreate() : NULL );
+    int iGo = 0;
+
+    for (int iProducer = 0; iProducer < iProducers; iProducer++)
+    {
+        BenchProducer& producer = pProducers[iProducer];
+        producer.iBldClientId   = iBldClientId;
+        producer.iProducer      = iProducer;
+        producer.iProducers     = iProducers;
+        producer.iPackets       = iPackets / iProducers;
+        producer.iSizeData      = iSizeData;
+        producer.externalLock   = externalLock;
+        producer.piGo           = &iGo;
+        producer.iFailed        = 0;
+        producer.done           = epicsEventMustCreate(epicsEventEmpty);
+        epicsThreadCreate("bldBenchProducer", epicsThreadPriorityMedium,
+          epicsThreadGetStackSize(epicsThreadStackMedium), benchProducerThread, &producer);
+    }
+
+    epicsTimeStamp tsStart, tsEnd;
+    epicsTimeGetCurrent(&tsStart);
+    epicsAtomicSetIntT(&iGo, 1);
+    int iFailed = 0;
+    for (int iProducer = 0; iProducer < iProducers; iProducer++)
+    {
+        epicsEventMustWait(pProducers[iProducer].done);
+        epicsEventDestroy(pProducers[iProducer].done);
+        iFailed += pProducers[iProducer].iFailed;
+    }
+    epicsTimeGetCurrent(&tsEnd);
+
+    if ( externalLock != NULL )
+        epicsMutexDestroy(externalLock);
+    delete [] pProducers;
+
+    double dfSeconds = epicsTimeDiffInSeconds(&tsEnd, &tsStart);
+    if ( iFailed != 0 )
+        printf( "[Error] benchPacketRate() : %d of %d sends failed\n", iFailed, iPackets );
+    return (dfSeconds > 0 ? (iPackets / iProducers) * iProducers / dfSeconds : 0);
+}
+
+int benchBldSendPacket(int iPackets, int iSizeData, int iMaxProducers)
+{
+    if ( iPackets <= 0 )      iPackets = 1000000;
+    if ( iSizeData <= 0 )     iSizeData = 256;
+    if ( iMaxProducers <= 0 ) iMaxProducers = 8;
+
+    const int iBldClientId = BLD_MAX_CLIENTS - 1; // stay clear of the ids an IOC would use
+    const char* lsTransport[] = { "null", "udp" };
+    for (size_t uTransport = 0; uTransport < sizeof(lsTransport) / sizeof(lsTransport[0]); uTransport++)
+    {
+        BldSetTransport(iBldClientId, lsTransport[uTransport]);
+        BldSetNetworkFlags(iBldClientId, BLD_NETWORK_CONNECTED);
+        if ( BldConfigSend(iBldClientId, "239.255.0.1", 50000, iSizeData, NULL) != 0 ||
+          BldStart(iBldClientId) != 0 )
+        {
+            printf( "[Error] benchBldSendPacket() : failed to start the BLD client\n" );
+            return 1;
+        }
+
+        printf( "%d packets of %d bytes, %s transport\n", iPackets, iSizeData, lsTransport[uTransport] );
+        printf( "  producers  external lock (pkts/sec)  lock-free (pkts/sec)\n" );
+        for (int iProducers = 1; iProducers <= iMaxProducers; iProducers *= 2)
+        {
+            double dfLocked   = benchPacketRate(iBldClientId, iProducers, true, iPackets, iSizeData);
+            double dfLockFree = benchPacketRate(iBldClientId, iProducers, false, iPackets, iSizeData);
+            printf( "  %9d  %24.0f  %20.0f (%+.1f%%)\n", iProducers, dfLocked, dfLockFree,
+              (dfLocked > 0 ? 100.0 * (dfLockFree - dfLocked) / dfLocked : 0) );
+        }
+
+        BldStop(iBldClientId);
+    }
+    return 0;
+}
+
+/*
+ * Packet header microbenchmark
+ *
+ * Times the two ways bldSendData() has built its header: the full
+ * BldPacketHeader constructor, which validates the type and byte swaps
+ * every word, and a copy of a header built once with only the time stamp
+ * and fiducial patched. Reports nanoseconds per header.
+ */
+static double benchHeaderBuild(bool bTemplate, int iIterations)
+{
+    using EpicsBld::BldPacketHeader;
+    const unsigned int uPacketSize = 1024;
+    char* pPacket = (char*) calloc(1, uPacketSize);
+    BldPacketHeader headerTemplate( uPacketSize, 0, 0, 0, 0,
+      BldPacketHeader::PhaseCavity, BldPacketHeader::Id_PhaseCavity );
+
+    volatile unsigned int uSink = 0;
+    epicsTimeStamp tsStart, tsEnd;
+    epicsTimeGetCurrent(&tsStart);
+    for (int iIteration = 0; iIteration < iIterations; iIteration++)
+    {
+        BldPacketHeader* pHeader = (BldPacketHeader*) pPacket;
+        const unsigned int uFiducialId = (unsigned int) iIteration & 0x1FFFF;
+        if ( bTemplate )
+        {
+            memcpy( pHeader, &headerTemplate, sizeof(BldPacketHeader) );
+            pHeader->setTimeStamp( 1000000 + iIteration, iIteration, uFiducialId );
+        }
+        else
+            new ( pHeader ) BldPacketHeader( uPacketSize, 1000000 + iIteration, iIteration, uFiducialId, 0,
+              BldPacketHeader::PhaseCavity, BldPacketHeader::Id_PhaseCavity );
+        // bldSendData() sets the pulse ID on either path
+        pHeader->setPulseId( 0x100000000ULL + iIteration );
+        uSink += pHeader->getPacketSize();
+    }
+    epicsTimeGetCurrent(&tsEnd);
+
+    free(pPacket);
+    double dfSeconds = epicsTimeDiffInSeconds(&tsEnd, &tsStart);
+    return (uSink != 0 && iIterations > 0 ? 1e9 * dfSeconds / iIterations : 0);
+}
+
+int benchBldPacketHeader(int iIterations)
+{
+    if ( iIterations <= 0 ) iIterations = 10000000;
+
+    EpicsBld::BldPacketHeader::Initialize();
+    double dfConstruct = benchHeaderBuild(false, iIterations);
+    double dfTemplate  = benchHeaderBuild(true, iIterations);
+
+    printf( "%d PhaseCavity headers\n", iIterations );
+    printf( "  constructor: %8.1f ns/header\n", dfConstruct );
+    printf( "  template:    %8.1f ns/header (%+.1f%%)\n", dfTemplate,
+      (dfConstruct > 0 ? 100.0 * (dfTemplate - dfConstruct) / dfConstruct : 0) );
+    return 0;
+}
+
+/*
+ * Byte swap kernel test and microbenchmark
+ *
+ * The BldByteSwap kernels swap on any host, so this runs the big-endian
+ * packing path on x86 too. Each kernel is checked against its scalar loop
+ * for every count up to 40 elements and unaligned arrays, then both are
+ * timed on iElements elements and reported in ns per element.
+ */
+typedef void (*TByteSwapFunc)( const void* pSrc, unsigned int uCount, void* pDst );
+
+static int checkByteSwap(const char* sName, TByteSwapFunc fnKernel, TByteSwapFunc fnScalar, unsigned int uSize)
+{
+    const unsigned int uMaxCount = 40;
+    unsigned char lucSrc[uMaxCount * 8 + 16], lucKernel[uMaxCount * 8 + 16], lucScalar[uMaxCount * 8 + 16];
+    for (unsigned int u = 0; u < sizeof(lucSrc); u++)
+        lucSrc[u] = (unsigned char) (u * 7 + 1);
+
+    // The scalar loop itself must reverse the bytes of each element
+    fnScalar(lucSrc, 1, lucScalar);
+    for (unsigned int u = 0; u < uSize; u++)
+    {
+        if ( lucScalar[u] != lucSrc[uSize - 1 - u] )
+        {
+            printf( "[Error] checkByteSwap() : %s scalar loop does not reverse the bytes\n", sName );
+            return 1;
+        }
+    }
+
+    int iErrors = 0;
+    for (unsigned int uOffset = 0; uOffset < 16; uOffset += uSize / 2)
+    {
+        for (unsigned int uCount = 0; uCount <= uMaxCount; uCount++)
+        {
+            memset(lucKernel, 0, sizeof(lucKernel));
+            memset(lucScalar, 0, sizeof(lucScalar));
+            fnKernel(lucSrc + uOffset, uCount, lucKernel + uOffset);
+            fnScalar(lucSrc + uOffset, uCount, lucScalar + uOffset);
+            if ( memcmp(lucKernel, lucScalar, sizeof(lucKernel)) != 0 )
+                iErrors++;
+
+            // In place
+            memcpy(lucKernel, lucSrc, sizeof(lucKernel));
+            fnKernel(lucKernel + uOffset, uCount, lucKernel + uOffset);
+            memcpy(lucScalar, lucSrc, sizeof(lucScalar));
+            fnScalar(lucScalar + uOffset, uCount, lucScalar + uOffset);
+            if ( memcmp(lucKernel, lucScalar, sizeof(lucKernel)) != 0 )
+                iErrors++;
+        }
+    }
+    if ( iErrors != 0 )
+        printf( "[Error] checkByteSwap() : %s kernel differs from the scalar loop in %d cases\n", sName, iErrors );
+    return iErrors;
+}
+
+static double benchByteSwapRate(TByteSwapFunc fnSwap, unsigned int uSize, int iElements, int iIterations)
+{
+    char* pSrc = (char*) calloc(iElements, uSize);
+    char* pDst = (char*) calloc(iElements, uSize);
+    epicsTimeStamp tsStart, tsEnd;
+    epicsTimeGetCurrent(&tsStart);
+    for (int iIteration = 0; iIteration < iIterations; iIteration++)
+        fnSwap(pSrc, iElements, pDst);
+    epicsTimeGetCurrent(&tsEnd);
+
+    volatile char cSink = pDst[iElements * uSize - 1];
+    (void) cSink;
+    free(pSrc);
+    free(pDst);
+    double dfSeconds = epicsTimeDiffInSeconds(&tsEnd, &tsStart);
+    return 1e9 * dfSeconds / ((double) iIterations * iElements);
+}
+
+int benchBldByteSwap(int iElements, int iIterations)
+{
+    if ( iElements <= 0 )   iElements = 1024;
+    if ( iIterations <= 0 ) iIterations = 100000;
+
+    struct
+    {
+        const char*     sName;
+        TByteSwapFunc   fnKernel;
+        TByteSwapFunc   fnScalar;
+        unsigned int    uSize;
+    } lKernels[] =
+    {
+        { "16-bit", EpicsBld::BldByteSwap16, EpicsBld::BldByteSwap16Scalar, 2 },
+        { "32-bit", EpicsBld::BldByteSwap32, EpicsBld::BldByteSwap32Scalar, 4 },
+        { "64-bit", EpicsBld::BldByteSwap64, EpicsBld::BldByteSwap64Scalar, 8 },
+    };
+
+    int iErrors = 0;
+    printf( "%d elements x %d iterations, %s kernels\n", iElements, iIterations, EpicsBld::BldByteSwapKernel() );
+    printf( "          scalar (ns/elem)  kernel (ns/elem)\n" );
+    for (size_t uKernel = 0; uKernel < sizeof(lKernels) / sizeof(lKernels[0]); uKernel++)
+    {
+        iErrors += checkByteSwap(lKernels[uKernel].sName, lKernels[uKernel].fnKernel, lKernels[uKernel].fnScalar,
+          lKernels[uKernel].uSize);
+        double dfScalar = benchByteSwapRate(lKernels[uKernel].fnScalar, lKernels[uKernel].uSize, iElements,
+          iIterations);
+        double dfKernel = benchByteSwapRate(lKernels[uKernel].fnKernel, lKernels[uKernel].uSize, iElements,
+          iIterations);
+        printf( "  %s  %16.3f  %16.3f (%+.1f%%)\n", lKernels[uKernel].sName, dfScalar, dfKernel,
+          (dfScalar > 0 ? 100.0 * (dfKernel - dfScalar) / dfScalar : 0) );
+    }
+    return (iErrors != 0);
+}
+
+/*
+ * Field table check
+ *
+ * Runs BldRegisterFields() on good and malformed field lists, checks the
+ * offsets and payload size it computes, then packs one payload with
+ * packFields() and compares it byte for byte. The expected bytes are
+ * little-endian, or reversed per element when this build swaps on a
+ * little-endian host (-DBLD_BIG_ENDIAN on x86). Uses the last physical id.
+ */
+struct BldFieldWireValue
+{
+    unsigned int        uOffset;
+    unsigned int        uSize;
+    unsigned long long  ullValue;   /// the element's bits
+};
+
+static void putWireValue(unsigned char* pPayload, const BldFieldWireValue& value, bool bWireLE)
+{
+    for (unsigned int uByte = 0; uByte < value.uSize; uByte++)
+        pPayload[value.uOffset + ( bWireLE ? uByte : value.uSize - 1 - uByte )] =
+          (unsigned char) ( value.ullValue >> ( 8 * uByte ) );
+}
+
+int checkBldFields()
+{
+    using EpicsBld::BldPacketHeader;
+    using EpicsBld::BldTypeFields;
+    const unsigned int uPhysicalId = BldPacketHeader::NumberOfBldTypeId - 1;
+    const uint32_t uDataType = 70;
+    int iErrors = 0;
+
+    const char* lsMalformed[] = { "int8[", "int8[0]", "foo@double", "double@bar", "double float[3]x", "" };
+    for (size_t uList = 0; uList < sizeof(lsMalformed) / sizeof(lsMalformed[0]); uList++)
+    {
+        if ( BldRegisterFields(uPhysicalId, uDataType, lsMalformed[uList]) == 0 )
+        {
+            printf( "[Error] checkBldFields() : \"%s\" was accepted\n", lsMalformed[uList] );
+            iErrors++;
+        }
+    }
+
+    // Natural alignment: 1 + 7 pad, 8, 3 x 4, 2, 2 x 1, 4, 1 + 3 tail pad
+    const char* sFields = "int8 double float[3]@double int16@long uint8[2]@uchar uint32@ulong int8";
+    const unsigned int luOffsets[] = { 0, 8, 16, 28, 30, 32, 36 };
+    const unsigned int uFieldCount = sizeof(luOffsets) / sizeof(luOffsets[0]);
+    if ( BldRegisterFields(uPhysicalId, uDataType, sFields) != 0 )
+    {
+        printf( "[Error] checkBldFields() : \"%s\" was rejected\n", sFields );
+        return iErrors + 1;
+    }
+    const BldTypeFields* pTypeFields = BldPacketHeader::getFields(uPhysicalId);
+    if ( pTypeFields == NULL || pTypeFields->uFieldCount != uFieldCount || pTypeFields->uPayloadSize != 40 ||
+      BldPacketHeader::getPayloadSize(uPhysicalId) != 40 )
+    {
+        printf( "[Error] checkBldFields() : \"%s\" registered %u fields, %u payload bytes\n", sFields,
+          pTypeFields != NULL ? pTypeFields->uFieldCount : 0, BldPacketHeader::getPayloadSize(uPhysicalId) );
+        return iErrors + 1;
+    }
+    for (unsigned int uField = 0; uField < uFieldCount; uField++)
+    {
+        if ( pTypeFields->pFields[uField].uOffset != luOffsets[uField] )
+        {
+            printf( "[Error] checkBldFields() : field %u at offset %u, expected %u\n", uField,
+              pTypeFields->pFields[uField].uOffset, luOffsets[uField] );
+            iErrors++;
+        }
+    }
+
+    // PV values as the DBR types read them, short arrays are zero filled
+    const epicsInt8     cValue0         = -5;
+    const double        dValue1         = 1.5;
+    const double        ldValue2[2]     = { 2.5, -1.0 };
+    const epicsInt32    iValue3         = -300;
+    const epicsUInt8    ucValue4        = 200;
+    const epicsUInt32   uValue5         = 0x01020304;
+    const epicsInt8     cValue6         = 7;
+    const void* lpValues[uFieldCount]   = { &cValue0, &dValue1, ldValue2, &iValue3, &ucValue4, &uValue5, &cValue6 };
+    const size_t luSizes[uFieldCount]   = { 1, 8, 16, 4, 1, 4, 1 };
+    const long llCounts[uFieldCount]    = { 1, 1, 2, 1, 1, 1, 1 };
+
+    std::vector<double> vdStage( ( pTypeFields->uStageSize + sizeof(double) - 1 ) / sizeof(double) );
+    for (unsigned int uField = 0; uField < uFieldCount; uField++)
+        memcpy( (char*) &vdStage[0] + pTypeFields->puStageOffset[uField], lpValues[uField], luSizes[uField] );
+
+    double ldPacket[( sizeof(BldPacketHeader) + 64 ) / sizeof(double)];
+    BldPacketHeader* pHeader = new ( ldPacket ) BldPacketHeader( sizeof(ldPacket), 0, 0, 0, 0, uPhysicalId,
+      uDataType );
+    unsigned char* pPayload = (unsigned char*) ( pHeader + 1 );
+    memset( pPayload, 0xAA, 40 );
+    pHeader->packFields( pTypeFields, (const char*) &vdStage[0], llCounts );
+
+    float fValue;
+    unsigned long long ullDouble = 0;
+    unsigned int uFloat0 = 0, uFloat1 = 0;
+    memcpy( &ullDouble, &dValue1, sizeof(dValue1) );
+    fValue = 2.5f;  memcpy( &uFloat0, &fValue, sizeof(fValue) );
+    fValue = -1.0f; memcpy( &uFloat1, &fValue, sizeof(fValue) );
+    const BldFieldWireValue lExpected[] =
+    {
+        { 0,  1, 0xFB },        { 8,  8, ullDouble },   { 16, 4, uFloat0 },     { 20, 4, uFloat1 },
+        { 28, 2, 0xFED4 },      { 30, 1, 0xC8 },        { 32, 4, 0x01020304 },  { 36, 1, 7 },
+    };
+    const uint32_t uOne = BldPacketHeader::setu32LE( 1 );
+    const bool bWireLE = ( *(const unsigned char*) &uOne == 1 );
+    unsigned char lucExpected[40];
+    memset( lucExpected, 0, sizeof(lucExpected) );
+    for (size_t uValue = 0; uValue < sizeof(lExpected) / sizeof(lExpected[0]); uValue++)
+        putWireValue( lucExpected, lExpected[uValue], bWireLE );
+
+    for (unsigned int uByte = 0; uByte < sizeof(lucExpected); uByte++)
+    {
+        if ( pPayload[uByte] != lucExpected[uByte] )
+        {
+            printf( "[Error] checkBldFields() : payload byte %u is 0x%02X, expected 0x%02X\n", uByte,
+              pPayload[uByte], lucExpected[uByte] );
+            iErrors++;
+        }
+    }
+
+    printf( "Field tables (%s wire order in this build): %s\n", bWireLE ? "little-endian" : "swapped",
+      iErrors == 0 ? "OK" : "FAILED" );
+    return (iErrors != 0);
+}
+
+/*
+ * PV list check
+ *
+ * Runs BldCheckPvList() on PhaseCavity, 4 doubles of payload: "NAME[N]"
+ * entries must be well formed and their N doubles must fit the payload.
+ */
+int checkBldPvList()
+{
+    using EpicsBld::BldPacketHeader;
+    const unsigned int uPhysicalId = BldPacketHeader::PhaseCavity;
+    int iErrors = 0;
+
+    const char* lsGood[] = { "A[3]", "A B[3]", "A;B[2],C", "A[4]" };
+    for (size_t uList = 0; uList < sizeof(lsGood) / sizeof(lsGood[0]); uList++)
+    {
+        if ( BldCheckPvList(uPhysicalId, 1024, lsGood[uList]) != 0 )
+        {
+            printf( "[Error] checkBldPvList() : \"%s\" was rejected\n", lsGood[uList] );
+            iErrors++;
+        }
+    }
+
+    const char* lsBad[] = { "A[0]", "[3]", "A[3]x", "A[70000]", "A[", "A[-1]", "A B[4]", "A[5]" };
+    for (size_t uList = 0; uList < sizeof(lsBad) / sizeof(lsBad[0]); uList++)
+    {
+        if ( BldCheckPvList(uPhysicalId, 1024, lsBad[uList]) == 0 )
+        {
+            printf( "[Error] checkBldPvList() : \"%s\" was accepted\n", lsBad[uList] );
+            iErrors++;
+        }
+    }
+
+    printf( "PV lists: %s\n", iErrors == 0 ? "OK" : "FAILED" );
+    return (iErrors != 0);
+}
+
 #include <dbStaticLib.h>
 void linkFunctions()
 {
@@ -2,5 +2,11 @@
 #define MULTICAST_TEST_BLD_H
 
 extern "C" int testBldNetworkClient(int iTestType, char* sInterfaceIp);
+extern "C" int benchBldNetworkClient(int iPackets, int iSizeData, char* sInterfaceIp);
+extern "C" int benchBldSendPacket(int iPackets, int iSizeData, int iMaxProducers);
+extern "C" int benchBldPacketHeader(int iIterations);
+extern "C" int benchBldByteSwap(int iElements, int iIterations);
+extern "C" int checkBldFields();
+extern "C" int checkBldPvList();
 
 #endif
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <epicsAtomic.h>
+#include <epicsThread.h>
+
+#include "bldAsyncSender.h"
+
+/**
+ * class member definitions
+ */
+namespace EpicsBld
+{
+/**
+ * class BldAsyncSender
+ */
+BldAsyncSender::BldAsyncSender( BldNetworkClientInterface* pNetworkClient,
+  unsigned int uRingDepth, unsigned int uSlotSize, EOverflowPolicy eOverflow ) :
+  _pNetworkClient(pNetworkClient), _eOverflow(eOverflow), _uMask(0), _uSlotSize(uSlotSize),
+  _pSlots(NULL), _piSlotLen(NULL), _eventWork(epicsEventMustCreate(epicsEventEmpty)),
+  _eventExit(epicsEventMustCreate(epicsEventEmpty)), _iQuit(0),
+  _uHead(0), _uTail(0), _iSleeping(0)
+{
+    // Round the depth up to a power of 2 so slot indices are a simple mask
+    unsigned int uDepth = 1;
+    while ( uDepth < uRingDepth )
+        uDepth <<= 1;
+    _uMask = uDepth - 1;
+
+    _pSlots     = new char[uDepth * _uSlotSize];
+    _piSlotLen  = new int[uDepth];
+    memset( &_statsProducer, 0, sizeof(_statsProducer) );
+    memset( &_statsConsumer, 0, sizeof(_statsConsumer) );
+
+    epicsThreadMustCreate( "bldSender", epicsThreadPriorityHigh,
+      epicsThreadGetStackSize(epicsThreadStackMedium), _threadFunc, this );
+}
+
+BldAsyncSender::~BldAsyncSender()
+{
+    // The sender thread only honors _iQuit once the ring is empty
+    epicsAtomicSetIntT( &_iQuit, 1 );
+    epicsEventSignal( _eventWork );
+    epicsEventMustWait( _eventExit );
+
+    epicsEventDestroy( _eventWork );
+    epicsEventDestroy( _eventExit );
+    delete [] _pSlots;
+    delete [] _piSlotLen;
+}
+
+int BldAsyncSender::send( int iSizeData, const char* pData )
+{
+    struct iovec iov;
+    iov.iov_base = (caddr_t)(pData);
+    iov.iov_len  = iSizeData;
+    return sendV( &iov, 1 );
+}
+
+int BldAsyncSender::sendV( const struct iovec* pIov, int iIovCount )
+{
+    size_t uSizeData = 0;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+        uSizeData += pIov[iIov].iov_len;
+
+    if ( uSizeData > _uSlotSize )
+    {
+        printf( "BldAsyncSender::send() : packet size %zu exceeds slot size %u\n", uSizeData, _uSlotSize );
+        epicsAtomicSetSizeT( &_statsProducer.uPktsDropped, _statsProducer.uPktsDropped + 1 );
+        return 1;
+    }
+
+    size_t uHead = _uHead;
+    size_t uUsed = uHead - epicsAtomicGetSizeT( &_uTail );
+    if ( uUsed > _uMask )
+    {
+        if ( _eOverflow == SendSync )
+        {
+            // Out of order with respect to the queued packets, but nothing is lost
+            epicsAtomicSetSizeT( &_statsProducer.uSyncSent, _statsProducer.uSyncSent + 1 );
+            return _pNetworkClient->sendRawDataV( pIov, iIovCount );
+        }
+        epicsAtomicSetSizeT( &_statsProducer.uPktsDropped, _statsProducer.uPktsDropped + 1 );
+        return 0;
+    }
+
+    unsigned int uSlot = uHead & _uMask;
+    char* pSlot = _pSlots + uSlot * _uSlotSize;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+    {
+        memcpy( pSlot, pIov[iIov].iov_base, pIov[iIov].iov_len );
+        pSlot += pIov[iIov].iov_len;
+    }
+    _piSlotLen[uSlot] = uSizeData;
+
+    // Publish the slot contents before the new head
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetSizeT( &_uHead, uHead + 1 );
+
+    epicsAtomicSetSizeT( &_statsProducer.uPktsQueued, _statsProducer.uPktsQueued + 1 );
+    if ( uUsed + 1 > _statsProducer.uHighWater )
+        epicsAtomicSetSizeT( &_statsProducer.uHighWater, uUsed + 1 );
+
+    // Only pay for the wakeup when the sender thread is actually idle
+    if ( epicsAtomicCmpAndSwapIntT( &_iSleeping, 1, 0 ) == 1 )
+        epicsEventSignal( _eventWork );
+
+    return 0;
+}
+
+void BldAsyncSender::getStats( BldAsyncStats* pStats ) const
+{
+    if ( pStats == NULL )
+        return;
+    pStats->uPktsQueued  = epicsAtomicGetSizeT( &_statsProducer.uPktsQueued );
+    pStats->uPktsDropped = epicsAtomicGetSizeT( &_statsProducer.uPktsDropped );
+    pStats->uSyncSent    = epicsAtomicGetSizeT( &_statsProducer.uSyncSent );
+    pStats->uHighWater   = epicsAtomicGetSizeT( &_statsProducer.uHighWater );
+    pStats->uPktsSent    = epicsAtomicGetSizeT( &_statsConsumer.uPktsSent );
+    pStats->uSendFailed  = epicsAtomicGetSizeT( &_statsConsumer.uSendFailed );
+}
+
+/*
+ * private functions
+ */
+void BldAsyncSender::_run()
+{
+    for ( ;; )
+    {
+        size_t uTail = _uTail;
+        size_t uHead = epicsAtomicGetSizeT( &_uHead );
+        if ( uTail == uHead )
+        {
+            if ( epicsAtomicGetIntT( &_iQuit ) )
+                break;
+
+            // Announce we're going to sleep, then look again so a packet
+            // published in between is not left waiting for the timeout
+            epicsAtomicSetIntT( &_iSleeping, 1 );
+            if ( epicsAtomicGetSizeT( &_uHead ) == uTail )
+                epicsEventWaitWithTimeout( _eventWork, 0.1 );
+            epicsAtomicSetIntT( &_iSleeping, 0 );
+            continue;
+        }
+
+        // Slot contents were published before the head we just read
+        epicsAtomicReadMemoryBarrier();
+        for ( ; uTail != uHead; uTail++ )
+        {
+            unsigned int uSlot = uTail & _uMask;
+            if ( _pNetworkClient->sendRawData( _piSlotLen[uSlot], _pSlots + uSlot * _uSlotSize ) == 0 )
+                epicsAtomicSetSizeT( &_statsConsumer.uPktsSent, _statsConsumer.uPktsSent + 1 );
+            else
+                epicsAtomicSetSizeT( &_statsConsumer.uSendFailed, _statsConsumer.uSendFailed + 1 );
+
+            // Hand the slot back to the producer
+            epicsAtomicSetSizeT( &_uTail, uTail + 1 );
+        }
+    }
+
+    epicsEventSignal( _eventExit );
+}
+
+/*
+ * private static functions
+ */
+void BldAsyncSender::_threadFunc( void* pArg )
+{
+    static_cast<BldAsyncSender*>(pArg)->_run();
+}
+
+} // namespace EpicsBld
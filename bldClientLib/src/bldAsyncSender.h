@@ -0,0 +1,108 @@
+#ifndef BLD_ASYNC_SENDER_H
+#define BLD_ASYNC_SENDER_H
+
+#include <stddef.h>
+#include <epicsEvent.h>
+
+#include "bldNetworkClient.h"
+
+namespace EpicsBld
+{
+/**
+ * Counters of the asynchronous sender, see BldAsyncSender::getStats()
+ */
+struct BldAsyncStats
+{
+    size_t  uPktsQueued;    /// packets placed in the ring
+    size_t  uPktsSent;      /// packets handed to the network client by the sender thread
+    size_t  uSendFailed;    /// sendRawData() failures in the sender thread
+    size_t  uPktsDropped;   /// packets dropped because the ring was full or the packet too large
+    size_t  uSyncSent;      /// packets sent from the caller's thread because the ring was full
+    size_t  uHighWater;     /// maximum ring occupancy seen by the producer
+};
+
+/**
+ * Asynchronous Bld sender
+ *
+ * Decouples the caller (normally the post-trigger subroutine record) from the
+ * socket. Packets are copied into a preallocated single-producer/single-consumer
+ * ring and a dedicated epicsThread drains the ring into the network client.
+ *
+ * Design Issue:
+ * 1. Exactly one thread may call send() at a time.
+ * 2. The value semantics are disabled.
+ */
+class BldAsyncSender
+{
+public:
+    /// What send() does when the ring is full
+    enum EOverflowPolicy
+    {
+        DropNewest  = 0,    /// discard the packet being sent
+        SendSync    = 1     /// send the packet from the caller's thread
+    };
+
+    /**
+     * Create the ring and start the sender thread
+     *
+     * @param pNetworkClient  network client the sender thread sends to (not owned)
+     * @param uRingDepth      number of ring slots, rounded up to a power of 2
+     * @param uSlotSize       max packet size (in bytes)
+     * @param eOverflow       overflow policy
+     */
+    BldAsyncSender( BldNetworkClientInterface* pNetworkClient, unsigned int uRingDepth,
+      unsigned int uSlotSize, EOverflowPolicy eOverflow );
+
+    /// Drains the ring, then stops the sender thread
+    ~BldAsyncSender();
+
+    /**
+     * Queue a packet for the sender thread. Never blocks.
+     *
+     * @return  0 if the packet was queued, sent or dropped per the overflow policy,
+     *          otherwise non-zero
+     */
+    int send( int iSizeData, const char* pData );
+
+    /// Gathering form of send(), the buffers are copied into one ring slot
+    int sendV( const struct iovec* pIov, int iIovCount );
+
+    void getStats( BldAsyncStats* pStats ) const;
+    unsigned int getRingDepth() const { return _uMask + 1; }
+    EOverflowPolicy getOverflowPolicy() const { return _eOverflow; }
+
+private:
+    BldNetworkClientInterface*  _pNetworkClient;
+    const EOverflowPolicy       _eOverflow;
+    unsigned int                _uMask;
+    unsigned int                _uSlotSize;
+    char*                       _pSlots;
+    int*                        _piSlotLen;
+    epicsEventId                _eventWork;
+    epicsEventId                _eventExit;
+    int                         _iQuit;
+
+    /*
+     * Producer and consumer fields live on separate cache lines
+     */
+    enum { uCacheLine = 64 };
+    char            _pad0[uCacheLine];
+    size_t          _uHead;         /// written by the producer only
+    BldAsyncStats   _statsProducer;
+    char            _pad1[uCacheLine];
+    size_t          _uTail;         /// written by the consumer only
+    int             _iSleeping;     /// consumer is (about to be) waiting on _eventWork
+    BldAsyncStats   _statsConsumer;
+    char            _pad2[uCacheLine];
+
+    void _run();
+    static void _threadFunc( void* pArg );
+
+    ///  Disable value semantics. No definitions (function bodies).
+    BldAsyncSender(const BldAsyncSender&);
+    BldAsyncSender& operator=(const BldAsyncSender&);
+};
+
+} // namespace EpicsBld
+
+#endif
@@ -0,0 +1,211 @@
+#include <string.h>
+#include <stddef.h>
+
+#include "bldByteSwap.h"
+
+// AltiVec only where vec_perm indexes bytes in memory order
+#if defined(__ALTIVEC__) && defined(__BIG_ENDIAN__)
+#include <altivec.h>
+// altivec.h may define these as context sensitive keywords, only __vector is used here
+#undef vector
+#undef pixel
+#undef bool
+#define BLD_SWAP_ALTIVEC
+#endif
+
+// __builtin_shuffle() and vector operations with scalar operands need GCC 4.9 in C++
+#if defined(__GNUC__) && !defined(__clang__) && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define BLD_SWAP_VECTOR
+#endif
+
+namespace EpicsBld
+{
+
+/*
+ * Scalar loops
+ */
+static inline uint16_t swapValue( uint16_t value )
+{
+    return (uint16_t) ( value << 8 | value >> 8 );
+}
+
+static inline uint32_t swapValue( uint32_t value )
+{
+    return value << 24 | ( value & 0xFF00 ) << 8 | ( value >> 8 & 0xFF00 ) | value >> 24;
+}
+
+static inline uint64_t swapValue( uint64_t value )
+{
+    return (uint64_t) swapValue( (uint32_t) value ) << 32 | swapValue( (uint32_t) ( value >> 32 ) );
+}
+
+template <class TValue>
+static void swapScalar( const char* pSrc, unsigned int uCount, char* pDst )
+{
+    for ( unsigned int u = 0; u < uCount; u++ )
+    {
+        TValue value;
+        memcpy( &value, pSrc + u * sizeof(TValue), sizeof(TValue) );
+        value = swapValue( value );
+        memcpy( pDst + u * sizeof(TValue), &value, sizeof(TValue) );
+    }
+}
+
+#ifdef BLD_SWAP_VECTOR
+/*
+ * GCC vector extensions, 16 bytes at a time: the 16-bit lanes are put in
+ * reverse order within each element (pshuflw/pshufhw on SSE2), then the
+ * two bytes of each lane are swapped. memcpy() keeps the loads and stores
+ * unaligned.
+ */
+typedef uint16_t TVecU16 __attribute__ ((vector_size (16)));
+typedef uint32_t TVecU32 __attribute__ ((vector_size (16)));
+typedef uint64_t TVecU64 __attribute__ ((vector_size (16)));
+
+static inline TVecU16 swapLanes( TVecU16 v )
+{
+    return v << 8 | v >> 8;
+}
+
+static inline TVecU16 swapVector( TVecU16 v )
+{
+    return swapLanes( v );
+}
+
+static inline TVecU32 swapVector( TVecU32 v )
+{
+    const TVecU16 vOrder = { 1, 0, 3, 2, 5, 4, 7, 6 };
+    return (TVecU32) swapLanes( __builtin_shuffle( (TVecU16) v, vOrder ) );
+}
+
+static inline TVecU64 swapVector( TVecU64 v )
+{
+    const TVecU16 vOrder = { 3, 2, 1, 0, 7, 6, 5, 4 };
+    return (TVecU64) swapLanes( __builtin_shuffle( (TVecU16) v, vOrder ) );
+}
+
+/// Swaps whole vectors, two per pass, returns the number of elements done
+template <class TVec>
+static unsigned int swapVectors( const char* pSrc, unsigned int uCount, char* pDst, unsigned int uSize )
+{
+    const unsigned int uBytes = ( uCount * uSize ) & ~( sizeof(TVec) - 1 );
+    unsigned int uOffset = 0;
+    for ( ; uOffset + 2 * sizeof(TVec) <= uBytes; uOffset += 2 * sizeof(TVec) )
+    {
+        TVec v1, v2;
+        memcpy( &v1, pSrc + uOffset, sizeof(TVec) );
+        memcpy( &v2, pSrc + uOffset + sizeof(TVec), sizeof(TVec) );
+        v1 = swapVector( v1 );
+        v2 = swapVector( v2 );
+        memcpy( pDst + uOffset, &v1, sizeof(TVec) );
+        memcpy( pDst + uOffset + sizeof(TVec), &v2, sizeof(TVec) );
+    }
+    if ( uOffset < uBytes )
+    {
+        TVec v;
+        memcpy( &v, pSrc + uOffset, sizeof(TVec) );
+        v = swapVector( v );
+        memcpy( pDst + uOffset, &v, sizeof(TVec) );
+    }
+    return uBytes / uSize;
+}
+#endif
+
+#ifdef BLD_SWAP_ALTIVEC
+static const __vector unsigned char vPerm16 = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+static const __vector unsigned char vPerm32 = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+static const __vector unsigned char vPerm64 = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+
+/// Swaps whole vectors of 16-byte aligned arrays, returns the number of elements done
+static unsigned int swapAltivec( const char* pSrc, unsigned int uCount, char* pDst, unsigned int uSize,
+                                 __vector unsigned char vPerm )
+{
+    if ( ( ( (size_t) pSrc | (size_t) pDst ) & 15 ) != 0 )
+        return 0;
+
+    const unsigned int uBytes = ( uCount * uSize ) & ~15U;
+    for ( unsigned int uOffset = 0; uOffset < uBytes; uOffset += 16 )
+    {
+        __vector unsigned char v = vec_ld( uOffset, (const unsigned char*) pSrc );
+        vec_st( vec_perm( v, v, vPerm ), uOffset, (unsigned char*) pDst );
+    }
+    return uBytes / uSize;
+}
+#endif
+
+/*
+ * Kernels
+ */
+template <class TValue, class TVec>
+static void swapBulk( const void* pSrc, unsigned int uCount, void* pDst, const void* pPerm )
+{
+    const char* pcSrc = (const char*) pSrc;
+    char* pcDst = (char*) pDst;
+    unsigned int uDone = 0;
+#ifdef BLD_SWAP_ALTIVEC
+    uDone = swapAltivec( pcSrc, uCount, pcDst, sizeof(TValue), *(const __vector unsigned char*) pPerm );
+#endif
+#ifdef BLD_SWAP_VECTOR
+    uDone += swapVectors<TVec>( pcSrc + uDone * sizeof(TValue), uCount - uDone, pcDst + uDone * sizeof(TValue),
+                                sizeof(TValue) );
+#endif
+    swapScalar<TValue>( pcSrc + uDone * sizeof(TValue), uCount - uDone, pcDst + uDone * sizeof(TValue) );
+}
+
+#ifndef BLD_SWAP_VECTOR
+// Placeholders for swapBulk<>(), only the scalar loop runs
+typedef uint16_t TVecU16;
+typedef uint32_t TVecU32;
+typedef uint64_t TVecU64;
+#endif
+
+#ifdef BLD_SWAP_ALTIVEC
+#define BLD_SWAP_PERM(vPerm) (&vPerm)
+#else
+#define BLD_SWAP_PERM(vPerm) NULL
+#endif
+
+void BldByteSwap16( const void* pSrc, unsigned int uCount, void* pDst )
+{
+    swapBulk<uint16_t, TVecU16>( pSrc, uCount, pDst, BLD_SWAP_PERM(vPerm16) );
+}
+
+void BldByteSwap32( const void* pSrc, unsigned int uCount, void* pDst )
+{
+    swapBulk<uint32_t, TVecU32>( pSrc, uCount, pDst, BLD_SWAP_PERM(vPerm32) );
+}
+
+void BldByteSwap64( const void* pSrc, unsigned int uCount, void* pDst )
+{
+    swapBulk<uint64_t, TVecU64>( pSrc, uCount, pDst, BLD_SWAP_PERM(vPerm64) );
+}
+
+void BldByteSwap16Scalar( const void* pSrc, unsigned int uCount, void* pDst )
+{
+    swapScalar<uint16_t>( (const char*) pSrc, uCount, (char*) pDst );
+}
+
+void BldByteSwap32Scalar( const void* pSrc, unsigned int uCount, void* pDst )
+{
+    swapScalar<uint32_t>( (const char*) pSrc, uCount, (char*) pDst );
+}
+
+void BldByteSwap64Scalar( const void* pSrc, unsigned int uCount, void* pDst )
+{
+    swapScalar<uint64_t>( (const char*) pSrc, uCount, (char*) pDst );
+}
+
+const char* BldByteSwapKernel()
+{
+#if defined(BLD_SWAP_ALTIVEC) && defined(BLD_SWAP_VECTOR)
+    return "altivec+vector";
+#elif defined(BLD_SWAP_ALTIVEC)
+    return "altivec";
+#elif defined(BLD_SWAP_VECTOR)
+    return "vector";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace EpicsBld
@@ -0,0 +1,71 @@
+#ifndef BLD_BYTE_SWAP_H
+#define BLD_BYTE_SWAP_H
+
+#include <string.h>
+
+#include "bldPacket.h"
+
+namespace EpicsBld
+{
+/*
+ * Bulk byte swap kernels
+ *
+ * BldByteSwap16/32/64() reverse the bytes of uCount elements from pSrc into
+ * pDst, whatever the host byte order; pSrc may equal pDst but the arrays may
+ * not overlap otherwise. Neither pointer has to be aligned.
+ *
+ * The kernel is chosen at compile time: AltiVec (vec_perm) on big-endian
+ * PowerPC built with -maltivec, for 16-byte aligned arrays; GCC vector
+ * extensions (16 bytes at a time) on GCC 4.9 and later; a loop over
+ * scalars otherwise. Tails shorter than a vector go through the scalar loop.
+ */
+void BldByteSwap16( const void* pSrc, unsigned int uCount, void* pDst );
+void BldByteSwap32( const void* pSrc, unsigned int uCount, void* pDst );
+void BldByteSwap64( const void* pSrc, unsigned int uCount, void* pDst );
+
+/// The scalar loops alone, the reference the kernels are checked against
+void BldByteSwap16Scalar( const void* pSrc, unsigned int uCount, void* pDst );
+void BldByteSwap32Scalar( const void* pSrc, unsigned int uCount, void* pDst );
+void BldByteSwap64Scalar( const void* pSrc, unsigned int uCount, void* pDst );
+
+/// The kernels built in: "altivec+vector", "altivec", "vector" or "scalar"
+const char* BldByteSwapKernel();
+
+/*
+ * Store host order arrays in the little-endian wire order, the bulk forms of
+ * BldPacketHeader::setu16LE(), setu32LE() and setdoubleLE(). A swap on
+ * BLD_BIG_ENDIAN targets, a copy otherwise.
+ */
+inline void BldStoreLE16( const void* pSrc, unsigned int uCount, void* pDst )
+{
+#ifdef BLD_BIG_ENDIAN
+    BldByteSwap16( pSrc, uCount, pDst );
+#else
+    if ( pDst != pSrc )
+        memcpy( pDst, pSrc, uCount * 2 );
+#endif
+}
+
+inline void BldStoreLE32( const void* pSrc, unsigned int uCount, void* pDst )
+{
+#ifdef BLD_BIG_ENDIAN
+    BldByteSwap32( pSrc, uCount, pDst );
+#else
+    if ( pDst != pSrc )
+        memcpy( pDst, pSrc, uCount * 4 );
+#endif
+}
+
+inline void BldStoreLE64( const void* pSrc, unsigned int uCount, void* pDst )
+{
+#ifdef BLD_BIG_ENDIAN
+    BldByteSwap64( pSrc, uCount, pDst );
+#else
+    if ( pDst != pSrc )
+        memcpy( pDst, pSrc, uCount * 8 );
+#endif
+}
+
+} // namespace EpicsBld
+
+#endif
@@ -2,6 +2,7 @@
 #include <iocsh.h>
 
 #include "bldPvClient.h"
+#include "bldPacket.h"
 
 static int bldidx = 0;
 
@@ -75,6 +76,100 @@ static const iocshArg*    BldConfigSendArgPtrs[] =
 	BldConfigSendArgs+4
 };
 
+static const iocshArg     BldSetBatchModeArgs[] = 
+{
+    {"uMaxBatch", iocshArgInt},
+    {"uDeadlineUs", iocshArgInt},
+};
+static const iocshArg*    BldSetBatchModeArgPtrs[] = 
+{ BldSetBatchModeArgs, BldSetBatchModeArgs+1 };
+
+static const iocshArg     BldSetAsyncModeArgs[] = 
+{
+    {"uRingDepth", iocshArgInt},
+    {"iOverflowPolicy", iocshArgInt},
+};
+static const iocshArg*    BldSetAsyncModeArgPtrs[] = 
+{ BldSetAsyncModeArgs, BldSetAsyncModeArgs+1 };
+
+static const iocshArg     BldSetNetworkFlagsArgs[] = 
+{
+    {"uFlags", iocshArgInt},
+};
+static const iocshArg*    BldSetNetworkFlagsArgPtrs[] = 
+{ BldSetNetworkFlagsArgs };
+
+static const iocshArg     BldSetTransportArgs[] = 
+{
+    {"sTransport", iocshArgString},
+};
+static const iocshArg*    BldSetTransportArgPtrs[] = 
+{ BldSetTransportArgs };
+
+static const iocshArg     BldSetBackpressureArgs[] = 
+{
+    {"iPolicy", iocshArgInt},
+    {"uSndBufPackets", iocshArgInt},
+    {"uPolicyArg", iocshArgInt},
+};
+static const iocshArg*    BldSetBackpressureArgPtrs[] = 
+{ BldSetBackpressureArgs, BldSetBackpressureArgs+1, BldSetBackpressureArgs+2 };
+
+static const iocshArg     BldSetMonitorModeArgs[] = 
+{
+    {"iEnable", iocshArgInt},
+};
+static const iocshArg*    BldSetMonitorModeArgPtrs[] = 
+{ BldSetMonitorModeArgs };
+
+static const iocshArg     BldSetContainerModeArgs[] = 
+{
+    {"iEnable", iocshArgInt},
+    {"uPhysicalId", iocshArgInt},
+};
+static const iocshArg*    BldSetContainerModeArgPtrs[] = 
+{ BldSetContainerModeArgs, BldSetContainerModeArgs+1 };
+
+static const iocshArg     BldSetPulseBatchArgs[] = 
+{
+    {"uMaxPulses", iocshArgInt},
+    {"uDeadlineUs", iocshArgInt},
+};
+static const iocshArg*    BldSetPulseBatchArgPtrs[] = 
+{ BldSetPulseBatchArgs, BldSetPulseBatchArgs+1 };
+
+static const iocshArg     BldSetPulseIdModeArgs[] = 
+{
+    {"iEnable", iocshArgInt},
+};
+static const iocshArg*    BldSetPulseIdModeArgPtrs[] = 
+{ BldSetPulseIdModeArgs };
+
+static const iocshArg     BldRegisterFieldsArgs[] = 
+{
+    {"uPhysicalId", iocshArgInt},
+    {"uDataType", iocshArgInt},
+    {"sFields", iocshArgString},
+};
+static const iocshArg*    BldRegisterFieldsArgPtrs[] = 
+{ BldRegisterFieldsArgs, BldRegisterFieldsArgs+1, BldRegisterFieldsArgs+2 };
+
+static const iocshArg     BldCheckPvListArgs[] = 
+{
+    {"uSrcPhysicalId", iocshArgInt},
+    {"uMaxDataSize", iocshArgInt},
+    {"sBldPvList", iocshArgString},
+};
+static const iocshArg*    BldCheckPvListArgPtrs[] = 
+{ BldCheckPvListArgs, BldCheckPvListArgs+1, BldCheckPvListArgs+2 };
+
+static const iocshArg     BldShowStatsArgs[] = 
+{
+    {"iReset", iocshArgInt},
+};
+static const iocshArg*    BldShowStatsArgPtrs[] = 
+{ BldShowStatsArgs };
+
 static const iocshFuncDef iocShBldSetIDFuncDef = {"BldSetID", 1, BldSetIDArgPtrs};
 static const iocshFuncDef iocShBldStartFuncDef = {"BldStart", 0, NULL};
 static const iocshFuncDef iocShBldStopFuncDef = {"BldStop", 0, NULL};
@@ -88,11 +183,25 @@ static const iocshFuncDef iocShBldSendDataFuncDef = {"BldSendData", 0, NULL};
 static const iocshFuncDef iocShBldPrepareDataFuncDef = {"BldPrepareData", 0, NULL};
 static const iocshFuncDef iocShBldSetDebugLevelFuncDef = {"BldSetDebugLevel", 1, BldSetDebugLevelArgPtrs};
 static const iocshFuncDef iocShBldGetDebugLevelFuncDef = {"BldGetDebugLevel", 0, NULL};
+static const iocshFuncDef iocShBldSetBatchModeFuncDef = {"BldSetBatchMode", 2, BldSetBatchModeArgPtrs};
+static const iocshFuncDef iocShBldFlushFuncDef = {"BldFlush", 0, NULL};
+static const iocshFuncDef iocShBldSetAsyncModeFuncDef = {"BldSetAsyncMode", 2, BldSetAsyncModeArgPtrs};
+static const iocshFuncDef iocShBldSetNetworkFlagsFuncDef = {"BldSetNetworkFlags", 1, BldSetNetworkFlagsArgPtrs};
+static const iocshFuncDef iocShBldSetTransportFuncDef = {"BldSetTransport", 1, BldSetTransportArgPtrs};
+static const iocshFuncDef iocShBldShowTransportsFuncDef = {"BldShowTransports", 0, NULL};
+static const iocshFuncDef iocShBldSetBackpressureFuncDef = {"BldSetBackpressure", 3, BldSetBackpressureArgPtrs};
+static const iocshFuncDef iocShBldSetMonitorModeFuncDef = {"BldSetMonitorMode", 1, BldSetMonitorModeArgPtrs};
+static const iocshFuncDef iocShBldSetContainerModeFuncDef = {"BldSetContainerMode", 2, BldSetContainerModeArgPtrs};
+static const iocshFuncDef iocShBldSetPulseBatchFuncDef = {"BldSetPulseBatch", 2, BldSetPulseBatchArgPtrs};
+static const iocshFuncDef iocShBldSetPulseIdModeFuncDef = {"BldSetPulseIdMode", 1, BldSetPulseIdModeArgPtrs};
+static const iocshFuncDef iocShBldRegisterFieldsFuncDef = {"BldRegisterFields", 3, BldRegisterFieldsArgPtrs};
+static const iocshFuncDef iocShBldCheckPvListFuncDef = {"BldCheckPvList", 3, BldCheckPvListArgPtrs};
+static const iocshFuncDef iocShBldShowStatsFuncDef = {"BldShowStats", 1, BldShowStatsArgPtrs};
 
 /* Wrapper called by iocsh, selects the argument types that iocShBldStart needs */
 static void iocShBldSetIDCallFunc(const iocshArgBuf *args) 
 {
-    if (args[0].ival >= 0 && args[0].ival < 10) {
+    if (args[0].ival >= 0 && args[0].ival < BLD_MAX_CLIENTS) {
         bldidx = args[0].ival;
         printf("BLD ID set to %d.\n", bldidx);
     } else
@@ -160,6 +269,76 @@ static void iocShBldGetDebugLevelCallFunc(const iocshArgBuf *args)
     printf( "bld debug level = %d\n", BldGetDebugLevel(bldidx) );
 }
 
+static void iocShBldSetBatchModeCallFunc(const iocshArgBuf *args) 
+{
+    BldSetBatchMode( bldidx, args[0].ival, args[1].ival );
+}
+
+static void iocShBldFlushCallFunc(const iocshArgBuf *args) 
+{
+    BldFlush(bldidx);
+}
+
+static void iocShBldSetAsyncModeCallFunc(const iocshArgBuf *args) 
+{
+    BldSetAsyncMode( bldidx, args[0].ival, args[1].ival );
+}
+
+static void iocShBldSetNetworkFlagsCallFunc(const iocshArgBuf *args) 
+{
+    BldSetNetworkFlags( bldidx, args[0].ival );
+}
+
+static void iocShBldSetTransportCallFunc(const iocshArgBuf *args) 
+{
+    BldSetTransport( bldidx, args[0].sval );
+}
+
+static void iocShBldShowTransportsCallFunc(const iocshArgBuf *args) 
+{
+    BldShowTransports();
+}
+
+static void iocShBldSetBackpressureCallFunc(const iocshArgBuf *args) 
+{
+    BldSetBackpressure( bldidx, args[0].ival, args[1].ival, args[2].ival );
+}
+
+static void iocShBldSetMonitorModeCallFunc(const iocshArgBuf *args) 
+{
+    BldSetMonitorMode( bldidx, args[0].ival );
+}
+
+static void iocShBldSetContainerModeCallFunc(const iocshArgBuf *args) 
+{
+    BldSetContainerMode( bldidx, args[0].ival, args[1].ival );
+}
+
+static void iocShBldSetPulseBatchCallFunc(const iocshArgBuf *args) 
+{
+    BldSetPulseBatch( bldidx, args[0].ival, args[1].ival );
+}
+
+static void iocShBldSetPulseIdModeCallFunc(const iocshArgBuf *args) 
+{
+    BldSetPulseIdMode( bldidx, args[0].ival );
+}
+
+static void iocShBldRegisterFieldsCallFunc(const iocshArgBuf *args) 
+{
+    BldRegisterFields( args[0].ival, args[1].ival, args[2].sval );
+}
+
+static void iocShBldCheckPvListCallFunc(const iocshArgBuf *args) 
+{
+    BldCheckPvList( args[0].ival, args[1].ival, args[2].sval );
+}
+
+static void iocShBldShowStatsCallFunc(const iocshArgBuf *args) 
+{
+    BldShowStats( bldidx, args[0].ival );
+}
+
 /* Registration routine, runs at startup */
 static void iocShBldSetIDRegister(void) 
   { iocshRegister(&iocShBldSetIDFuncDef, iocShBldSetIDCallFunc); }
@@ -187,6 +366,34 @@ static void iocShBldSetDebugLevelRegister(void)
   { iocshRegister(&iocShBldSetDebugLevelFuncDef, iocShBldSetDebugLevelCallFunc); }
 static void iocShBldGetDebugLevelRegister(void) 
   { iocshRegister(&iocShBldGetDebugLevelFuncDef, iocShBldGetDebugLevelCallFunc); }
+static void iocShBldSetBatchModeRegister(void) 
+  { iocshRegister(&iocShBldSetBatchModeFuncDef, iocShBldSetBatchModeCallFunc); }
+static void iocShBldFlushRegister(void) 
+  { iocshRegister(&iocShBldFlushFuncDef, iocShBldFlushCallFunc); }
+static void iocShBldSetAsyncModeRegister(void) 
+  { iocshRegister(&iocShBldSetAsyncModeFuncDef, iocShBldSetAsyncModeCallFunc); }
+static void iocShBldSetNetworkFlagsRegister(void) 
+  { iocshRegister(&iocShBldSetNetworkFlagsFuncDef, iocShBldSetNetworkFlagsCallFunc); }
+static void iocShBldSetTransportRegister(void) 
+  { iocshRegister(&iocShBldSetTransportFuncDef, iocShBldSetTransportCallFunc); }
+static void iocShBldShowTransportsRegister(void) 
+  { iocshRegister(&iocShBldShowTransportsFuncDef, iocShBldShowTransportsCallFunc); }
+static void iocShBldSetBackpressureRegister(void) 
+  { iocshRegister(&iocShBldSetBackpressureFuncDef, iocShBldSetBackpressureCallFunc); }
+static void iocShBldSetMonitorModeRegister(void) 
+  { iocshRegister(&iocShBldSetMonitorModeFuncDef, iocShBldSetMonitorModeCallFunc); }
+static void iocShBldSetContainerModeRegister(void) 
+  { iocshRegister(&iocShBldSetContainerModeFuncDef, iocShBldSetContainerModeCallFunc); }
+static void iocShBldSetPulseBatchRegister(void) 
+  { iocshRegister(&iocShBldSetPulseBatchFuncDef, iocShBldSetPulseBatchCallFunc); }
+static void iocShBldSetPulseIdModeRegister(void) 
+  { iocshRegister(&iocShBldSetPulseIdModeFuncDef, iocShBldSetPulseIdModeCallFunc); }
+static void iocShBldRegisterFieldsRegister(void) 
+  { iocshRegister(&iocShBldRegisterFieldsFuncDef, iocShBldRegisterFieldsCallFunc); }
+static void iocShBldCheckPvListRegister(void) 
+  { iocshRegister(&iocShBldCheckPvListFuncDef, iocShBldCheckPvListCallFunc); }
+static void iocShBldShowStatsRegister(void) 
+  { iocshRegister(&iocShBldShowStatsFuncDef, iocShBldShowStatsCallFunc); }
 
 epicsExportRegistrar(iocShBldSetIDRegister);
 epicsExportRegistrar(iocShBldStartRegister);
@@ -201,4 +408,18 @@ epicsExportRegistrar(iocShBldSendDataRegister);
 epicsExportRegistrar(iocShBldPrepareDataRegister);
 epicsExportRegistrar(iocShBldSetDebugLevelRegister);
 epicsExportRegistrar(iocShBldGetDebugLevelRegister);
+epicsExportRegistrar(iocShBldSetBatchModeRegister);
+epicsExportRegistrar(iocShBldFlushRegister);
+epicsExportRegistrar(iocShBldSetAsyncModeRegister);
+epicsExportRegistrar(iocShBldSetNetworkFlagsRegister);
+epicsExportRegistrar(iocShBldSetTransportRegister);
+epicsExportRegistrar(iocShBldShowTransportsRegister);
+epicsExportRegistrar(iocShBldSetBackpressureRegister);
+epicsExportRegistrar(iocShBldSetMonitorModeRegister);
+epicsExportRegistrar(iocShBldSetContainerModeRegister);
+epicsExportRegistrar(iocShBldSetPulseBatchRegister);
+epicsExportRegistrar(iocShBldSetPulseIdModeRegister);
+epicsExportRegistrar(iocShBldRegisterFieldsRegister);
+epicsExportRegistrar(iocShBldCheckPvListRegister);
+epicsExportRegistrar(iocShBldShowStatsRegister);
 
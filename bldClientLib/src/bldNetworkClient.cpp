@@ -3,6 +3,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -14,7 +15,26 @@
 #include <string>
 #include <sstream>
 
+#include <epicsMutex.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsTimer.h>
+
 #include "bldNetworkClient.h"
+#include "bldNetworkClientSlim.h"
+
+#ifdef __linux__
+#include <netinet/udp.h>
+#ifdef UDP_SEGMENT
+#define BLD_HAVE_GSO
+#endif
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define BLD_HAVE_ZEROCOPY
+#include <sys/mman.h>
+#include <linux/errqueue.h>
+#endif
 
 /*
  * Global C function definitions
@@ -92,49 +112,91 @@ int BldNetworkClientSendRawData(void* pVoidBldNetworkClient, int iSizeData, char
     return pBldNetworkClient->sendRawData(iSizeData, pData);
 }
 
-} // extern "C" 
+/**
+ * Call the vectored Send function defined in EpicsBld::BldNetworkClientInterface 
+ */
+int BldNetworkClientSendRawDataV(void* pVoidBldNetworkClient, const struct iovec* pIov, int iIovCount)
+{
+    if ( pVoidBldNetworkClient == NULL || pIov == NULL )
+        return -1;
 
-using std::string;
+    EpicsBld::BldNetworkClientInterface* pBldNetworkClient = 
+      reinterpret_cast<EpicsBld::BldNetworkClientInterface*>(pVoidBldNetworkClient);      
 
-/*
- * local class declarations
+    return pBldNetworkClient->sendRawDataV(pIov, iIovCount);
+}
+
+/**
+ * Call the batch control functions defined in EpicsBld::BldNetworkClientInterface 
  */
-namespace EpicsBld
+int BldNetworkClientSetBatchMode(void* pVoidBldNetworkClient, unsigned int uMaxBatch, 
+    unsigned int uDeadlineUs)
 {
+    if ( pVoidBldNetworkClient == NULL )
+        return -1;
+
+    EpicsBld::BldNetworkClientInterface* pBldNetworkClient = 
+      reinterpret_cast<EpicsBld::BldNetworkClientInterface*>(pVoidBldNetworkClient);      
+
+    return pBldNetworkClient->setBatchMode(uMaxBatch, uDeadlineUs);
+}
+
+int BldNetworkClientFlush(void* pVoidBldNetworkClient)
+{
+    if ( pVoidBldNetworkClient == NULL )
+        return -1;
+
+    EpicsBld::BldNetworkClientInterface* pBldNetworkClient = 
+      reinterpret_cast<EpicsBld::BldNetworkClientInterface*>(pVoidBldNetworkClient);      
+
+    return pBldNetworkClient->flush();
+}
 
 /**
- * A Slim Bld Multicast Client class 
- *
- * Combination of BldNetworkClientBasic, Client, Port and Ins
+ * Call the burst Send function defined in EpicsBld::BldNetworkClientInterface 
  */
-class BldNetworkClientSlim : public BldNetworkClientInterface
-{
-public:
-    BldNetworkClientSlim(unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize,
-      unsigned char ucTTL = 32, const char* sInteraceIp = NULL);
-    BldNetworkClientSlim(unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize,
-      unsigned char ucTTL = 32, unsigned int uInteraceIp = 0);
-    virtual ~BldNetworkClientSlim();
-    
-    virtual int sendRawData(int iSizeData, const char* pData);
-    
-    // debug information control
-    virtual void setDebugLevel(int iDebugLevel);
-    virtual int getDebugLevel();
-    
-private:
-    unsigned int _uAddr;
-    unsigned short _uPort;
-    int _iSocket;
-    int _iDebugLevel;
-    
-    int _init( unsigned int uMaxDataSize, unsigned char ucTTL, 
-      unsigned int uInterfaceIp);   
-      
-    static std::string addressToStr( unsigned int uAddr );      
-};
+int BldNetworkClientSendBurst(void* pVoidBldNetworkClient, const char* pData, int iSegmentSize,
+    int iSegmentCount)
+{
+    if ( pVoidBldNetworkClient == NULL || pData == NULL )
+        return -1;
 
-} // namespace EpicsBld
+    EpicsBld::BldNetworkClientInterface* pBldNetworkClient = 
+      reinterpret_cast<EpicsBld::BldNetworkClientInterface*>(pVoidBldNetworkClient);      
+
+    return pBldNetworkClient->sendBurst(pData, iSegmentSize, iSegmentCount);
+}
+
+int BldNetworkClientSendRawDataVBatch(void* pVoidBldNetworkClient, const struct iovec* pIov,
+    int iIovPerPacket, int iPacketCount)
+{
+    if ( pVoidBldNetworkClient == NULL || pIov == NULL )
+        return -1;
+
+    EpicsBld::BldNetworkClientInterface* pBldNetworkClient = 
+      reinterpret_cast<EpicsBld::BldNetworkClientInterface*>(pVoidBldNetworkClient);      
+
+    return pBldNetworkClient->sendRawDataVBatch(pIov, iIovPerPacket, iPacketCount);
+}
+
+/**
+ * Call the backpressure control function defined in EpicsBld::BldNetworkClientInterface 
+ */
+int BldNetworkClientSetBackpressure(void* pVoidBldNetworkClient, int iPolicy, 
+    unsigned int uSndBufPackets, unsigned int uPolicyArg)
+{
+    if ( pVoidBldNetworkClient == NULL )
+        return -1;
+
+    EpicsBld::BldNetworkClientInterface* pBldNetworkClient = 
+      reinterpret_cast<EpicsBld::BldNetworkClientInterface*>(pVoidBldNetworkClient);      
+
+    return pBldNetworkClient->setBackpressure(iPolicy, uSndBufPackets, uPolicyArg);
+}
+
+} // extern "C" 
+
+using std::string;
 
 /**
  * class member definitions
@@ -146,43 +208,89 @@ namespace EpicsBld
  */
 BldNetworkClientInterface* BldNetworkClientFactory::createBldNetworkClient(unsigned int uAddr, 
   unsigned short uPort, unsigned int uMaxDataSize, unsigned char ucTTL, 
-  const char* sInteraceIp)
+  const char* sInteraceIp, unsigned int uFlags)
 {
-    return new BldNetworkClientSlim(uAddr, uPort, uMaxDataSize, ucTTL, sInteraceIp );
+    if ( uFlags & (BLD_NETWORK_IO_URING | BLD_NETWORK_SQPOLL) )
+    {
+#ifdef BLD_HAVE_IO_URING
+        return new BldNetworkClientUring(uAddr, uPort, uMaxDataSize, ucTTL, sInteraceIp, uFlags );
+#else
+        printf( "[Warning] BldNetworkClientFactory::createBldNetworkClient() : io_uring is not supported "
+          "on this platform, using sendmsg()\n" );
+#endif
+    }
+    return new BldNetworkClientSlim(uAddr, uPort, uMaxDataSize, ucTTL, sInteraceIp, uFlags );
 }
 
 BldNetworkClientInterface* BldNetworkClientFactory::createBldNetworkClient(unsigned int uAddr, 
   unsigned short uPort, unsigned int uMaxDataSize, unsigned char ucTTL, 
-  unsigned int uInterfaceIp)
+  unsigned int uInterfaceIp, unsigned int uFlags)
 {
-    return new BldNetworkClientSlim(uAddr, uPort, uMaxDataSize, ucTTL, uInterfaceIp );
+    if ( uFlags & (BLD_NETWORK_IO_URING | BLD_NETWORK_SQPOLL) )
+    {
+#ifdef BLD_HAVE_IO_URING
+        return new BldNetworkClientUring(uAddr, uPort, uMaxDataSize, ucTTL, uInterfaceIp, uFlags );
+#else
+        printf( "[Warning] BldNetworkClientFactory::createBldNetworkClient() : io_uring is not supported "
+          "on this platform, using sendmsg()\n" );
+#endif
+    }
+    return new BldNetworkClientSlim(uAddr, uPort, uMaxDataSize, ucTTL, uInterfaceIp, uFlags );
 }
 
 /**
  * class BldNetworkClientSlim
  */
 BldNetworkClientSlim::BldNetworkClientSlim(unsigned int uAddr, unsigned short uPort, 
-  unsigned int uMaxDataSize, unsigned char ucTTL, const char* sInterfaceIp) : 
-  _uAddr(uAddr), _uPort(uPort), _iSocket(-1), _iDebugLevel(0)
+  unsigned int uMaxDataSize, unsigned char ucTTL, const char* sInterfaceIp, unsigned int uFlags) : 
+  _uAddr(uAddr), _uPort(uPort), _uMaxDataSize(uMaxDataSize), _iSocket(-1), _iDebugLevel(0),
+  _pMsgName(NULL), _uMsgNameLen(0),
+  _batchLock(epicsMutexMustCreate()), _batchTimerQueue(NULL), _batchTimer(NULL),
+  _uBatchMax(0), _uBatchDeadlineUs(0), _uBatchCount(0),
+  _pBatchBuffer(NULL), _pBatchIov(NULL), _pBatchMsgs(NULL),
+  _bGso(false), _iBpPolicy(BLD_BACKPRESSURE_BLOCK), _uBpSpinUs(uBpDefaultSpinUs),
+  _bpLock(epicsMutexMustCreate()), _pBpQueue(NULL), _puBpQueueLen(NULL),
+  _uBpQueueDepth(0), _uBpQueueHead(0), _uBpQueueCount(0),
+  _bZeroCopy(false), _zcLock(epicsMutexMustCreate()), _pZcPool(NULL), _uZcBufferSize(0),
+  _uZcFreeCount(0), _uZcInFlightHead(0), _uZcNextSeq(0), _dfZcLagSumUs(0)
 {
     unsigned int uInterfaceIp = ( 
       (sInterfaceIp == NULL || sInterfaceIp[0] == 0)?
       0 : ntohl(inet_addr(sInterfaceIp)) );
     
-    _init(uMaxDataSize, ucTTL, uInterfaceIp);   
+    _init(uMaxDataSize, ucTTL, uInterfaceIp, uFlags);   
 }
 
 BldNetworkClientSlim::BldNetworkClientSlim(unsigned int uAddr, unsigned short uPort, 
-  unsigned int uMaxDataSize, unsigned char ucTTL, unsigned int uInterfaceIp) : 
-  _uAddr(uAddr), _uPort(uPort), _iSocket(-1), _iDebugLevel(0)
+  unsigned int uMaxDataSize, unsigned char ucTTL, unsigned int uInterfaceIp, unsigned int uFlags) : 
+  _uAddr(uAddr), _uPort(uPort), _uMaxDataSize(uMaxDataSize), _iSocket(-1), _iDebugLevel(0),
+  _pMsgName(NULL), _uMsgNameLen(0),
+  _batchLock(epicsMutexMustCreate()), _batchTimerQueue(NULL), _batchTimer(NULL),
+  _uBatchMax(0), _uBatchDeadlineUs(0), _uBatchCount(0),
+  _pBatchBuffer(NULL), _pBatchIov(NULL), _pBatchMsgs(NULL),
+  _bGso(false), _iBpPolicy(BLD_BACKPRESSURE_BLOCK), _uBpSpinUs(uBpDefaultSpinUs),
+  _bpLock(epicsMutexMustCreate()), _pBpQueue(NULL), _puBpQueueLen(NULL),
+  _uBpQueueDepth(0), _uBpQueueHead(0), _uBpQueueCount(0),
+  _bZeroCopy(false), _zcLock(epicsMutexMustCreate()), _pZcPool(NULL), _uZcBufferSize(0),
+  _uZcFreeCount(0), _uZcInFlightHead(0), _uZcNextSeq(0), _dfZcLagSumUs(0)
 {   
-    _init(uMaxDataSize, ucTTL, uInterfaceIp);
+    _init(uMaxDataSize, ucTTL, uInterfaceIp, uFlags);
 }
 
 int BldNetworkClientSlim::_init( unsigned int uMaxDataSize, unsigned char ucTTL, 
-  unsigned int uInterfaceIp)
+  unsigned int uInterfaceIp, unsigned int uFlags)
 {
     int iRetErrorCode = 0;
+
+    memset( &_batchStats, 0, sizeof(_batchStats) );
+    memset( &_bpStats, 0, sizeof(_bpStats) );
+
+    memset( &_sockaddrDst, 0, sizeof(_sockaddrDst) );
+    _sockaddrDst.sin_family      = AF_INET;
+    _sockaddrDst.sin_addr.s_addr = htonl(_uAddr);
+    _sockaddrDst.sin_port        = htons(_uPort);
+    _pMsgName    = (sockaddr*) &_sockaddrDst;
+    _uMsgNameLen = sizeof(_sockaddrDst);
 try
 {
     /*
@@ -207,6 +315,10 @@ try
       setsockopt(_iSocket, SOL_SOCKET, SO_SNDBUF, (char*)&iSendBufferSize, sizeof(iSendBufferSize))
       == -1 )
         throw string("BldNetworkClientSlim::BldNetworkClientSlim() : setsockopt(...SO_SNDBUF) failed");
+
+    socklen_t uSndBufLen = sizeof(iSendBufferSize);
+    if ( getsockopt(_iSocket, SOL_SOCKET, SO_SNDBUF, (char*)&iSendBufferSize, &uSndBufLen) == 0 )
+        _bpStats.uSndBufBytes = iSendBufferSize;
     
     /*
      * socket and bind
@@ -265,6 +377,42 @@ try
             throw string("BldNetworkClientSlim::BldNetworkClientSlim() : setsockopt(...IP_MULTICAST_IF) failed");         
     }       
 
+    /*
+     * connect to the group
+     *
+     * The destination never changes, so let the kernel resolve the route
+     * once here instead of on every sendmsg(). Sends then carry no msg_name.
+     */
+    if ( uFlags & BLD_NETWORK_CONNECTED )
+    {
+        if ( 
+          connect( _iSocket, (struct sockaddr*) &_sockaddrDst, sizeof(_sockaddrDst) ) 
+          == 0 )
+        {
+            _pMsgName    = NULL;
+            _uMsgNameLen = 0;
+            if ( _iDebugLevel > 1 )
+                printf( "Connected to %s Port %u\n", addressToStr(_uAddr).c_str(), (unsigned int) _uPort );
+        }
+        else
+            printf( "[Warning] BldNetworkClientSlim::BldNetworkClientSlim() : connect() failed, errno = %d (%s). "
+              "Using unconnected sends.\n", errno, strerror(errno) );
+    }
+
+    /*
+     * probe for UDP GSO (linux 4.18+), used by sendBurst()
+     */
+#ifdef BLD_HAVE_GSO
+    int iGsoSize = 0;
+    socklen_t uGsoOptLen = sizeof(iGsoSize);
+    _bGso = ( getsockopt( _iSocket, SOL_UDP, UDP_SEGMENT, (char*)&iGsoSize, &uGsoOptLen ) == 0 );
+    if ( _iDebugLevel > 1 )
+        printf( "UDP GSO %s\n", (_bGso ? "available" : "unavailable, bursts use sendmmsg()") );
+#endif
+
+    if ( uFlags & BLD_NETWORK_ZEROCOPY )
+        _initZeroCopy();
+
 }
 catch (string& sError)
 {
@@ -279,6 +427,45 @@ catch (string& sError)
 
 BldNetworkClientSlim::~BldNetworkClientSlim()
 {
+    // Send whatever is still queued, then make sure the deadline
+    // timer can no longer fire before the batch buffers go away
+    flush();
+    if ( _batchTimer != NULL )
+        epicsTimerQueueDestroyTimer( _batchTimerQueue, _batchTimer );
+    if ( _batchTimerQueue != NULL )
+        epicsTimerQueueRelease( _batchTimerQueue );
+    _freeBatch();
+    epicsMutexDestroy( _batchLock );
+
+    // Parked packets are sent, not dropped, waiting for room if need be
+    if ( _uBpQueueCount != 0 )
+    {
+        int iFileFlags = fcntl( _iSocket, F_GETFL, 0 );
+        if ( iFileFlags != -1 )
+            fcntl( _iSocket, F_SETFL, iFileFlags & ~O_NONBLOCK );
+        _drainLocked();
+    }
+    _freeBpQueue();
+    epicsMutexDestroy( _bpLock );
+
+    if ( _pZcPool != NULL )
+    {
+        // Give the kernel a moment to finish with in-flight buffers
+        for ( int iTry = 0; iTry < 10 && _zcStats.uInFlight != 0; iTry++ )
+        {
+            epicsMutexMustLock( _zcLock );
+            _reapZeroCopyLocked();
+            epicsMutexUnlock( _zcLock );
+            if ( _zcStats.uInFlight != 0 )
+                epicsThreadSleep( 0.01 );
+        }
+#ifdef BLD_HAVE_ZEROCOPY
+        munlock( _pZcPool, uZeroCopyBuffers * _uZcBufferSize );
+#endif
+        free( _pZcPool );
+    }
+    epicsMutexDestroy( _zcLock );
+
     if (_iSocket != 0)
         close(_iSocket);
 }
@@ -295,55 +482,1164 @@ int BldNetworkClientSlim::getDebugLevel()
 }
 
 int BldNetworkClientSlim::sendRawData(int iSizeData, const char* pData)
+{
+    struct iovec iov;
+    iov.iov_base = (caddr_t)(pData);
+    iov.iov_len  = iSizeData;
+    return sendRawDataV( &iov, 1 );
+}
+
+int BldNetworkClientSlim::sendRawDataV(const struct iovec* pIov, int iIovCount)
 {
     int iRetErrorCode = 0;
+
+    size_t uSizeData = 0;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+        uSizeData += pIov[iIov].iov_len;
+
+    if ( _uBatchMax > 1 )
+    {
+        epicsMutexMustLock( _batchLock );
+        if ( _uBatchMax > 1 )
+        {
+            if ( uSizeData > _uMaxDataSize )
+            {
+                _batchStats.uPktsDropped++;
+                epicsMutexUnlock( _batchLock );
+                printf( "[Error] BldNetworkClientSlim::sendRawData() : size %zu exceeds batch slot size %u\n",
+                  uSizeData, _uMaxDataSize );
+                return 1;
+            }
+
+            // Gather into the next free slot, the caller may reuse its buffers right away
+            char* pSlot = _pBatchBuffer + _uBatchCount * _uMaxDataSize;
+            for ( int iIov = 0; iIov < iIovCount; iIov++ )
+            {
+                memcpy( pSlot, pIov[iIov].iov_base, pIov[iIov].iov_len );
+                pSlot += pIov[iIov].iov_len;
+            }
+            _pBatchIov[_uBatchCount].iov_len = uSizeData;
+            _batchStats.uPktsQueued++;
+
+            if ( _uBatchCount++ == 0 && _uBatchDeadlineUs != 0 )
+            {
+                epicsTimeGetCurrent( &_tsBatchFirst );
+                epicsTimerStartDelay( _batchTimer, _uBatchDeadlineUs * 1e-6 );
+            }
+
+            if ( _uBatchCount >= _uBatchMax )
+                iRetErrorCode = _flushLocked( FLUSH_COUNT );
+
+            epicsMutexUnlock( _batchLock );
+            return iRetErrorCode;
+        }
+        epicsMutexUnlock( _batchLock );
+    }
     /*
      * sendmsg
      */     
 
     //// ! Debug only
     //printf("Bld send to %x port %d Data String: %s\n", _uAddr, _uPort, pData);
-    
-    sockaddr_in sockaddrDst;
-    sockaddrDst.sin_family      = AF_INET;
-    sockaddrDst.sin_addr.s_addr = htonl(_uAddr);
-    sockaddrDst.sin_port        = htons(_uPort);    
-    
-    struct iovec iov[2];
-    iov[0].iov_base = (caddr_t)(pData);
-    iov[0].iov_len  = iSizeData;
-    
+
+    int iErrno;
+    if ( _iBpPolicy == BLD_BACKPRESSURE_DROP_OLDEST )
+    {
+        // A packet may not overtake the ones parked before it
+        epicsMutexMustLock( _bpLock );
+        iErrno = ( _drainLocked() ? _sendOne( pIov, iIovCount, uSizeData ) : EAGAIN );
+        if ( _isWouldBlock( iErrno ) )
+            iErrno = _backpressureLocked( pIov, iIovCount, uSizeData );
+        epicsMutexUnlock( _bpLock );
+    }
+    else
+    {
+        iErrno = _sendOne( pIov, iIovCount, uSizeData );
+        if ( _isWouldBlock( iErrno ) && _iBpPolicy != BLD_BACKPRESSURE_BLOCK )
+            iErrno = _sendWouldBlock( pIov, iIovCount, uSizeData );
+    }
+
+    if ( iErrno == 0 )
+        return 0;
+
+    // Dropped by the backpressure policy: counted, not an error
+    if ( !_isWouldBlock( iErrno ) || _iBpPolicy == BLD_BACKPRESSURE_BLOCK || _iDebugLevel >= 2 )
+    {
+        printf( "[Error] BldNetworkClientSlim::sendRawData() : sendmsg failed, size = %zu, errno = %d (%s)\n",
+          uSizeData, iErrno, strerror(iErrno) );
+        printf( "[Error] BldNetworkClientSlim::sendRawData() : iIovCount = %d, pIov->iov_len = %zu \n",
+          iIovCount, pIov->iov_len );
+    }
+    iRetErrorCode = 1;
+
+    return iRetErrorCode;   
+}
+
+int BldNetworkClientSlim::setBatchMode(unsigned int uMaxBatch, unsigned int uDeadlineUs)
+{
+    if ( uMaxBatch > uMaxBatchLimit )
+    {
+        printf( "BldNetworkClientSlim::setBatchMode() : uMaxBatch %u clipped to %u\n",
+          uMaxBatch, (unsigned int) uMaxBatchLimit );
+        uMaxBatch = uMaxBatchLimit;
+    }
+
+    epicsMutexMustLock( _batchLock );
+
+    // Anything queued under the old settings goes out first
+    _flushLocked( FLUSH_EXPLICIT );
+    _freeBatch();
+
+    _uBatchMax        = 0;
+    _uBatchDeadlineUs = 0;
+    if ( uMaxBatch > 1 )
+    {
+        _pBatchBuffer = new char[uMaxBatch * _uMaxDataSize];
+        _pBatchIov    = new struct iovec[uMaxBatch];
+        _pBatchMsgs   = new BldMsgEntry[uMaxBatch];
+
+        memset( _pBatchMsgs, 0, uMaxBatch * sizeof(BldMsgEntry) );
+        for ( unsigned int uSlot = 0; uSlot < uMaxBatch; uSlot++ )
+        {
+            _pBatchIov[uSlot].iov_base = (caddr_t)(_pBatchBuffer + uSlot * _uMaxDataSize);
+            _pBatchIov[uSlot].iov_len  = 0;
+
+            struct msghdr& hdr  = _pBatchMsgs[uSlot].msg_hdr;
+            hdr.msg_name        = _pMsgName;
+            hdr.msg_namelen     = _uMsgNameLen;
+            hdr.msg_iov         = &_pBatchIov[uSlot];
+            hdr.msg_iovlen      = 1;
+        }
+
+        if ( uDeadlineUs != 0 && _batchTimer == NULL )
+        {
+            _batchTimerQueue = epicsTimerQueueAllocate( 1, epicsThreadPriorityScanHigh );
+            _batchTimer = epicsTimerQueueCreateTimer( _batchTimerQueue, _batchDeadlineCallback, this );
+        }
+
+        _uBatchMax        = uMaxBatch;
+        _uBatchDeadlineUs = uDeadlineUs;
+    }
+
+    epicsMutexUnlock( _batchLock );
+
+    if ( _iDebugLevel >= 1 )
+        printf( "BldNetworkClientSlim: batch mode %s, max %u packets, deadline %u us\n",
+          (_uBatchMax > 1 ? "on" : "off"), uMaxBatch, uDeadlineUs );
+    return 0;
+}
+
+int BldNetworkClientSlim::flush()
+{
+    epicsMutexMustLock( _batchLock );
+    int iRetErrorCode = _flushLocked( FLUSH_EXPLICIT );
+    epicsMutexUnlock( _batchLock );
+    return iRetErrorCode;
+}
+
+int BldNetworkClientSlim::sendBurst(const char* pData, int iSegmentSize, int iSegmentCount)
+{
+    if ( pData == NULL || iSegmentSize <= 0 || iSegmentCount <= 0 )
+        return 1;
+    if ( (unsigned int) iSegmentSize > _uMaxDataSize )
+    {
+        printf( "[Error] BldNetworkClientSlim::sendBurst() : segment size %d exceeds max data size %u\n",
+          iSegmentSize, _uMaxDataSize );
+        return 1;
+    }
+
+    // Packets already queued in batch mode go out ahead of the burst
+    if ( _uBatchMax > 1 )
+        flush();
+
+    // So do parked packets; if they cannot, the burst is parked behind them
+    bool bParked = false;
+    if ( _iBpPolicy == BLD_BACKPRESSURE_DROP_OLDEST )
+    {
+        epicsMutexMustLock( _bpLock );
+        bParked = !_drainLocked();
+        epicsMutexUnlock( _bpLock );
+    }
+
+    int iRetErrorCode;
+    if ( bParked )
+        iRetErrorCode = _burstBackpressure( pData, iSegmentSize, iSegmentCount );
+    else if ( _bGso && iSegmentCount > 1 )
+        iRetErrorCode = _sendBurstGso( pData, iSegmentSize, iSegmentCount );
+    else
+        iRetErrorCode = _sendBurstMmsg( pData, iSegmentSize, iSegmentCount );
+
+    epicsMutexMustLock( _batchLock );
+    _batchStats.uBursts++;
+    epicsMutexUnlock( _batchLock );
+    return iRetErrorCode;
+}
+
+int BldNetworkClientSlim::sendRawDataVBatch(const struct iovec* pIov, int iIovPerPacket, int iPacketCount)
+{
+    if ( pIov == NULL || iIovPerPacket <= 0 || iPacketCount <= 0 )
+        return 1;
+
+    // Parked packets go out first; if they cannot, the batch is parked behind them
+    bool bParked = false;
+    if ( _iBpPolicy == BLD_BACKPRESSURE_DROP_OLDEST )
+    {
+        epicsMutexMustLock( _bpLock );
+        bParked = !_drainLocked();
+        epicsMutexUnlock( _bpLock );
+    }
+
+    if ( bParked )
+        return _batchBackpressure( pIov, iIovPerPacket, iPacketCount );
+
+    // In batch mode the packets join the queue one by one, keeping the order
+    if ( _uBatchMax > 1 )
+    {
+        int iRetErrorCode = 0;
+        for ( int iPacket = 0; iPacket < iPacketCount; iPacket++ )
+        {
+            if ( sendRawDataV( pIov + iPacket * iIovPerPacket, iIovPerPacket ) != 0 )
+                iRetErrorCode = 1;
+        }
+        return iRetErrorCode;
+    }
+
+    return _sendBatchMmsg( pIov, iIovPerPacket, iPacketCount );
+}
+
+void BldNetworkClientSlim::getBatchStats(BldBatchStats* pStats)
+{
+    if ( pStats == NULL )
+        return;
+    epicsMutexMustLock( _batchLock );
+    *pStats = _batchStats;
+    epicsMutexUnlock( _batchLock );
+}
+
+void BldNetworkClientSlim::resetBatchStats()
+{
+    epicsMutexMustLock( _batchLock );
+    memset( &_batchStats, 0, sizeof(_batchStats) );
+    epicsMutexUnlock( _batchLock );
+}
+
+int BldNetworkClientSlim::setBackpressure(int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg)
+{
+    if ( iPolicy < BLD_BACKPRESSURE_BLOCK || iPolicy > BLD_BACKPRESSURE_SPIN )
+    {
+        printf( "[Error] BldNetworkClientSlim::setBackpressure() : invalid policy %d\n", iPolicy );
+        return 1;
+    }
+
+    if ( uSndBufPackets != 0 )
+    {
+        // Same allowance per packet as _init(); linux doubles the value
+        // to cover its own bookkeeping, and caps it at net.core.wmem_max
+        int iSendBufferSize = uSndBufPackets * ( _uMaxDataSize + sizeof(struct sockaddr_in) );
+        if (
+          setsockopt(_iSocket, SOL_SOCKET, SO_SNDBUF, (char*)&iSendBufferSize, sizeof(iSendBufferSize))
+          == -1 )
+        {
+            printf( "[Error] BldNetworkClientSlim::setBackpressure() : setsockopt(...SO_SNDBUF) failed, errno = %d (%s)\n",
+              errno, strerror(errno) );
+            return 1;
+        }
+    }
+
+    int iFileFlags = fcntl( _iSocket, F_GETFL, 0 );
+    if ( iFileFlags == -1 )
+    {
+        printf( "[Error] BldNetworkClientSlim::setBackpressure() : fcntl(F_GETFL) failed, errno = %d (%s)\n",
+          errno, strerror(errno) );
+        return 1;
+    }
+
+    // Back to blocking before the policy says so, and the other way round,
+    // so a send never sees EAGAIN under the blocking policy
+    if ( iPolicy == BLD_BACKPRESSURE_BLOCK )
+        fcntl( _iSocket, F_SETFL, iFileFlags & ~O_NONBLOCK );
+
+    epicsMutexMustLock( _batchLock );
+    epicsMutexMustLock( _bpLock );
+
+    // Parked packets get one more chance, whatever is left is dropped
+    if ( _uBpQueueCount != 0 )
+    {
+        _drainLocked();
+        _bpStats.uDropOldest += _uBpQueueCount;
+        for ( ; _uBpQueueCount != 0; _uBpQueueCount-- )
+            _sendStats.recordFailure( EAGAIN );
+    }
+    _freeBpQueue();
+
+    _iBpPolicy = iPolicy;
+    _uBpSpinUs = uBpDefaultSpinUs;
+    if ( iPolicy == BLD_BACKPRESSURE_DROP_OLDEST )
+    {
+        _uBpQueueDepth = ( uPolicyArg != 0 ? uPolicyArg : (unsigned int) uBpDefaultQueueDepth );
+        _pBpQueue      = new char[_uBpQueueDepth * _uMaxDataSize];
+        _puBpQueueLen  = new size_t[_uBpQueueDepth];
+    }
+    else if ( iPolicy == BLD_BACKPRESSURE_SPIN && uPolicyArg != 0 )
+        _uBpSpinUs = uPolicyArg;
+
+    int iSendBufferSize = 0;
+    socklen_t uSndBufLen = sizeof(iSendBufferSize);
+    if ( getsockopt(_iSocket, SOL_SOCKET, SO_SNDBUF, (char*)&iSendBufferSize, &uSndBufLen) == 0 )
+        _bpStats.uSndBufBytes = iSendBufferSize;
+
+    int iRetErrorCode = 0;
+    if ( iPolicy != BLD_BACKPRESSURE_BLOCK && fcntl( _iSocket, F_SETFL, iFileFlags | O_NONBLOCK ) == -1 )
+    {
+        printf( "[Error] BldNetworkClientSlim::setBackpressure() : fcntl(O_NONBLOCK) failed, errno = %d (%s)\n",
+          errno, strerror(errno) );
+        _freeBpQueue();
+        _iBpPolicy = BLD_BACKPRESSURE_BLOCK;
+        iRetErrorCode = 1;
+    }
+
+    epicsMutexUnlock( _bpLock );
+    epicsMutexUnlock( _batchLock );
+
+    if ( _iDebugLevel >= 1 )
+        printf( "BldNetworkClientSlim: backpressure policy %d, queue %u packets, spin %u us, SO_SNDBUF %u bytes\n",
+          _iBpPolicy, _uBpQueueDepth, _uBpSpinUs, _bpStats.uSndBufBytes );
+    return iRetErrorCode;
+}
+
+void BldNetworkClientSlim::getBackpressureStats(BldBackpressureStats* pStats)
+{
+    if ( pStats == NULL )
+        return;
+    epicsMutexMustLock( _bpLock );
+    *pStats = _bpStats;
+    epicsMutexUnlock( _bpLock );
+}
+
+void BldNetworkClientSlim::resetBackpressureStats()
+{
+    epicsMutexMustLock( _bpLock );
+    unsigned int uSndBufBytes = _bpStats.uSndBufBytes;
+    memset( &_bpStats, 0, sizeof(_bpStats) );
+    _bpStats.uSndBufBytes    = uSndBufBytes;
+    _bpStats.uQueueHighWater = _uBpQueueCount;
+    epicsMutexUnlock( _bpLock );
+}
+
+char* BldNetworkClientSlim::acquireTxBuffer(unsigned int uSize)
+{
+    if ( !_bZeroCopy || uSize > _uZcBufferSize )
+        return NULL;
+
+    epicsMutexMustLock( _zcLock );
+    if ( _uZcFreeCount == 0 )
+        _reapZeroCopyLocked();
+    if ( _uZcFreeCount == 0 )
+    {
+        _zcStats.uPoolExhausted++;
+        epicsMutexUnlock( _zcLock );
+        return NULL;
+    }
+    unsigned int uIndex = _lZcFree[--_uZcFreeCount];
+    epicsMutexUnlock( _zcLock );
+
+    return _pZcPool + uIndex * _uZcBufferSize;
+}
+
+void BldNetworkClientSlim::releaseTxBuffer(char* pBuffer)
+{
+    int iIndex = _bufferIndex( pBuffer );
+    if ( iIndex < 0 )
+        return;
+
+    epicsMutexMustLock( _zcLock );
+    _lZcFree[_uZcFreeCount++] = iIndex;
+    epicsMutexUnlock( _zcLock );
+}
+
+int BldNetworkClientSlim::sendTxBuffer(char* pBuffer, int iSizeData)
+{
+    int iIndex = _bufferIndex( pBuffer );
+    if ( iIndex < 0 )
+    {
+        printf( "[Error] BldNetworkClientSlim::sendTxBuffer() : %p is not a transmit buffer\n", (void*) pBuffer );
+        return 1;
+    }
+
+    // The batch and drop-oldest queues copy into their own slots, so the buffer is free right away
+    if ( _uBatchMax > 1 || _iBpPolicy == BLD_BACKPRESSURE_DROP_OLDEST )
+    {
+        int iRetErrorCode = sendRawData( iSizeData, pBuffer );
+        releaseTxBuffer( pBuffer );
+        return iRetErrorCode;
+    }
+
+#ifdef BLD_HAVE_ZEROCOPY
+    struct iovec iov;
+    iov.iov_base = (caddr_t)(pBuffer);
+    iov.iov_len  = iSizeData;
+
     struct msghdr hdr;
     hdr.msg_iovlen      = 1;        
-    hdr.msg_name        = (sockaddr*) &sockaddrDst;
-    hdr.msg_namelen     = sizeof(sockaddrDst);
+    hdr.msg_name        = _pMsgName;
+    hdr.msg_namelen     = _uMsgNameLen;
     hdr.msg_control     = (caddr_t)0;
     hdr.msg_controllen  = 0;
-    hdr.msg_iov         = &iov[0];
+    hdr.msg_flags       = 0;
+    hdr.msg_iov         = &iov;
 
-    unsigned int uSendFlags = 0;
-try
+    // Held across sendmsg() so our sequence numbers match the kernel's
+    epicsMutexMustLock( _zcLock );
+    _reapZeroCopyLocked();
+
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+    int iStatus = sendmsg( _iSocket, &hdr, MSG_ZEROCOPY );
+    if ( iStatus == -1 && errno == ENOBUFS )
+    {
+        // Out of socket option memory for pinned pages: reap and retry once
+        _sendStats.recordLatency( ullStartNs );
+        _sendStats.recordFailure( ENOBUFS );
+        _reapZeroCopyLocked();
+        ullStartNs = BldSendStatsCounter::nowNs();
+        iStatus = sendmsg( _iSocket, &hdr, MSG_ZEROCOPY );
+    }
+    _sendStats.recordLatency( ullStartNs );
+    if ( iStatus == -1 )
+    {
+        int iErrno = errno;
+        if ( _isWouldBlock( iErrno ) && _iBpPolicy != BLD_BACKPRESSURE_BLOCK )
+        {
+            // The buffer stays leased while the policy may still send from it
+            epicsMutexUnlock( _zcLock );
+            iErrno = _sendWouldBlock( &iov, 1, iSizeData );
+            releaseTxBuffer( pBuffer );
+            return ( iErrno == 0 ? 0 : 1 );
+        }
+        _sendStats.recordFailure( iErrno );
+        _lZcFree[_uZcFreeCount++] = iIndex;
+        epicsMutexUnlock( _zcLock );
+        printf( "[Error] BldNetworkClientSlim::sendTxBuffer() : sendmsg failed, size = %d, errno = %d (%s)\n",
+          iSizeData, iErrno, strerror(iErrno) );
+        return 1;
+    }
+
+    _sendStats.recordSend( 1, iSizeData );
+    BldTxBuffer& txBuffer = _lZcBuffers[iIndex];
+    txBuffer.uSeq  = _uZcNextSeq++;
+    txBuffer.bDone = false;
+    epicsTimeGetCurrent( &txBuffer.tsSent );
+    _lZcInFlight[(_uZcInFlightHead + _zcStats.uInFlight) % uZeroCopyBuffers] = iIndex;
+    _zcStats.uZeroCopySends++;
+    if ( ++_zcStats.uInFlight > _zcStats.uInFlightMax )
+        _zcStats.uInFlightMax = _zcStats.uInFlight;
+    epicsMutexUnlock( _zcLock );
+    return 0;
+#else
+    int iRetErrorCode = sendRawData( iSizeData, pBuffer );
+    releaseTxBuffer( pBuffer );
+    return iRetErrorCode;
+#endif
+}
+
+int BldNetworkClientSlim::getZeroCopyStats(BldZeroCopyStats* pStats)
 {
-    if ( 
-      sendmsg(_iSocket, &hdr, uSendFlags) 
-      == -1 )
-        throw string("BldNetworkClientSlim::sendRawData() : sendmsg failed");                  
+    if ( !_bZeroCopy || pStats == NULL )
+        return 1;
+
+    epicsMutexMustLock( _zcLock );
+    _reapZeroCopyLocked();
+    *pStats = _zcStats;
+    pStats->dfLagAvgUs = ( _zcStats.uCompletions != 0 ? _dfZcLagSumUs / _zcStats.uCompletions : 0 );
+    epicsMutexUnlock( _zcLock );
+    return 0;
 }
-catch (string& sError)
+
+void BldNetworkClientSlim::getSendStats(BldSendStats* pStats)
 {
-    printf( "[Error] %s, size = %u, errno = %d (%s)\n", sError.c_str(), iSizeData, errno,
-      strerror(errno) );
-    printf( "[Error] %s, hdr.msg_iovlen = %zu, hdr.msg_iov->iov_len = %zu \n", sError.c_str(), hdr.msg_iovlen, hdr.msg_iov->iov_len );
-      
-    iRetErrorCode = 1;
+    _sendStats.snapshot( pStats );
 }
 
-    return iRetErrorCode;   
+void BldNetworkClientSlim::resetSendStats()
+{
+    _sendStats.reset();
+}
+
+/*
+ * private functions
+ */
+void BldNetworkClientSlim::_initZeroCopy()
+{
+    memset( &_zcStats, 0, sizeof(_zcStats) );
+#ifdef BLD_HAVE_ZEROCOPY
+    int iOne = 1;
+    if ( setsockopt( _iSocket, SOL_SOCKET, SO_ZEROCOPY, (char*)&iOne, sizeof(iOne) ) == -1 )
+    {
+        printf( "[Warning] BldNetworkClientSlim::BldNetworkClientSlim() : setsockopt(...SO_ZEROCOPY) failed, "
+          "errno = %d (%s). Zero-copy disabled.\n", errno, strerror(errno) );
+        return;
+    }
+
+    // Page aligned and locked, so pinning the pages for transmit never faults
+    const unsigned int uPageSize = (unsigned int) sysconf(_SC_PAGESIZE);
+    _uZcBufferSize = ( (_uMaxDataSize + uPageSize - 1) / uPageSize ) * uPageSize;
+    void* pPool = NULL;
+    if ( posix_memalign( &pPool, uPageSize, uZeroCopyBuffers * _uZcBufferSize ) != 0 )
+    {
+        printf( "[Warning] BldNetworkClientSlim::BldNetworkClientSlim() : buffer pool allocation failed. "
+          "Zero-copy disabled.\n" );
+        return;
+    }
+    _pZcPool = (char*) pPool;
+    if ( mlock( _pZcPool, uZeroCopyBuffers * _uZcBufferSize ) == -1 && _iDebugLevel >= 1 )
+        printf( "BldNetworkClientSlim: mlock of zero-copy pool failed, errno = %d (%s)\n", errno, strerror(errno) );
+
+    for ( unsigned int uIndex = 0; uIndex < uZeroCopyBuffers; uIndex++ )
+        _lZcFree[uIndex] = uZeroCopyBuffers - 1 - uIndex;
+    _uZcFreeCount = uZeroCopyBuffers;
+    _zcStats.dfLagMinUs = 0;
+    _bZeroCopy = true;
+#else
+    printf( "[Warning] BldNetworkClientSlim::BldNetworkClientSlim() : zero-copy is not supported on this platform\n" );
+#endif
+}
+
+int BldNetworkClientSlim::_bufferIndex(const char* pBuffer) const
+{
+    if ( _pZcPool == NULL || pBuffer < _pZcPool )
+        return -1;
+    size_t uOffset = pBuffer - _pZcPool;
+    if ( uOffset % _uZcBufferSize != 0 || uOffset / _uZcBufferSize >= uZeroCopyBuffers )
+        return -1;
+    return (int) (uOffset / _uZcBufferSize);
+}
+
+/**
+ * Drain zero-copy completion notifications from the socket error queue.
+ * Caller must hold _zcLock.
+ */
+void BldNetworkClientSlim::_reapZeroCopyLocked()
+{
+#ifdef BLD_HAVE_ZEROCOPY
+    while ( _zcStats.uInFlight != 0 )
+    {
+        char lcControl[128];
+        struct msghdr hdr;
+        memset( &hdr, 0, sizeof(hdr) );
+        hdr.msg_control     = lcControl;
+        hdr.msg_controllen  = sizeof(lcControl);
+
+        if ( recvmsg( _iSocket, &hdr, MSG_ERRQUEUE | MSG_DONTWAIT ) == -1 )
+            break; // EAGAIN: nothing more to reap
+
+        for ( struct cmsghdr* pCmsg = CMSG_FIRSTHDR(&hdr); pCmsg != NULL; pCmsg = CMSG_NXTHDR(&hdr, pCmsg) )
+        {
+            if ( pCmsg->cmsg_level != IPPROTO_IP || pCmsg->cmsg_type != IP_RECVERR )
+                continue;
+            const struct sock_extended_err* pErr = (const struct sock_extended_err*) CMSG_DATA(pCmsg);
+            if ( pErr->ee_errno != 0 || pErr->ee_origin != SO_EE_ORIGIN_ZEROCOPY )
+                continue;
+            _completeZeroCopyLocked( pErr->ee_info, pErr->ee_data,
+              (pErr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0 );
+        }
+    }
+#endif
+}
+
+/**
+ * Mark sends uSeqLo..uSeqHi (inclusive) complete and return finished buffers
+ * to the pool in send order. Caller must hold _zcLock.
+ */
+void BldNetworkClientSlim::_completeZeroCopyLocked(unsigned int uSeqLo, unsigned int uSeqHi, bool bCopied)
+{
+    epicsTimeStamp tsNow;
+    epicsTimeGetCurrent( &tsNow );
+
+    for ( unsigned int uPos = 0; uPos < _zcStats.uInFlight; uPos++ )
+    {
+        BldTxBuffer& txBuffer = _lZcBuffers[ _lZcInFlight[(_uZcInFlightHead + uPos) % uZeroCopyBuffers] ];
+        if ( txBuffer.bDone || txBuffer.uSeq - uSeqLo > uSeqHi - uSeqLo ) // unsigned: handles wrap
+            continue;
+
+        txBuffer.bDone = true;
+        double dfLagUs = epicsTimeDiffInSeconds( &tsNow, &txBuffer.tsSent ) * 1e6;
+        if ( _zcStats.uCompletions == 0 || dfLagUs < _zcStats.dfLagMinUs )
+            _zcStats.dfLagMinUs = dfLagUs;
+        if ( dfLagUs > _zcStats.dfLagMaxUs )
+            _zcStats.dfLagMaxUs = dfLagUs;
+        _dfZcLagSumUs += dfLagUs;
+        _zcStats.uCompletions++;
+        if ( bCopied )
+            _zcStats.uCopied++;
+    }
+
+    while ( _zcStats.uInFlight != 0 && _lZcBuffers[ _lZcInFlight[_uZcInFlightHead] ].bDone )
+    {
+        _lZcFree[_uZcFreeCount++] = _lZcInFlight[_uZcInFlightHead];
+        _uZcInFlightHead = (_uZcInFlightHead + 1) % uZeroCopyBuffers;
+        _zcStats.uInFlight--;
+    }
+}
+
+void BldNetworkClientSlim::_freeBatch()
+{
+    delete [] _pBatchBuffer;
+    delete [] _pBatchIov;
+    delete [] _pBatchMsgs;
+    _pBatchBuffer = NULL;
+    _pBatchIov    = NULL;
+    _pBatchMsgs   = NULL;
+    _uBatchCount  = 0;
+}
+
+/**
+ * One sendmsg() of a datagram, timed in _sendStats. A full socket buffer is
+ * not counted as a failure here unless the socket blocks, the policy decides.
+ *
+ * @return  0 if successful, otherwise the errno value
+ */
+int BldNetworkClientSlim::_sendOne(const struct iovec* pIov, int iIovCount, size_t uSizeData)
+{
+    struct msghdr hdr;
+    hdr.msg_iovlen      = iIovCount;        
+    hdr.msg_name        = _pMsgName;
+    hdr.msg_namelen     = _uMsgNameLen;
+    hdr.msg_control     = (caddr_t)0;
+    hdr.msg_controllen  = 0;
+    hdr.msg_flags       = 0;
+    hdr.msg_iov         = const_cast<struct iovec*>(pIov);
+
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+    int iErrno = ( sendmsg( _iSocket, &hdr, 0 ) == -1 ? errno : 0 );
+    _sendStats.recordLatency( ullStartNs );
+    if ( iErrno == 0 )
+        _sendStats.recordSend( 1, uSizeData );
+    else if ( !_isWouldBlock( iErrno ) || _iBpPolicy == BLD_BACKPRESSURE_BLOCK )
+        _sendStats.recordFailure( iErrno );
+    return iErrno;
+}
+
+int BldNetworkClientSlim::_sendWouldBlock(const struct iovec* pIov, int iIovCount, size_t uSizeData)
+{
+    epicsMutexMustLock( _bpLock );
+    int iErrno = _backpressureLocked( pIov, iIovCount, uSizeData );
+    epicsMutexUnlock( _bpLock );
+    return iErrno;
+}
+
+/**
+ * Apply the backpressure policy to a datagram that cannot be sent right now.
+ * Caller must hold _bpLock.
+ *
+ * @return  0 if it was sent or parked, otherwise the errno value it was dropped with
+ */
+int BldNetworkClientSlim::_backpressureLocked(const struct iovec* pIov, int iIovCount, size_t uSizeData)
+{
+    _bpStats.uWouldBlock++;
+
+    if ( _iBpPolicy == BLD_BACKPRESSURE_DROP_OLDEST && _pBpQueue != NULL )
+        return _parkLocked( pIov, iIovCount, uSizeData );
+
+    if ( _iBpPolicy == BLD_BACKPRESSURE_SPIN )
+    {
+        unsigned long long ullDeadlineNs = BldSendStatsCounter::nowNs() + _uBpSpinUs * 1000ULL;
+        do
+        {
+            _bpStats.uSpins++;
+            int iErrno = _sendOne( pIov, iIovCount, uSizeData );
+            if ( iErrno == 0 )
+            {
+                _bpStats.uSpinSent++;
+                return 0;
+            }
+            if ( !_isWouldBlock( iErrno ) )
+                return iErrno;
+        } while ( BldSendStatsCounter::nowNs() < ullDeadlineNs );
+
+        _bpStats.uSpinTimeouts++;
+        _sendStats.recordFailure( EAGAIN );
+        return EAGAIN;
+    }
+
+    _bpStats.uDropNewest++;
+    _sendStats.recordFailure( EAGAIN );
+    return EAGAIN;
+}
+
+/**
+ * Copy a datagram into the drop-oldest queue. Caller must hold _bpLock.
+ */
+int BldNetworkClientSlim::_parkLocked(const struct iovec* pIov, int iIovCount, size_t uSizeData)
+{
+    if ( uSizeData > _uMaxDataSize )
+    {
+        _sendStats.recordFailure( EMSGSIZE );
+        return EMSGSIZE;
+    }
+
+    if ( _uBpQueueCount == _uBpQueueDepth )
+    {
+        // Full: the oldest parked packet makes room
+        _uBpQueueHead = ( _uBpQueueHead + 1 ) % _uBpQueueDepth;
+        _uBpQueueCount--;
+        _bpStats.uDropOldest++;
+        _sendStats.recordFailure( EAGAIN );
+    }
+
+    unsigned int uSlot = ( _uBpQueueHead + _uBpQueueCount ) % _uBpQueueDepth;
+    char* pSlot = _pBpQueue + uSlot * _uMaxDataSize;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+    {
+        memcpy( pSlot, pIov[iIov].iov_base, pIov[iIov].iov_len );
+        pSlot += pIov[iIov].iov_len;
+    }
+    _puBpQueueLen[uSlot] = uSizeData;
+
+    _bpStats.uQueued++;
+    if ( ++_uBpQueueCount > _bpStats.uQueueHighWater )
+        _bpStats.uQueueHighWater = _uBpQueueCount;
+    return 0;
+}
+
+/**
+ * Send parked packets, oldest first, until the socket buffer is full.
+ * Caller must hold _bpLock.
+ *
+ * @return  true if none are left
+ */
+bool BldNetworkClientSlim::_drainLocked()
+{
+    while ( _uBpQueueCount != 0 )
+    {
+        struct iovec iov;
+        iov.iov_base = (caddr_t)(_pBpQueue + _uBpQueueHead * _uMaxDataSize);
+        iov.iov_len  = _puBpQueueLen[_uBpQueueHead];
+
+        int iErrno = _sendOne( &iov, 1, iov.iov_len );
+        if ( _isWouldBlock( iErrno ) && _iBpPolicy != BLD_BACKPRESSURE_BLOCK )
+            return false;
+
+        // Sent, or failed for good and counted in _sendStats
+        if ( iErrno == 0 )
+            _bpStats.uQueueSent++;
+        _uBpQueueHead = ( _uBpQueueHead + 1 ) % _uBpQueueDepth;
+        _uBpQueueCount--;
+    }
+    return true;
+}
+
+/**
+ * Hand the rest of a burst to the backpressure policy
+ */
+int BldNetworkClientSlim::_burstBackpressure(const char* pData, int iSegmentSize, int iSegmentCount)
+{
+    unsigned long uDropped = 0;
+
+    epicsMutexMustLock( _bpLock );
+    for ( int iSegment = 0; iSegment < iSegmentCount; iSegment++ )
+    {
+        struct iovec iov;
+        iov.iov_base = (caddr_t)(pData + iSegment * iSegmentSize);
+        iov.iov_len  = iSegmentSize;
+        if ( _backpressureLocked( &iov, 1, iSegmentSize ) != 0 )
+            uDropped++;
+    }
+    epicsMutexUnlock( _bpLock );
+
+    epicsMutexMustLock( _batchLock );
+    _batchStats.uPktsDropped += uDropped;
+    epicsMutexUnlock( _batchLock );
+    return ( uDropped != 0 ? 1 : 0 );
+}
+
+/**
+ * Hand the rest of a multi-packet send to the backpressure policy
+ */
+int BldNetworkClientSlim::_batchBackpressure(const struct iovec* pIov, int iIovPerPacket, int iPacketCount)
+{
+    unsigned long uDropped = 0;
+
+    epicsMutexMustLock( _bpLock );
+    for ( int iPacket = 0; iPacket < iPacketCount; iPacket++ )
+    {
+        const struct iovec* pPacketIov = pIov + iPacket * iIovPerPacket;
+        size_t uSizeData = 0;
+        for ( int iIov = 0; iIov < iIovPerPacket; iIov++ )
+            uSizeData += pPacketIov[iIov].iov_len;
+        if ( _backpressureLocked( pPacketIov, iIovPerPacket, uSizeData ) != 0 )
+            uDropped++;
+    }
+    epicsMutexUnlock( _bpLock );
+
+    epicsMutexMustLock( _batchLock );
+    _batchStats.uPktsDropped += uDropped;
+    epicsMutexUnlock( _batchLock );
+    return ( uDropped != 0 ? 1 : 0 );
+}
+
+void BldNetworkClientSlim::_freeBpQueue()
+{
+    delete [] _pBpQueue;
+    delete [] _puBpQueueLen;
+    _pBpQueue      = NULL;
+    _puBpQueueLen  = NULL;
+    _uBpQueueDepth = 0;
+    _uBpQueueHead  = 0;
+    _uBpQueueCount = 0;
+}
+
+/**
+ * Send the queued packets. Caller must hold _batchLock.
+ */
+int BldNetworkClientSlim::_flushLocked(EFlushReason eReason)
+{
+    if ( _uBatchCount == 0 )
+        return 0;
+
+    int iRetErrorCode = 0;
+    unsigned int uSent = 0;
+
+    // Under drop-oldest the batch may not overtake parked packets
+    const bool bBpLocked = ( _iBpPolicy == BLD_BACKPRESSURE_DROP_OLDEST );
+    if ( bBpLocked )
+        epicsMutexMustLock( _bpLock );
+    bool bFull = ( bBpLocked && !_drainLocked() );
+
+    while ( !bFull && uSent < _uBatchCount )
+    {
+        unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+#ifdef BLD_HAVE_SENDMMSG
+        int iSent = sendmmsg( _iSocket, &_pBatchMsgs[uSent], _uBatchCount - uSent, 0 );
+#else
+        int iSent = ( sendmsg( _iSocket, &_pBatchMsgs[uSent].msg_hdr, 0 ) == -1 ? -1 : 1 );
+#endif
+        int iErrno = errno;
+        _sendStats.recordLatency( ullStartNs );
+        _batchStats.uSendCalls++;
+        if ( iSent <= 0 && _isWouldBlock( iErrno ) && _iBpPolicy != BLD_BACKPRESSURE_BLOCK )
+        {
+            bFull = true;
+            break;
+        }
+        if ( iSent <= 0 )
+        {
+            _sendStats.recordFailure( iErrno );
+            // The first packet of the remainder failed, skip it and keep going
+            printf( "[Error] BldNetworkClientSlim::flush() : send failed, size = %zu, errno = %d (%s)\n",
+              _pBatchIov[uSent].iov_len, iErrno, strerror(iErrno) );
+            _batchStats.uPktsDropped++;
+            iRetErrorCode = 1;
+            uSent++;
+            continue;
+        }
+        size_t uBytes = 0;
+        for ( int iMsg = 0; iMsg < iSent; iMsg++ )
+            uBytes += _pBatchIov[uSent + iMsg].iov_len;
+        _sendStats.recordSend( iSent, uBytes );
+
+        _batchStats.uPktsSent += iSent;
+        uSent += iSent;
+    }
+
+    if ( bFull )
+    {
+        // The socket buffer is full, the policy decides for the rest of the batch
+        if ( !bBpLocked )
+            epicsMutexMustLock( _bpLock );
+        for ( ; uSent < _uBatchCount; uSent++ )
+        {
+            if ( _backpressureLocked( &_pBatchIov[uSent], 1, _pBatchIov[uSent].iov_len ) != 0 )
+            {
+                _batchStats.uPktsDropped++;
+                iRetErrorCode = 1;
+            }
+        }
+        if ( !bBpLocked )
+            epicsMutexUnlock( _bpLock );
+    }
+    if ( bBpLocked )
+        epicsMutexUnlock( _bpLock );
+
+    _batchStats.uBatches++;
+    if ( _uBatchCount > _batchStats.uMaxBatch )
+        _batchStats.uMaxBatch = _uBatchCount;
+    switch ( eReason )
+    {
+    case FLUSH_COUNT:       _batchStats.uFlushByCount++;    break;
+    case FLUSH_DEADLINE:    _batchStats.uFlushByDeadline++; break;
+    case FLUSH_EXPLICIT:    _batchStats.uFlushExplicit++;   break;
+    case FLUSH_RING_FULL:   _batchStats.uFlushByRingFull++; break;
+    }
+
+    _uBatchCount = 0;
+    return iRetErrorCode;
+}
+
+/**
+ * Send a burst as UDP GSO super-buffers, falling back to sendmmsg()
+ * for the remainder if the kernel or device turns out not to support it.
+ */
+int BldNetworkClientSlim::_sendBurstGso(const char* pData, int iSegmentSize, int iSegmentCount)
+{
+#ifdef BLD_HAVE_GSO
+    int iSegmentsPerSend = uGsoMaxBytes / iSegmentSize;
+    if ( iSegmentsPerSend > uGsoMaxSegments )
+        iSegmentsPerSend = uGsoMaxSegments;
+
+    union
+    {
+        char            lcBuffer[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr  align;
+    } control;
+
+    int iSegment = 0;
+    while ( iSegment < iSegmentCount )
+    {
+        int iSegments = iSegmentCount - iSegment;
+        if ( iSegments > iSegmentsPerSend )
+            iSegments = iSegmentsPerSend;
+
+        struct iovec iov;
+        iov.iov_base = (caddr_t)(pData + iSegment * iSegmentSize);
+        iov.iov_len  = iSegments * iSegmentSize;
+
+        struct msghdr hdr;
+        hdr.msg_iovlen      = 1;        
+        hdr.msg_name        = _pMsgName;
+        hdr.msg_namelen     = _uMsgNameLen;
+        hdr.msg_iov         = &iov;
+        hdr.msg_flags       = 0;
+        hdr.msg_control     = control.lcBuffer;
+        hdr.msg_controllen  = sizeof(control.lcBuffer);
+
+        struct cmsghdr* pCmsg = CMSG_FIRSTHDR(&hdr);
+        pCmsg->cmsg_level   = SOL_UDP;
+        pCmsg->cmsg_type    = UDP_SEGMENT;
+        pCmsg->cmsg_len     = CMSG_LEN(sizeof(uint16_t));
+        *(uint16_t*) CMSG_DATA(pCmsg) = (uint16_t) iSegmentSize;
+
+        unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+        int iStatus = sendmsg( _iSocket, &hdr, 0 );
+        _sendStats.recordLatency( ullStartNs );
+        if ( iStatus == -1 )
+        {
+            if ( _isWouldBlock( errno ) && _iBpPolicy != BLD_BACKPRESSURE_BLOCK )
+                return _burstBackpressure( pData + iSegment * iSegmentSize, iSegmentSize, iSegmentCount - iSegment );
+
+            if ( errno != EIO && errno != EINVAL && errno != ENOPROTOOPT && errno != EOPNOTSUPP )
+            {
+                _sendStats.recordFailure( errno, iSegments );
+                printf( "[Error] BldNetworkClientSlim::sendBurst() : sendmsg failed, size = %zu, errno = %d (%s)\n",
+                  (size_t) iov.iov_len, errno, strerror(errno) );
+                epicsMutexMustLock( _batchLock );
+                _batchStats.uPktsDropped += iSegments;
+                epicsMutexUnlock( _batchLock );
+                return 1;
+            }
+
+            // EIO: the egress device cannot checksum GSO segments
+            printf( "[Warning] BldNetworkClientSlim::sendBurst() : UDP GSO rejected, errno = %d (%s). "
+              "Using sendmmsg() from now on.\n", errno, strerror(errno) );
+            _bGso = false;
+            return _sendBurstMmsg( pData + iSegment * iSegmentSize, iSegmentSize, iSegmentCount - iSegment );
+        }
+
+        _sendStats.recordSend( iSegments, iov.iov_len );
+        epicsMutexMustLock( _batchLock );
+        _batchStats.uGsoSends++;
+        _batchStats.uSendCalls++;
+        _batchStats.uPktsSent  += iSegments;
+        _batchStats.uBurstPkts += iSegments;
+        epicsMutexUnlock( _batchLock );
+        iSegment += iSegments;
+    }
+    return 0;
+#else
+    return _sendBurstMmsg( pData, iSegmentSize, iSegmentCount );
+#endif
+}
+
+/**
+ * Send a burst with sendmmsg(), up to uMaxBatchLimit datagrams per call
+ */
+int BldNetworkClientSlim::_sendBurstMmsg(const char* pData, int iSegmentSize, int iSegmentCount)
+{
+    struct iovec    lIov[uMaxBatchLimit];
+    BldMsgEntry     lMsgs[uMaxBatchLimit];
+
+    int iRetErrorCode = 0;
+    int iSegment = 0;
+    while ( iSegment < iSegmentCount )
+    {
+        int iSegments = iSegmentCount - iSegment;
+        if ( iSegments > uMaxBatchLimit )
+            iSegments = uMaxBatchLimit;
+
+        memset( lMsgs, 0, iSegments * sizeof(BldMsgEntry) );
+        for ( int iMsg = 0; iMsg < iSegments; iMsg++ )
+        {
+            lIov[iMsg].iov_base = (caddr_t)(pData + (iSegment + iMsg) * iSegmentSize);
+            lIov[iMsg].iov_len  = iSegmentSize;
+
+            struct msghdr& hdr  = lMsgs[iMsg].msg_hdr;
+            hdr.msg_name        = _pMsgName;
+            hdr.msg_namelen     = _uMsgNameLen;
+            hdr.msg_iov         = &lIov[iMsg];
+            hdr.msg_iovlen      = 1;
+        }
+
+        int iMsg = 0;
+        while ( iMsg < iSegments )
+        {
+            unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+#ifdef BLD_HAVE_SENDMMSG
+            int iSent = sendmmsg( _iSocket, &lMsgs[iMsg], iSegments - iMsg, 0 );
+#else
+            int iSent = ( sendmsg( _iSocket, &lMsgs[iMsg].msg_hdr, 0 ) == -1 ? -1 : 1 );
+#endif
+            int iErrno = errno;
+            _sendStats.recordLatency( ullStartNs );
+            if ( iSent <= 0 && _isWouldBlock( iErrno ) && _iBpPolicy != BLD_BACKPRESSURE_BLOCK )
+            {
+                epicsMutexMustLock( _batchLock );
+                _batchStats.uSendCalls++;
+                epicsMutexUnlock( _batchLock );
+                int iRest = iSegment + iMsg;
+                return _burstBackpressure( pData + iRest * iSegmentSize, iSegmentSize, iSegmentCount - iRest )
+                  | iRetErrorCode;
+            }
+            if ( iSent <= 0 )
+                _sendStats.recordFailure( iErrno );
+            else
+                _sendStats.recordSend( iSent, iSent * iSegmentSize );
+            epicsMutexMustLock( _batchLock );
+            _batchStats.uSendCalls++;
+            if ( iSent <= 0 )
+            {
+                // Skip the packet that failed and keep going, as flush() does
+                _batchStats.uPktsDropped++;
+                epicsMutexUnlock( _batchLock );
+                printf( "[Error] BldNetworkClientSlim::sendBurst() : send failed, size = %d, errno = %d (%s)\n",
+                  iSegmentSize, iErrno, strerror(iErrno) );
+                iRetErrorCode = 1;
+                iMsg++;
+                continue;
+            }
+            _batchStats.uPktsSent  += iSent;
+            _batchStats.uBurstPkts += iSent;
+            epicsMutexUnlock( _batchLock );
+            iMsg += iSent;
+        }
+        iSegment += iSegments;
+    }
+    return iRetErrorCode;
+}
+
+/**
+ * Send gathered datagrams with sendmmsg(), up to uMaxBatchLimit per call
+ */
+int BldNetworkClientSlim::_sendBatchMmsg(const struct iovec* pIov, int iIovPerPacket, int iPacketCount)
+{
+    BldMsgEntry     lMsgs[uMaxBatchLimit];
+    size_t          luSizeData[uMaxBatchLimit];
+
+    int iRetErrorCode = 0;
+    int iPacket = 0;
+    while ( iPacket < iPacketCount )
+    {
+        int iPackets = iPacketCount - iPacket;
+        if ( iPackets > uMaxBatchLimit )
+            iPackets = uMaxBatchLimit;
+
+        memset( lMsgs, 0, iPackets * sizeof(BldMsgEntry) );
+        for ( int iMsg = 0; iMsg < iPackets; iMsg++ )
+        {
+            const struct iovec* pPacketIov = pIov + (iPacket + iMsg) * iIovPerPacket;
+            luSizeData[iMsg] = 0;
+            for ( int iIov = 0; iIov < iIovPerPacket; iIov++ )
+                luSizeData[iMsg] += pPacketIov[iIov].iov_len;
+
+            struct msghdr& hdr  = lMsgs[iMsg].msg_hdr;
+            hdr.msg_name        = _pMsgName;
+            hdr.msg_namelen     = _uMsgNameLen;
+            hdr.msg_iov         = (struct iovec*) pPacketIov;
+            hdr.msg_iovlen      = iIovPerPacket;
+        }
+
+        int iMsg = 0;
+        while ( iMsg < iPackets )
+        {
+            unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+#ifdef BLD_HAVE_SENDMMSG
+            int iSent = sendmmsg( _iSocket, &lMsgs[iMsg], iPackets - iMsg, 0 );
+#else
+            int iSent = ( sendmsg( _iSocket, &lMsgs[iMsg].msg_hdr, 0 ) == -1 ? -1 : 1 );
+#endif
+            int iErrno = errno;
+            _sendStats.recordLatency( ullStartNs );
+            if ( iSent <= 0 && _isWouldBlock( iErrno ) && _iBpPolicy != BLD_BACKPRESSURE_BLOCK )
+            {
+                epicsMutexMustLock( _batchLock );
+                _batchStats.uSendCalls++;
+                epicsMutexUnlock( _batchLock );
+                int iRest = iPacket + iMsg;
+                return _batchBackpressure( pIov + iRest * iIovPerPacket, iIovPerPacket, iPacketCount - iRest )
+                  | iRetErrorCode;
+            }
+            if ( iSent <= 0 )
+                _sendStats.recordFailure( iErrno );
+            else
+            {
+                size_t uBytes = 0;
+                for ( int iDone = iMsg; iDone < iMsg + iSent; iDone++ )
+                    uBytes += luSizeData[iDone];
+                _sendStats.recordSend( iSent, uBytes );
+            }
+            epicsMutexMustLock( _batchLock );
+            _batchStats.uSendCalls++;
+            if ( iSent <= 0 )
+            {
+                // Skip the packet that failed and keep going, as flush() does
+                _batchStats.uPktsDropped++;
+                epicsMutexUnlock( _batchLock );
+                printf( "[Error] BldNetworkClientSlim::sendRawDataVBatch() : send failed, size = %zu, errno = %d (%s)\n",
+                  luSizeData[iMsg], iErrno, strerror(iErrno) );
+                iRetErrorCode = 1;
+                iMsg++;
+                continue;
+            }
+            _batchStats.uPktsSent += iSent;
+            epicsMutexUnlock( _batchLock );
+            iMsg += iSent;
+        }
+        iPacket += iPackets;
+    }
+    return iRetErrorCode;
 }
 
 /*
  * private static functions
  */
+void BldNetworkClientSlim::_batchDeadlineCallback(void* pArg)
+{
+    BldNetworkClientSlim* pClient = static_cast<BldNetworkClientSlim*>(pArg);
+
+    epicsMutexMustLock( pClient->_batchLock );
+    if ( pClient->_uBatchCount != 0 )
+    {
+        // A count flush may have emptied and restarted the batch after
+        // this expiry was scheduled, so check the age of the current one
+        epicsTimeStamp tsNow;
+        epicsTimeGetCurrent( &tsNow );
+        double dfAge  = epicsTimeDiffInSeconds( &tsNow, &pClient->_tsBatchFirst );
+        double dfLeft = pClient->_uBatchDeadlineUs * 1e-6 - dfAge;
+        if ( dfLeft > 0 )
+            epicsTimerStartDelay( pClient->_batchTimer, dfLeft );
+        else
+            pClient->_flushLocked( FLUSH_DEADLINE );
+    }
+    epicsMutexUnlock( pClient->_batchLock );
+}
+
 string BldNetworkClientSlim::addressToStr( unsigned int uAddr )
 {
     unsigned int uNetworkAddr = htonl(uAddr);
@@ -1,8 +1,76 @@
 #ifndef MULTICAST_BLD_LIB_H
 #define MULTICAST_BLD_LIB_H
 
+#include <sys/uio.h>
+
+#include "bldSendStats.h"
+
 namespace EpicsBld
 {   
+/**
+ * Batch transmit counters
+ *
+ * Filled in by BldNetworkClientInterface::getBatchStats(). The ratio of
+ * uPktsSent to uSendCalls is the number of datagrams per syscall.
+ */
+struct BldBatchStats
+{
+    unsigned long   uPktsQueued;        /// packets accepted into the batch queue
+    unsigned long   uPktsSent;          /// packets accepted by the kernel
+    unsigned long   uPktsDropped;       /// packets lost to oversize or send errors
+    unsigned long   uBatches;           /// non-empty flushes
+    unsigned long   uSendCalls;         /// sendmmsg() (or sendmsg() fallback) calls
+    unsigned long   uFlushByCount;      /// flushes triggered by the count threshold
+    unsigned long   uFlushByDeadline;   /// flushes triggered by the deadline timer
+    unsigned long   uFlushExplicit;     /// flushes requested through flush()
+    unsigned long   uFlushByRingFull;   /// io_uring flushes forced by running out of send slots
+    unsigned int    uMaxBatch;          /// largest batch flushed so far
+    unsigned long   uBursts;            /// sendBurst() calls
+    unsigned long   uBurstPkts;         /// packets sent by sendBurst()
+    unsigned long   uGsoSends;          /// UDP_SEGMENT sendmsg() calls made by sendBurst()
+};
+
+/**
+ * Zero-copy transmit counters
+ *
+ * Filled in by BldNetworkClientInterface::getZeroCopyStats(). Completion lag
+ * is the time from sendmsg() until the kernel's completion notification was
+ * reaped and the buffer returned to the pool.
+ */
+struct BldZeroCopyStats
+{
+    unsigned long   uZeroCopySends;     /// sendmsg(MSG_ZEROCOPY) calls accepted by the kernel
+    unsigned long   uCompletions;       /// buffers released by completion notifications
+    unsigned long   uCopied;            /// completions where the kernel fell back to copying
+    unsigned long   uPoolExhausted;     /// acquireTxBuffer() calls that found no free buffer
+    unsigned int    uInFlight;          /// buffers currently owned by the kernel
+    unsigned int    uInFlightMax;       /// high-water mark of uInFlight
+    double          dfLagMinUs;         /// completion lag, in microseconds
+    double          dfLagMaxUs;
+    double          dfLagAvgUs;
+};
+
+/**
+ * Backpressure counters
+ *
+ * Filled in by BldNetworkClientInterface::getBackpressureStats(). Every
+ * packet that could not be sent right away is counted in uWouldBlock, the
+ * other fields record what the BLD_BACKPRESSURE_* policy then did with it.
+ */
+struct BldBackpressureStats
+{
+    unsigned long   uWouldBlock;        /// packets that found the socket buffer full (or parked packets ahead)
+    unsigned long   uDropNewest;        /// packets dropped by the drop-newest policy
+    unsigned long   uQueued;            /// packets parked in the drop-oldest queue
+    unsigned long   uQueueSent;         /// parked packets sent later
+    unsigned long   uDropOldest;        /// parked packets overwritten by newer ones
+    unsigned int    uQueueHighWater;    /// most packets parked at once
+    unsigned long   uSpins;             /// send retries made by the spin policy
+    unsigned long   uSpinSent;          /// packets sent after spinning
+    unsigned long   uSpinTimeouts;      /// packets dropped when the spin budget ran out
+    unsigned int    uSndBufBytes;       /// SO_SNDBUF as reported by the kernel
+};
+
 /**
  * Abastract Interface of Bld Multicast Client 
  * 
@@ -22,6 +90,121 @@ public:
      * @return  0 if successful,  otherwise the "errno" code (see <errno.h>)
      */
     virtual int sendRawData(int iSizeData, const char* pData) = 0;
+
+    /**
+     * Send one datagram gathered from several buffers
+     *
+     * Lets callers pass a packet header and its payload separately, so the
+     * payload goes to the kernel without being copied into a staging buffer.
+     *
+     * @param pIov       buffers making up the datagram, in order
+     * @param iIovCount  number of entries in pIov
+     * @return  0 if successful, otherwise non-zero
+     */
+    virtual int sendRawDataV(const struct iovec* pIov, int iIovCount) = 0;
+
+    /**
+     * Enable or disable batch transmit mode
+     *
+     * In batch mode sendRawData() copies the datagram into an internal queue,
+     * which is sent with one sendmmsg() call when uMaxBatch packets are queued,
+     * when the oldest queued packet is uDeadlineUs old, or when flush() is called.
+     *
+     * @param uMaxBatch    packets per batch, 0 or 1 disables batching
+     * @param uDeadlineUs  max time (in microseconds) a packet may wait, 0 for no deadline
+     * @return  0 if successful, otherwise non-zero
+     */
+    virtual int setBatchMode(unsigned int uMaxBatch, unsigned int uDeadlineUs) = 0;
+
+    /**
+     * Send all queued packets now
+     *
+     * @return  0 if successful, otherwise non-zero
+     */
+    virtual int flush() = 0;
+
+    /**
+     * Send a burst of equal-size datagrams from one contiguous buffer
+     *
+     * Where the kernel supports UDP GSO the burst is handed over as one
+     * super-buffer per sendmsg(UDP_SEGMENT) call and split into datagrams
+     * below the socket layer. Otherwise it falls back to sendmmsg(). Any
+     * packets queued in batch mode are flushed first to keep the order.
+     *
+     * @param pData          iSegmentCount packets of iSegmentSize bytes, back to back
+     * @param iSegmentSize   size of each datagram (in bytes), at most uMaxDataSize
+     * @param iSegmentCount  number of datagrams
+     * @return  0 if successful, otherwise non-zero
+     */
+    virtual int sendBurst(const char* pData, int iSegmentSize, int iSegmentCount) = 0;
+
+    /**
+     * Send several datagrams, each gathered from the same number of buffers
+     *
+     * Unlike sendBurst() the datagrams may differ in size, so they cannot be
+     * segmented by the kernel; they are handed over together with sendmmsg(),
+     * or as one io_uring submission. Packets queued in batch mode go first.
+     *
+     * @param pIov            iIovPerPacket entries per datagram, iPacketCount datagrams back to back
+     * @param iIovPerPacket   number of buffers making up each datagram
+     * @param iPacketCount    number of datagrams
+     * @return  0 if successful, otherwise non-zero
+     */
+    virtual int sendRawDataVBatch(const struct iovec* pIov, int iIovPerPacket, int iPacketCount) = 0;
+
+    // batch transmit statistics
+    virtual void getBatchStats(BldBatchStats* pStats) = 0;
+    virtual void resetBatchStats() = 0;
+
+    /**
+     * Choose what a send does when the socket buffer is full
+     *
+     * Any policy other than BLD_BACKPRESSURE_BLOCK makes the socket
+     * non-blocking, so the calling (scan) thread never waits in the kernel.
+     *
+     * @param iPolicy         BLD_BACKPRESSURE_* policy
+     * @param uSndBufPackets  size SO_SNDBUF for this many max-size packets, 0 leaves it unchanged
+     * @param uPolicyArg      queue depth in packets for drop-oldest, spin budget in
+     *                        microseconds for spin, 0 for the default; unused otherwise
+     * @return  0 if successful, otherwise non-zero
+     */
+    virtual int setBackpressure(int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg) = 0;
+
+    // backpressure statistics
+    virtual void getBackpressureStats(BldBackpressureStats* pStats) = 0;
+    virtual void resetBackpressureStats() = 0;
+
+    /**
+     * Get a client-owned transmit buffer to build a packet in place
+     *
+     * Only available in zero-copy mode (BLD_NETWORK_ZEROCOPY), where the
+     * buffer comes from a pool of pinned buffers that the kernel transmits
+     * from directly. Every buffer returned must be passed to either
+     * sendTxBuffer() or releaseTxBuffer().
+     *
+     * @param uSize  bytes needed, at most the client's uMaxDataSize
+     * @return  the buffer, or NULL if zero-copy is off or all buffers are in flight
+     */
+    virtual char* acquireTxBuffer(unsigned int uSize) = 0;
+
+    /**
+     * Send a buffer obtained from acquireTxBuffer()
+     *
+     * The buffer returns to the pool once the kernel reports it is done with it.
+     *
+     * @return  0 if successful, otherwise non-zero
+     */
+    virtual int sendTxBuffer(char* pBuffer, int iSizeData) = 0;
+
+    /// Return an unsent buffer obtained from acquireTxBuffer()
+    virtual void releaseTxBuffer(char* pBuffer) = 0;
+
+    // zero-copy statistics, returns non-zero if zero-copy mode is off
+    virtual int getZeroCopyStats(BldZeroCopyStats* pStats) = 0;
+
+    // packets, bytes, failures by errno and send syscall latency
+    virtual void getSendStats(BldSendStats* pStats) = 0;
+    virtual void resetSendStats() = 0;
     
     // debug information control
     virtual void setDebugLevel(int iDebugLevel) = 0;
@@ -55,11 +238,12 @@ public:
      * @param uMaxDataSize  Maximum Bld data size. Better to be less than MTU.
      * @param ucTTL         TTL value in UDP packet. Ideal value is 1 + (# of middle routers)
      * @param sInteraceIp   Specify the NIC by IP address (in c string format)
+     * @param uFlags        BLD_NETWORK_* option flags
      * @return              The created Bld Client object
      */
     static BldNetworkClientInterface* createBldNetworkClient(unsigned int uAddr, 
       unsigned short uPort, unsigned int uMaxDataSize, unsigned char ucTTL = 32, 
-      const char* sInteraceIp = 0);
+      const char* sInteraceIp = 0, unsigned int uFlags = 0);
         
     /**
      * Create a Bld Client object
@@ -69,7 +253,44 @@ public:
      */
     static BldNetworkClientInterface* createBldNetworkClient(unsigned int uAddr, 
       unsigned short uPort, unsigned int uMaxDataSize, unsigned char ucTTL = 32, 
-      unsigned int uInteraceIp = 0);
+      unsigned int uInteraceIp = 0, unsigned int uFlags = 0);
+
+    /**
+     * Transport registry
+     *
+     * A transport decides where a client's packets go. Built in are "udp"
+     * (the multicast client above), "null", "memory" and "file"; see
+     * bldTransport.h. Drivers may register more.
+     */
+    typedef BldNetworkClientInterface* (*TransportCreator)(unsigned int uAddr,
+      unsigned short uPort, unsigned int uMaxDataSize, unsigned char ucTTL,
+      unsigned int uInterfaceIp, unsigned int uFlags, const char* sArg);
+
+    /**
+     * Add a transport, or replace the one with the same name
+     *
+     * @param sName         name used in createBldTransport()
+     * @param pfCreate      creates a client, sArg is the text after "name:" (may be empty)
+     * @param sDescription  one line shown by showTransports()
+     * @return              0 if successful, otherwise non-zero
+     */
+    static int registerTransport(const char* sName, TransportCreator pfCreate,
+      const char* sDescription);
+
+    /**
+     * Create a Bld Client object for a named transport
+     *
+     * @param sTransport    "name" or "name:arg", e.g. "memory:256" or "file:/tmp/bld.dat".
+     *                      NULL or empty means "udp"
+     * @return              The created Bld Client object, NULL if the transport
+     *                      is unknown or could not be created
+     */
+    static BldNetworkClientInterface* createBldTransport(const char* sTransport,
+      unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize,
+      unsigned char ucTTL = 32, const char* sInteraceIp = 0, unsigned int uFlags = 0);
+
+    /// Print the registered transports
+    static void showTransports();
 private:
     /// Disable object instantiation (No object semantics).
     BldNetworkClientFactory();
@@ -79,6 +300,23 @@ private:
 
 extern "C"
 {
+/*
+ * Option flags for EpicsBld::BldNetworkClientFactory::createBldNetworkClient()
+ */
+#define BLD_NETWORK_CONNECTED   0x1 /* connect() to the group once, then send without a destination */
+#define BLD_NETWORK_ZEROCOPY    0x2 /* linux: transmit from a pinned buffer pool with MSG_ZEROCOPY */
+#define BLD_NETWORK_IO_URING    0x4 /* linux: submit sends through an io_uring instead of sendmsg() */
+#define BLD_NETWORK_SQPOLL      0x8 /* with BLD_NETWORK_IO_URING: kernel thread polls the submission queue */
+
+/*
+ * Policies for EpicsBld::BldNetworkClientInterface::setBackpressure(): what a
+ * send does when the socket buffer is full
+ */
+#define BLD_BACKPRESSURE_BLOCK          0   /* blocking socket, the sender waits (default) */
+#define BLD_BACKPRESSURE_DROP_NEWEST    1   /* drop the packet being sent */
+#define BLD_BACKPRESSURE_DROP_OLDEST    2   /* park it in a queue, overwriting the oldest parked packet */
+#define BLD_BACKPRESSURE_SPIN           3   /* retry for a bounded time, then drop it */
+
 /* 
  * The following functions provide C wrappers for accesing EpicsBld::BldNetworkClientInterface
  * and EpicsBld::BldNetworkClientFactory
@@ -104,6 +342,28 @@ int BldNetworkClientRelease(void* pVoidBldNetworkClient);
  * Call the Send function defined in EpicsBld::BldNetworkClientInterface 
  */
 int BldNetworkClientSendRawData(void* pVoidBldNetworkClient, int iSizeData, char* pData);
+int BldNetworkClientSendRawDataV(void* pVoidBldNetworkClient, const struct iovec* pIov, int iIovCount);
+
+/**
+ * Call the batch control functions defined in EpicsBld::BldNetworkClientInterface 
+ */
+int BldNetworkClientSetBatchMode(void* pVoidBldNetworkClient, unsigned int uMaxBatch, 
+  unsigned int uDeadlineUs);
+int BldNetworkClientFlush(void* pVoidBldNetworkClient);
+
+/**
+ * Call the burst Send function defined in EpicsBld::BldNetworkClientInterface 
+ */
+int BldNetworkClientSendBurst(void* pVoidBldNetworkClient, const char* pData, int iSegmentSize,
+  int iSegmentCount);
+int BldNetworkClientSendRawDataVBatch(void* pVoidBldNetworkClient, const struct iovec* pIov,
+  int iIovPerPacket, int iPacketCount);
+
+/**
+ * Call the backpressure control function defined in EpicsBld::BldNetworkClientInterface 
+ */
+int BldNetworkClientSetBackpressure(void* pVoidBldNetworkClient, int iPolicy, 
+  unsigned int uSndBufPackets, unsigned int uPolicyArg);
 
 } // extern "C"
 
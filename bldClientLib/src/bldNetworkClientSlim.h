@@ -0,0 +1,306 @@
+#ifndef BLD_NETWORK_CLIENT_SLIM_H
+#define BLD_NETWORK_CLIENT_SLIM_H
+
+/*
+ * Private header: declarations of the BldNetworkClientInterface implementations.
+ * Not installed, users go through BldNetworkClientFactory.
+ */
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <string>
+
+#include <epicsEvent.h>
+#include <epicsMutex.h>
+#include <epicsTime.h>
+#include <epicsTimer.h>
+
+#include "bldNetworkClient.h"
+
+#ifdef __linux__
+#define BLD_HAVE_SENDMMSG
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BLD_HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+#endif
+
+namespace EpicsBld
+{
+
+#ifdef BLD_HAVE_SENDMMSG
+typedef struct mmsghdr BldMsgEntry;
+#else
+/// Same layout as the linux struct mmsghdr, sent one at a time with sendmsg()
+struct BldMsgEntry
+{
+    struct msghdr   msg_hdr;
+    unsigned int    msg_len;
+};
+#endif
+
+/**
+ * A Slim Bld Multicast Client class 
+ *
+ * Combination of BldNetworkClientBasic, Client, Port and Ins
+ *
+ * Design Issue:
+ * 1. Under the drop-oldest backpressure policy all sends go through _bpLock,
+ *    since a new packet may not overtake the parked ones. Parked packets go
+ *    out with the next send or flush(), there is no background drain.
+ * 2. Batch flushes and bursts that hit a full socket buffer hand the rest of
+ *    their packets to the policy one by one; a spin budget is per packet.
+ */
+class BldNetworkClientSlim : public BldNetworkClientInterface
+{
+public:
+    BldNetworkClientSlim(unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize,
+      unsigned char ucTTL = 32, const char* sInteraceIp = NULL, unsigned int uFlags = 0);
+    BldNetworkClientSlim(unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize,
+      unsigned char ucTTL = 32, unsigned int uInteraceIp = 0, unsigned int uFlags = 0);
+    virtual ~BldNetworkClientSlim();
+    
+    virtual int sendRawData(int iSizeData, const char* pData);
+    virtual int sendRawDataV(const struct iovec* pIov, int iIovCount);
+
+    virtual int setBatchMode(unsigned int uMaxBatch, unsigned int uDeadlineUs);
+    virtual int flush();
+    virtual int sendBurst(const char* pData, int iSegmentSize, int iSegmentCount);
+    virtual int sendRawDataVBatch(const struct iovec* pIov, int iIovPerPacket, int iPacketCount);
+    virtual void getBatchStats(BldBatchStats* pStats);
+    virtual void resetBatchStats();
+
+    virtual int setBackpressure(int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg);
+    virtual void getBackpressureStats(BldBackpressureStats* pStats);
+    virtual void resetBackpressureStats();
+
+    virtual char* acquireTxBuffer(unsigned int uSize);
+    virtual int sendTxBuffer(char* pBuffer, int iSizeData);
+    virtual void releaseTxBuffer(char* pBuffer);
+    virtual int getZeroCopyStats(BldZeroCopyStats* pStats);
+
+    virtual void getSendStats(BldSendStats* pStats);
+    virtual void resetSendStats();
+    
+    // debug information control
+    virtual void setDebugLevel(int iDebugLevel);
+    virtual int getDebugLevel();
+    
+protected:
+    unsigned int _uAddr;
+    unsigned short _uPort;
+    unsigned int _uMaxDataSize;
+    int _iSocket;
+    int _iDebugLevel;
+    sockaddr_in _sockaddrDst;
+    sockaddr*   _pMsgName;      /// msg_name for sendmsg(), NULL once connected
+    socklen_t   _uMsgNameLen;
+
+    /*
+     * Batch transmit state, guarded by _batchLock
+     */
+    enum { uMaxBatchLimit = 64 };  /// upper bound for setBatchMode(uMaxBatch)
+    enum EFlushReason { FLUSH_COUNT, FLUSH_DEADLINE, FLUSH_EXPLICIT, FLUSH_RING_FULL };
+
+    epicsMutexId        _batchLock;
+    epicsTimerQueueId   _batchTimerQueue;
+    epicsTimerId        _batchTimer;
+    unsigned int        _uBatchMax;
+    unsigned int        _uBatchDeadlineUs;
+    unsigned int        _uBatchCount;
+    epicsTimeStamp      _tsBatchFirst;
+    char*               _pBatchBuffer;      /// _uBatchMax slots of _uMaxDataSize bytes
+    struct iovec*       _pBatchIov;
+    BldMsgEntry*        _pBatchMsgs;
+    BldBatchStats       _batchStats;
+    BldSendStatsCounter _sendStats;         /// lock-free, updated around every send syscall
+
+    /*
+     * UDP GSO burst state
+     *
+     * The kernel caps one GSO send at 64 segments and one IPv4 datagram's
+     * worth of payload; bursts larger than that take several calls.
+     */
+    enum { uGsoMaxSegments = 64, uGsoMaxBytes = 65507 };
+    bool                _bGso;              /// kernel accepts UDP_SEGMENT on this socket
+
+    /*
+     * Backpressure state, guarded by _bpLock
+     *
+     * _iBpPolicy is read without the lock on the send paths; a send racing
+     * setBackpressure() may still see the old policy. Lock order is
+     * _batchLock, then _bpLock.
+     */
+    enum { uBpDefaultQueueDepth = 16, uBpDefaultSpinUs = 100 };
+
+    int                 _iBpPolicy;
+    unsigned int        _uBpSpinUs;
+    epicsMutexId        _bpLock;
+    char*               _pBpQueue;          /// _uBpQueueDepth slots of _uMaxDataSize bytes
+    size_t*             _puBpQueueLen;
+    unsigned int        _uBpQueueDepth;
+    unsigned int        _uBpQueueHead;      /// slot of the oldest parked packet
+    unsigned int        _uBpQueueCount;
+    BldBackpressureStats _bpStats;
+
+    /*
+     * Zero-copy transmit state, guarded by _zcLock
+     *
+     * Buffers are either free (in _lZcFree), leased to a caller, or in
+     * flight (in _lZcInFlight, in send order) until the kernel's completion
+     * notification for their sequence number is reaped from the error queue.
+     */
+    enum { uZeroCopyBuffers = 64 };
+    struct BldTxBuffer
+    {
+        unsigned int    uSeq;       /// kernel zero-copy sequence number of the send
+        bool            bDone;      /// completion seen, waiting for older sends
+        epicsTimeStamp  tsSent;
+    };
+
+    bool                _bZeroCopy;
+    epicsMutexId        _zcLock;
+    char*               _pZcPool;           /// uZeroCopyBuffers buffers of _uZcBufferSize bytes
+    unsigned int        _uZcBufferSize;
+    BldTxBuffer         _lZcBuffers[uZeroCopyBuffers];
+    unsigned int        _lZcFree[uZeroCopyBuffers];
+    unsigned int        _uZcFreeCount;
+    unsigned int        _lZcInFlight[uZeroCopyBuffers];
+    unsigned int        _uZcInFlightHead;
+    unsigned int        _uZcNextSeq;
+    BldZeroCopyStats    _zcStats;
+    double              _dfZcLagSumUs;
+    
+    int _init( unsigned int uMaxDataSize, unsigned char ucTTL, 
+      unsigned int uInterfaceIp, unsigned int uFlags);   
+    void _freeBatch();
+    int _sendOne(const struct iovec* pIov, int iIovCount, size_t uSizeData);
+    int _sendWouldBlock(const struct iovec* pIov, int iIovCount, size_t uSizeData);
+    int _backpressureLocked(const struct iovec* pIov, int iIovCount, size_t uSizeData);
+    int _parkLocked(const struct iovec* pIov, int iIovCount, size_t uSizeData);
+    bool _drainLocked();
+    int _burstBackpressure(const char* pData, int iSegmentSize, int iSegmentCount);
+    int _batchBackpressure(const struct iovec* pIov, int iIovPerPacket, int iPacketCount);
+    void _freeBpQueue();
+    virtual int _flushLocked(EFlushReason eReason);
+    int _sendBurstGso(const char* pData, int iSegmentSize, int iSegmentCount);
+    int _sendBurstMmsg(const char* pData, int iSegmentSize, int iSegmentCount);
+    int _sendBatchMmsg(const struct iovec* pIov, int iIovPerPacket, int iPacketCount);
+    void _initZeroCopy();
+    int _bufferIndex(const char* pBuffer) const;
+    void _reapZeroCopyLocked();
+    void _completeZeroCopyLocked(unsigned int uSeqLo, unsigned int uSeqHi, bool bCopied);
+
+    static void _batchDeadlineCallback(void* pArg);
+    static bool _isWouldBlock(int iErrno) { return iErrno == EAGAIN || iErrno == EWOULDBLOCK; }
+      
+    static std::string addressToStr( unsigned int uAddr );      
+};
+
+#ifdef BLD_HAVE_IO_URING
+
+/**
+ * io_uring Bld Multicast Client class
+ *
+ * Same socket setup and options as BldNetworkClientSlim, but datagrams are
+ * copied into ring-owned slots and submitted as IORING_OP_SENDMSG requests.
+ * A reaper thread blocks on an eventfd the kernel signals with each
+ * completion, so slots come back and failures are counted as soon as the
+ * sends are done, not at the next send. Sends reap too, without a syscall.
+ *
+ * Design Issue:
+ * 1. Without SQPOLL each submission is one io_uring_enter() call; use batch
+ *    mode to submit several packets per call. With SQPOLL a kernel thread
+ *    picks up submissions and io_uring_enter() is only needed to wake it.
+ * 2. If the ring cannot be created the client falls back to plain sendmsg().
+ * 3. Send statistics time the io_uring_enter() calls only; packets and
+ *    failures are counted when their completions are reaped.
+ * 4. The socket stays blocking: a full socket buffer holds sends in the
+ *    ring, and the ring filling up blocks the sender. setBackpressure()
+ *    only sizes SO_SNDBUF.
+ * 5. If the eventfd cannot be registered there is no reaper thread, and
+ *    completions are reaped by later sends and getBatchStats() only.
+ */
+class BldNetworkClientUring : public BldNetworkClientSlim
+{
+public:
+    BldNetworkClientUring(unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize,
+      unsigned char ucTTL = 32, const char* sInteraceIp = NULL, unsigned int uFlags = 0);
+    BldNetworkClientUring(unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize,
+      unsigned char ucTTL = 32, unsigned int uInteraceIp = 0, unsigned int uFlags = 0);
+    virtual ~BldNetworkClientUring();
+
+    virtual int sendRawDataV(const struct iovec* pIov, int iIovCount);
+    virtual int sendBurst(const char* pData, int iSegmentSize, int iSegmentCount);
+    virtual int sendRawDataVBatch(const struct iovec* pIov, int iIovPerPacket, int iPacketCount);
+    virtual void getBatchStats(BldBatchStats* pStats);
+    virtual int setBackpressure(int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg);
+
+protected:
+    virtual int _flushLocked(EFlushReason eReason);
+
+private:
+    enum { uUringDepth = 256 };     /// send slots, also the submission queue size
+    enum { uSqPollIdleMs = 1000 };  /// SQPOLL thread sleeps after this much idle time
+
+    bool                _bUring;
+    bool                _bSqPoll;
+    int                 _iRingFd;
+
+    /*
+     * Rings shared with the kernel, all guarded by _batchLock
+     */
+    void*               _pSqRing;
+    size_t              _uSqRingSize;
+    void*               _pCqRing;
+    size_t              _uCqRingSize;
+    struct io_uring_sqe* _pSqes;
+    size_t              _uSqesSize;
+    volatile unsigned*  _puSqHead;
+    volatile unsigned*  _puSqTail;
+    volatile unsigned*  _puSqFlags;
+    unsigned            _uSqMask;
+    unsigned            _uSqTail;           /// local tail, published by _submitLocked()
+    volatile unsigned*  _puCqHead;
+    volatile unsigned*  _puCqTail;
+    unsigned            _uCqMask;
+    struct io_uring_cqe* _pCqes;
+
+    /*
+     * Send slots: free, or owned by the kernel until their completion is reaped
+     */
+    char*               _pUringSlots;       /// uUringDepth slots of _uMaxDataSize bytes
+    struct msghdr       _lUringHdr[uUringDepth];
+    struct iovec        _lUringIov[uUringDepth];
+    unsigned int        _lUringFree[uUringDepth];
+    unsigned int        _uUringFreeCount;
+
+    /*
+     * Reaper thread, woken through _iReapFd by the kernel or by _stopReaper()
+     */
+    int                 _iReapFd;           /// eventfd registered with the ring, -1 without a reaper
+    int                 _iReaperQuit;
+    epicsEventId        _eventReaperExit;
+
+    void _initUring(bool bSqPoll);
+    void _freeUring();
+    void _startReaper();
+    void _stopReaper();
+    void _reapRun();
+    static void _reapThreadFunc(void* pArg);
+    int _queueLocked(const struct iovec* pIov, int iIovCount);
+    int _submitLocked();
+    void _reapLocked();
+    void _waitLocked();
+};
+
+#endif
+
+} // namespace EpicsBld
+
+#endif
@@ -0,0 +1,564 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <epicsMutex.h>
+#include <epicsAtomic.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <epicsTimer.h>
+
+#include "bldNetworkClientSlim.h"
+
+#ifdef BLD_HAVE_IO_URING
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/*
+ * liburing is not assumed to be installed, so talk to the kernel directly
+ */
+static int ioUringSetup( unsigned int uEntries, struct io_uring_params* pParams )
+{
+    return (int) syscall( __NR_io_uring_setup, uEntries, pParams );
+}
+
+static int ioUringEnter( int iRingFd, unsigned int uToSubmit, unsigned int uMinComplete, unsigned int uFlags )
+{
+    return (int) syscall( __NR_io_uring_enter, iRingFd, uToSubmit, uMinComplete, uFlags, NULL, 0 );
+}
+
+static int ioUringRegister( int iRingFd, unsigned int uOpcode, void* pArg, unsigned int uArgCount )
+{
+    return (int) syscall( __NR_io_uring_register, iRingFd, uOpcode, pArg, uArgCount );
+}
+
+/**
+ * class member definitions
+ */
+namespace EpicsBld
+{
+/**
+ * class BldNetworkClientUring
+ */
+BldNetworkClientUring::BldNetworkClientUring(unsigned int uAddr, unsigned short uPort,
+  unsigned int uMaxDataSize, unsigned char ucTTL, const char* sInterfaceIp, unsigned int uFlags) :
+  BldNetworkClientSlim(uAddr, uPort, uMaxDataSize, ucTTL, sInterfaceIp, uFlags),
+  _bUring(false), _bSqPoll(false), _iRingFd(-1),
+  _pSqRing(MAP_FAILED), _uSqRingSize(0), _pCqRing(MAP_FAILED), _uCqRingSize(0),
+  _pSqes((struct io_uring_sqe*) MAP_FAILED), _uSqesSize(0), _pUringSlots(NULL), _uUringFreeCount(0),
+  _iReapFd(-1), _iReaperQuit(0), _eventReaperExit(NULL)
+{
+    _initUring( (uFlags & BLD_NETWORK_SQPOLL) != 0 );
+}
+
+BldNetworkClientUring::BldNetworkClientUring(unsigned int uAddr, unsigned short uPort,
+  unsigned int uMaxDataSize, unsigned char ucTTL, unsigned int uInterfaceIp, unsigned int uFlags) :
+  BldNetworkClientSlim(uAddr, uPort, uMaxDataSize, ucTTL, uInterfaceIp, uFlags),
+  _bUring(false), _bSqPoll(false), _iRingFd(-1),
+  _pSqRing(MAP_FAILED), _uSqRingSize(0), _pCqRing(MAP_FAILED), _uCqRingSize(0),
+  _pSqes((struct io_uring_sqe*) MAP_FAILED), _uSqesSize(0), _pUringSlots(NULL), _uUringFreeCount(0),
+  _iReapFd(-1), _iReaperQuit(0), _eventReaperExit(NULL)
+{
+    _initUring( (uFlags & BLD_NETWORK_SQPOLL) != 0 );
+}
+
+BldNetworkClientUring::~BldNetworkClientUring()
+{
+    if ( _bUring )
+    {
+        // Submit what is queued and wait until the kernel is done with every slot,
+        // the base class destructor can no longer reach our _flushLocked()
+        epicsMutexMustLock( _batchLock );
+        _flushLocked( FLUSH_EXPLICIT );
+        for ( int iTry = 0; _uUringFreeCount < uUringDepth && iTry < 1000; iTry++ )
+            _waitLocked();
+        epicsMutexUnlock( _batchLock );
+    }
+    _freeUring();
+}
+
+int BldNetworkClientUring::sendRawDataV(const struct iovec* pIov, int iIovCount)
+{
+    if ( !_bUring )
+        return BldNetworkClientSlim::sendRawDataV( pIov, iIovCount );
+
+    epicsMutexMustLock( _batchLock );
+    int iRetErrorCode = _queueLocked( pIov, iIovCount );
+    if ( iRetErrorCode != 0 )
+    {
+        epicsMutexUnlock( _batchLock );
+        return iRetErrorCode;
+    }
+
+    if ( _uBatchMax > 1 )
+    {
+        // Batch mode: hold the submission until the count or deadline is reached
+        if ( _uBatchCount++ == 0 && _uBatchDeadlineUs != 0 )
+        {
+            epicsTimeGetCurrent( &_tsBatchFirst );
+            epicsTimerStartDelay( _batchTimer, _uBatchDeadlineUs * 1e-6 );
+        }
+        if ( _uBatchCount >= _uBatchMax )
+            iRetErrorCode = _flushLocked( FLUSH_COUNT );
+    }
+    else
+        iRetErrorCode = _submitLocked();
+
+    epicsMutexUnlock( _batchLock );
+    return iRetErrorCode;
+}
+
+int BldNetworkClientUring::sendBurst(const char* pData, int iSegmentSize, int iSegmentCount)
+{
+    if ( _bUring )
+    {
+        // The burst goes straight to the socket, so let everything
+        // already handed to the ring leave first
+        epicsMutexMustLock( _batchLock );
+        _flushLocked( FLUSH_EXPLICIT );
+        for ( int iTry = 0; _uUringFreeCount < uUringDepth && iTry < 1000; iTry++ )
+            _waitLocked();
+        epicsMutexUnlock( _batchLock );
+    }
+    return BldNetworkClientSlim::sendBurst( pData, iSegmentSize, iSegmentCount );
+}
+
+int BldNetworkClientUring::sendRawDataVBatch(const struct iovec* pIov, int iIovPerPacket, int iPacketCount)
+{
+    // Batch mode counts and times each packet, which sendRawDataV() does
+    if ( !_bUring || _uBatchMax > 1 )
+        return BldNetworkClientSlim::sendRawDataVBatch( pIov, iIovPerPacket, iPacketCount );
+    if ( pIov == NULL || iIovPerPacket <= 0 || iPacketCount <= 0 )
+        return 1;
+
+    // Queue every packet, then publish them all with one io_uring_enter()
+    int iRetErrorCode = 0;
+    epicsMutexMustLock( _batchLock );
+    for ( int iPacket = 0; iPacket < iPacketCount; iPacket++ )
+    {
+        if ( _queueLocked( pIov + iPacket * iIovPerPacket, iIovPerPacket ) != 0 )
+            iRetErrorCode = 1;
+    }
+    if ( _submitLocked() != 0 )
+        iRetErrorCode = 1;
+    epicsMutexUnlock( _batchLock );
+    return iRetErrorCode;
+}
+
+void BldNetworkClientUring::getBatchStats(BldBatchStats* pStats)
+{
+    if ( pStats == NULL )
+        return;
+    epicsMutexMustLock( _batchLock );
+    if ( _bUring )
+        _reapLocked(); // so uPktsSent includes completions nobody has looked at yet
+    *pStats = _batchStats;
+    epicsMutexUnlock( _batchLock );
+}
+
+int BldNetworkClientUring::setBackpressure(int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg)
+{
+    if ( !_bUring )
+        return BldNetworkClientSlim::setBackpressure( iPolicy, uSndBufPackets, uPolicyArg );
+
+    if ( iPolicy != BLD_BACKPRESSURE_BLOCK )
+        printf( "[Warning] BldNetworkClientUring::setBackpressure() : sends wait in the ring, "
+          "policy %d ignored, only the send buffer size is applied\n", iPolicy );
+    return BldNetworkClientSlim::setBackpressure( BLD_BACKPRESSURE_BLOCK, uSndBufPackets, 0 );
+}
+
+/*
+ * protected functions
+ */
+
+/**
+ * Submit the queued send requests. Caller must hold _batchLock.
+ */
+int BldNetworkClientUring::_flushLocked(EFlushReason eReason)
+{
+    if ( !_bUring )
+        return BldNetworkClientSlim::_flushLocked( eReason );
+    if ( _uBatchCount == 0 )
+        return 0;
+
+    int iRetErrorCode = _submitLocked();
+
+    _batchStats.uBatches++;
+    if ( _uBatchCount > _batchStats.uMaxBatch )
+        _batchStats.uMaxBatch = _uBatchCount;
+    switch ( eReason )
+    {
+    case FLUSH_COUNT:       _batchStats.uFlushByCount++;    break;
+    case FLUSH_DEADLINE:    _batchStats.uFlushByDeadline++; break;
+    case FLUSH_EXPLICIT:    _batchStats.uFlushExplicit++;   break;
+    case FLUSH_RING_FULL:   _batchStats.uFlushByRingFull++; break;
+    }
+
+    _uBatchCount = 0;
+    return iRetErrorCode;
+}
+
+/*
+ * private functions
+ */
+void BldNetworkClientUring::_initUring(bool bSqPoll)
+{
+    if ( _iSocket == -1 )
+        return;
+
+    struct io_uring_params params;
+    memset( &params, 0, sizeof(params) );
+    if ( bSqPoll )
+    {
+        params.flags          = IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = uSqPollIdleMs;
+    }
+    _iRingFd = ioUringSetup( uUringDepth, &params );
+    if ( _iRingFd < 0 && bSqPoll )
+    {
+        // Older kernels only allow SQPOLL with CAP_SYS_ADMIN
+        printf( "[Warning] BldNetworkClientUring::BldNetworkClientUring() : io_uring SQPOLL setup failed, "
+          "errno = %d (%s). Trying without SQPOLL.\n", errno, strerror(errno) );
+        memset( &params, 0, sizeof(params) );
+        _iRingFd = ioUringSetup( uUringDepth, &params );
+    }
+    if ( _iRingFd < 0 )
+    {
+        printf( "[Warning] BldNetworkClientUring::BldNetworkClientUring() : io_uring_setup failed, "
+          "errno = %d (%s). Using sendmsg().\n", errno, strerror(errno) );
+        return;
+    }
+    _bSqPoll = ( (params.flags & IORING_SETUP_SQPOLL) != 0 );
+
+    _uSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _uCqRingSize = params.cq_off.cqes  + params.cq_entries * sizeof(struct io_uring_cqe);
+    if ( params.features & IORING_FEAT_SINGLE_MMAP )
+    {
+        if ( _uCqRingSize > _uSqRingSize )
+            _uSqRingSize = _uCqRingSize;
+        _uCqRingSize = _uSqRingSize;
+    }
+    _pSqRing = mmap( NULL, _uSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+      _iRingFd, IORING_OFF_SQ_RING );
+    if ( params.features & IORING_FEAT_SINGLE_MMAP )
+        _pCqRing = _pSqRing;
+    else
+        _pCqRing = mmap( NULL, _uCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+          _iRingFd, IORING_OFF_CQ_RING );
+    _uSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    _pSqes = (struct io_uring_sqe*) mmap( NULL, _uSqesSize, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, _iRingFd, IORING_OFF_SQES );
+    if ( _pSqRing == MAP_FAILED || _pCqRing == MAP_FAILED || _pSqes == MAP_FAILED )
+    {
+        printf( "[Warning] BldNetworkClientUring::BldNetworkClientUring() : io_uring mmap failed, "
+          "errno = %d (%s). Using sendmsg().\n", errno, strerror(errno) );
+        _freeUring();
+        return;
+    }
+
+    char* pSqRing = (char*) _pSqRing;
+    char* pCqRing = (char*) _pCqRing;
+    _puSqHead   = (volatile unsigned*) (pSqRing + params.sq_off.head);
+    _puSqTail   = (volatile unsigned*) (pSqRing + params.sq_off.tail);
+    _puSqFlags  = (volatile unsigned*) (pSqRing + params.sq_off.flags);
+    _uSqMask    = *(unsigned*) (pSqRing + params.sq_off.ring_mask);
+    _uSqTail    = *_puSqTail;
+    _puCqHead   = (volatile unsigned*) (pCqRing + params.cq_off.head);
+    _puCqTail   = (volatile unsigned*) (pCqRing + params.cq_off.tail);
+    _uCqMask    = *(unsigned*) (pCqRing + params.cq_off.ring_mask);
+    _pCqes      = (struct io_uring_cqe*) (pCqRing + params.cq_off.cqes);
+
+    // SQEs are always used in ring order, so the index array is fixed
+    unsigned* puSqArray = (unsigned*) (pSqRing + params.sq_off.array);
+    for ( unsigned int uIndex = 0; uIndex < params.sq_entries; uIndex++ )
+        puSqArray[uIndex] = uIndex;
+
+    // One preallocated slot and msghdr per ring entry, so nothing is allocated per send
+    _pUringSlots = new char[uUringDepth * _uMaxDataSize];
+    for ( unsigned int uSlot = 0; uSlot < uUringDepth; uSlot++ )
+    {
+        _lUringIov[uSlot].iov_base = (caddr_t)(_pUringSlots + uSlot * _uMaxDataSize);
+        _lUringIov[uSlot].iov_len  = 0;
+
+        struct msghdr& hdr  = _lUringHdr[uSlot];
+        memset( &hdr, 0, sizeof(hdr) );
+        hdr.msg_name        = _pMsgName;
+        hdr.msg_namelen     = _uMsgNameLen;
+        hdr.msg_iov         = &_lUringIov[uSlot];
+        hdr.msg_iovlen      = 1;
+
+        _lUringFree[uSlot] = uUringDepth - 1 - uSlot;
+    }
+    _uUringFreeCount = uUringDepth;
+    _bUring = true;
+    _startReaper();
+
+    if ( _iDebugLevel >= 1 )
+        printf( "BldNetworkClientUring: io_uring ready, %u entries%s\n", params.sq_entries,
+          (_bSqPoll ? ", SQPOLL" : "") );
+}
+
+void BldNetworkClientUring::_freeUring()
+{
+    _stopReaper();
+    if ( _pSqes != MAP_FAILED )
+        munmap( _pSqes, _uSqesSize );
+    if ( _pCqRing != MAP_FAILED && _pCqRing != _pSqRing )
+        munmap( _pCqRing, _uCqRingSize );
+    if ( _pSqRing != MAP_FAILED )
+        munmap( _pSqRing, _uSqRingSize );
+    if ( _iRingFd >= 0 )
+        close( _iRingFd );
+    delete [] _pUringSlots;
+
+    _pSqes          = (struct io_uring_sqe*) MAP_FAILED;
+    _pCqRing        = MAP_FAILED;
+    _pSqRing        = MAP_FAILED;
+    _iRingFd        = -1;
+    _pUringSlots    = NULL;
+    _bUring         = false;
+}
+
+/**
+ * Start the reaper thread, which reaps completions as the kernel posts them
+ */
+void BldNetworkClientUring::_startReaper()
+{
+    _iReapFd = eventfd( 0, EFD_CLOEXEC );
+    if ( _iReapFd < 0 || ioUringRegister( _iRingFd, IORING_REGISTER_EVENTFD, &_iReapFd, 1 ) < 0 )
+    {
+        printf( "[Warning] BldNetworkClientUring::BldNetworkClientUring() : io_uring eventfd setup failed, "
+          "errno = %d (%s). Completions are reaped by later sends only.\n", errno, strerror(errno) );
+        if ( _iReapFd >= 0 )
+            close( _iReapFd );
+        _iReapFd = -1;
+        return;
+    }
+
+    _eventReaperExit = epicsEventMustCreate( epicsEventEmpty );
+    epicsThreadMustCreate( "bldUringReap", epicsThreadPriorityHigh,
+      epicsThreadGetStackSize(epicsThreadStackSmall), _reapThreadFunc, this );
+}
+
+/**
+ * Wake the reaper thread through its eventfd and wait for it to exit
+ */
+void BldNetworkClientUring::_stopReaper()
+{
+    if ( _iReapFd < 0 )
+        return;
+
+    epicsAtomicSetIntT( &_iReaperQuit, 1 );
+    const uint64_t ullWake = 1;
+    if ( write( _iReapFd, &ullWake, sizeof(ullWake) ) == sizeof(ullWake) )
+        epicsEventMustWait( _eventReaperExit );
+    else
+        printf( "[Error] BldNetworkClientUring : eventfd write failed, errno = %d (%s)\n",
+          errno, strerror(errno) );
+
+    // Closing the ring unregisters the eventfd, this side can go now
+    epicsEventDestroy( _eventReaperExit );
+    close( _iReapFd );
+    _eventReaperExit = NULL;
+    _iReapFd = -1;
+}
+
+void BldNetworkClientUring::_reapRun()
+{
+    for ( ;; )
+    {
+        // The count of completions since the last read is not needed, _reapLocked() finds them all
+        uint64_t ullEvents;
+        if ( read( _iReapFd, &ullEvents, sizeof(ullEvents) ) < 0 && errno != EINTR )
+        {
+            printf( "[Error] BldNetworkClientUring : eventfd read failed, errno = %d (%s)\n",
+              errno, strerror(errno) );
+            epicsThreadSleep( 0.1 );
+        }
+        if ( epicsAtomicGetIntT( &_iReaperQuit ) )
+            break;
+
+        epicsMutexMustLock( _batchLock );
+        _reapLocked();
+        epicsMutexUnlock( _batchLock );
+    }
+
+    epicsEventSignal( _eventReaperExit );
+}
+
+void BldNetworkClientUring::_reapThreadFunc(void* pArg)
+{
+    ((BldNetworkClientUring*) pArg)->_reapRun();
+}
+
+/**
+ * Copy one datagram into a free slot and queue its SQE, without submitting it.
+ * Caller must hold _batchLock.
+ */
+int BldNetworkClientUring::_queueLocked(const struct iovec* pIov, int iIovCount)
+{
+    size_t uSizeData = 0;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+        uSizeData += pIov[iIov].iov_len;
+
+    if ( uSizeData > _uMaxDataSize )
+    {
+        _batchStats.uPktsDropped++;
+        printf( "[Error] BldNetworkClientUring::sendRawData() : size %zu exceeds slot size %u\n",
+          uSizeData, _uMaxDataSize );
+        return 1;
+    }
+
+    _reapLocked();
+    if ( _uUringFreeCount == 0 )
+    {
+        // Every slot is queued or in flight: push out the queued ones and wait for one
+        _flushLocked( FLUSH_RING_FULL );
+        _waitLocked();
+    }
+    if ( _uUringFreeCount == 0 )
+    {
+        _batchStats.uPktsDropped++;
+        printf( "[Error] BldNetworkClientUring::sendRawData() : no free send slot\n" );
+        return 1;
+    }
+
+    // Gather into the slot, the caller may reuse its buffers right away
+    unsigned int uSlot = _lUringFree[--_uUringFreeCount];
+    char* pSlot = _pUringSlots + uSlot * _uMaxDataSize;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+    {
+        memcpy( pSlot, pIov[iIov].iov_base, pIov[iIov].iov_len );
+        pSlot += pIov[iIov].iov_len;
+    }
+    _lUringIov[uSlot].iov_len = uSizeData;
+
+    struct io_uring_sqe* pSqe = &_pSqes[_uSqTail & _uSqMask];
+    memset( pSqe, 0, sizeof(*pSqe) );
+    pSqe->opcode    = IORING_OP_SENDMSG;
+    pSqe->fd        = _iSocket;
+    pSqe->addr      = (unsigned long) &_lUringHdr[uSlot];
+    pSqe->len       = 1;
+    pSqe->user_data = uSlot;
+    _uSqTail++;
+    _batchStats.uPktsQueued++;
+    return 0;
+}
+
+/**
+ * Publish the queued SQEs and tell the kernel about them. Caller must hold _batchLock.
+ */
+int BldNetworkClientUring::_submitLocked()
+{
+    // SQE contents must be visible before the new tail
+    epicsAtomicWriteMemoryBarrier();
+    *_puSqTail = _uSqTail;
+
+    // Counted from the kernel's head, so entries left over by a failed call go too
+    unsigned int uToSubmit = _uSqTail - *_puSqHead;
+    if ( uToSubmit == 0 )
+        return 0;
+
+    int iStatus;
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+    if ( _bSqPoll )
+    {
+        // The tail store must be ordered before the flags load, or a poll
+        // thread going to sleep right now could miss our entries
+        __sync_synchronize();
+        if ( (*_puSqFlags & IORING_SQ_NEED_WAKEUP) == 0 )
+            return 0;
+        iStatus = ioUringEnter( _iRingFd, 0, 0, IORING_ENTER_SQ_WAKEUP );
+    }
+    else
+        iStatus = ioUringEnter( _iRingFd, uToSubmit, 0, 0 );
+    _sendStats.recordLatency( ullStartNs );
+    _batchStats.uSendCalls++;
+
+    if ( iStatus < 0 )
+    {
+        // Entries stay in the ring and go out with the next submission
+        printf( "[Error] BldNetworkClientUring::flush() : io_uring_enter failed, errno = %d (%s)\n",
+          errno, strerror(errno) );
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Return the slots of completed sends to the free list. Caller must hold _batchLock.
+ */
+void BldNetworkClientUring::_reapLocked()
+{
+    unsigned int uHead = *_puCqHead;
+    unsigned int uTail = *_puCqTail;
+    if ( uHead == uTail )
+        return;
+
+    // Completion entries were written before the tail we just read
+    epicsAtomicReadMemoryBarrier();
+    for ( ; uHead != uTail; uHead++ )
+    {
+        const struct io_uring_cqe* pCqe = &_pCqes[uHead & _uCqMask];
+        unsigned int uSlot = (unsigned int) pCqe->user_data;
+        if ( pCqe->res < 0 )
+        {
+            _batchStats.uPktsDropped++;
+            _sendStats.recordFailure( -pCqe->res );
+            if ( _iDebugLevel >= 1 )
+                printf( "[Error] BldNetworkClientUring : send failed, size = %zu, errno = %d (%s)\n",
+                  _lUringIov[uSlot].iov_len, -pCqe->res, strerror(-pCqe->res) );
+        }
+        else
+        {
+            _batchStats.uPktsSent++;
+            _sendStats.recordSend( 1, pCqe->res );
+        }
+        _lUringFree[_uUringFreeCount++] = uSlot;
+    }
+
+    // Hand the completion entries back to the kernel
+    epicsAtomicWriteMemoryBarrier();
+    *_puCqHead = uHead;
+}
+
+/**
+ * Block until at least one send completes, then reap. Caller must hold _batchLock.
+ */
+void BldNetworkClientUring::_waitLocked()
+{
+    // Submit anything not yet consumed along with the wait, otherwise
+    // there may be nothing in flight to wait for
+    epicsAtomicWriteMemoryBarrier();
+    *_puSqTail = _uSqTail;
+
+    unsigned int uToSubmit  = 0;
+    unsigned int uFlags     = IORING_ENTER_GETEVENTS;
+    if ( _bSqPoll )
+    {
+        __sync_synchronize();
+        if ( *_puSqFlags & IORING_SQ_NEED_WAKEUP )
+            uFlags |= IORING_ENTER_SQ_WAKEUP;
+    }
+    else
+        uToSubmit = _uSqTail - *_puSqHead;
+
+    if ( ioUringEnter( _iRingFd, uToSubmit, 1, uFlags ) < 0 && errno != EINTR )
+    {
+        printf( "[Error] BldNetworkClientUring : io_uring_enter(GETEVENTS) failed, errno = %d (%s)\n",
+          errno, strerror(errno) );
+        epicsThreadSleep( 0.001 );
+    }
+    _reapLocked();
+}
+
+} // namespace EpicsBld
+
+#endif
@@ -1,5 +1,16 @@
 #include "bldPacket.h"
+#include "bldPayloadLayout.h"
 #include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <epicsThread.h>
+#include <epicsMutex.h>
+#include <epicsAtomic.h>
+#include <epicsTypes.h>
+#include <dbFldTypes.h>
 
 /*
  * class member definitions
@@ -13,7 +24,103 @@ namespace EpicsBld
 int								BldPacketHeader::liBldPacketSizeByBldType[	BldPacketHeader::NumberOfBldTypeId	];
 BldPacketHeader::XtcDataType	BldPacketHeader::ltXtcDataTypeByBldType[	BldPacketHeader::NumberOfBldTypeId	];
 TSetPvFuncPointer				BldPacketHeader::lfuncSetvFunctionTable[	BldPacketHeader::NumberOfBldTypeId	];
-int BldPacketHeader::init_done = 0;
+TPackPayloadFuncPointer			BldPacketHeader::lfuncPackPayloadTable[		BldPacketHeader::NumberOfBldTypeId	];
+unsigned int					BldPacketHeader::luPackPvCountByBldType[	BldPacketHeader::NumberOfBldTypeId	];
+void*							BldPacketHeader::lpvFieldsByBldType[		BldPacketHeader::NumberOfBldTypeId	];
+
+static epicsThreadOnceId	registryOnce	= EPICS_THREAD_ONCE_INIT;
+static epicsMutexId			registryLock	= NULL;		/// serializes registrations, readers take no lock
+
+/*
+ * Field table packing: each element is converted as by a C cast and stored
+ * little-endian, the payload offset need not be aligned
+ */
+static const unsigned int luWireSize[BldFieldDesc::NumberOfWireTypes] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+static inline void storeLE( char* pDst, epicsInt8 value )	{ *pDst = value; }
+static inline void storeLE( char* pDst, epicsUInt8 value )	{ *pDst = (char) value; }
+static inline void storeLE( char* pDst, epicsUInt16 value )
+{
+    value = BldPacketHeader::setu16LE( value );
+    memcpy( pDst, &value, sizeof(value) );
+}
+static inline void storeLE( char* pDst, epicsInt16 value )	{ storeLE( pDst, (epicsUInt16) value ); }
+static inline void storeLE( char* pDst, epicsUInt32 value )
+{
+    value = BldPacketHeader::setu32LE( value );
+    memcpy( pDst, &value, sizeof(value) );
+}
+static inline void storeLE( char* pDst, epicsInt32 value )	{ storeLE( pDst, (epicsUInt32) value ); }
+static inline void storeLE( char* pDst, epicsFloat32 value )
+{
+    epicsUInt32 uValue;
+    memcpy( &uValue, &value, sizeof(uValue) );
+    storeLE( pDst, uValue );
+}
+static inline void storeLE( char* pDst, epicsFloat64 value )
+{
+    value = BldPacketHeader::setdoubleLE( value );
+    memcpy( pDst, &value, sizeof(value) );
+}
+
+template <class TSrc, class TDst>
+static void packElements( const TSrc* pSrc, unsigned int uCount, char* pDst )
+{
+    for ( unsigned int u = 0; u < uCount; u++ )
+        storeLE( pDst + u * sizeof(TDst), (TDst) pSrc[u] );
+}
+
+// Arrays that need no conversion go through the bulk byte swap kernels
+template <> void packElements<epicsInt16, epicsInt16>( const epicsInt16* pSrc, unsigned int uCount, char* pDst )
+{ BldStoreLE16( pSrc, uCount, pDst ); }
+template <> void packElements<epicsUInt16, epicsUInt16>( const epicsUInt16* pSrc, unsigned int uCount, char* pDst )
+{ BldStoreLE16( pSrc, uCount, pDst ); }
+template <> void packElements<epicsInt32, epicsInt32>( const epicsInt32* pSrc, unsigned int uCount, char* pDst )
+{ BldStoreLE32( pSrc, uCount, pDst ); }
+template <> void packElements<epicsUInt32, epicsUInt32>( const epicsUInt32* pSrc, unsigned int uCount, char* pDst )
+{ BldStoreLE32( pSrc, uCount, pDst ); }
+template <> void packElements<epicsFloat32, epicsFloat32>( const epicsFloat32* pSrc, unsigned int uCount, char* pDst )
+{ BldStoreLE32( pSrc, uCount, pDst ); }
+template <> void packElements<epicsFloat64, epicsFloat64>( const epicsFloat64* pSrc, unsigned int uCount, char* pDst )
+{ BldStoreLE64( pSrc, uCount, pDst ); }
+
+template <class TSrc>
+static void packFromSource( unsigned int uWireType, const char* pSrc, unsigned int uCount, char* pDst )
+{
+    const TSrc* pValues = (const TSrc*) pSrc;
+    switch ( uWireType )
+    {
+    case BldFieldDesc::WireInt8:	packElements<TSrc, epicsInt8>(		pValues, uCount, pDst ); break;
+    case BldFieldDesc::WireUInt8:	packElements<TSrc, epicsUInt8>(		pValues, uCount, pDst ); break;
+    case BldFieldDesc::WireInt16:	packElements<TSrc, epicsInt16>(		pValues, uCount, pDst ); break;
+    case BldFieldDesc::WireUInt16:	packElements<TSrc, epicsUInt16>(	pValues, uCount, pDst ); break;
+    case BldFieldDesc::WireInt32:	packElements<TSrc, epicsInt32>(		pValues, uCount, pDst ); break;
+    case BldFieldDesc::WireUInt32:	packElements<TSrc, epicsUInt32>(	pValues, uCount, pDst ); break;
+    case BldFieldDesc::WireFloat:	packElements<TSrc, epicsFloat32>(	pValues, uCount, pDst ); break;
+    case BldFieldDesc::WireDouble:	packElements<TSrc, epicsFloat64>(	pValues, uCount, pDst ); break;
+    }
+}
+
+/// Pack lCount elements at pSrc (aligned, of the field's DBR type) into the field, zero the rest of it
+static void packField( const BldFieldDesc& field, const char* pSrc, long lCount, char* pPayload )
+{
+    const unsigned int uCount = (unsigned int) std::max( 0L, std::min( lCount, (long) field.uCount ) );
+    char* pDst = pPayload + field.uOffset;
+    switch ( field.iDbrType )
+    {
+    case DBR_CHAR:		packFromSource<epicsInt8>(		field.uWireType, pSrc, uCount, pDst ); break;
+    case DBR_UCHAR:		packFromSource<epicsUInt8>(		field.uWireType, pSrc, uCount, pDst ); break;
+    case DBR_SHORT:		packFromSource<epicsInt16>(		field.uWireType, pSrc, uCount, pDst ); break;
+    case DBR_USHORT:
+    case DBR_ENUM:		packFromSource<epicsUInt16>(	field.uWireType, pSrc, uCount, pDst ); break;
+    case DBR_LONG:		packFromSource<epicsInt32>(		field.uWireType, pSrc, uCount, pDst ); break;
+    case DBR_ULONG:		packFromSource<epicsUInt32>(	field.uWireType, pSrc, uCount, pDst ); break;
+    case DBR_FLOAT:		packFromSource<epicsFloat32>(	field.uWireType, pSrc, uCount, pDst ); break;
+    case DBR_DOUBLE:	packFromSource<epicsFloat64>(	field.uWireType, pSrc, uCount, pDst ); break;
+    }
+    const unsigned int uWireSize = luWireSize[field.uWireType];
+    memset( pDst + uCount * uWireSize, 0, ( field.uCount - uCount ) * uWireSize );
+}
 
 BldPacketHeader::BldPacketHeader(
     unsigned int    uMaxPacketSize,
@@ -125,6 +232,24 @@ int BldPacketHeader::Setup(
 
 	return 0;
 }
+
+int BldPacketHeader::SetupContainer(
+    uint32_t        uSecs1,
+    uint32_t        uNSecs1,
+    uint32_t        uFiducial,
+    uint32_t        uPhysId,
+    unsigned int    sChildren,
+    uint32_t        uXtcType )
+{
+	uNanoSecs	=	setu32LE( uNSecs1	);
+	uSecs		=	setu32LE( uSecs1	);
+	uFiducialId	=	setu32LE( uFiducial	);
+	uPhysicalId	=	setu32LE( uPhysId	);
+	uDataType	=	setu32LE( uXtcType	);
+	uExtentSize	=	setu32LE( sizeof(BldXtcHeader) + sChildren );
+
+	return 0;
+}
  
 
 void BldPacketHeader::setPacketSize( unsigned int sData )
@@ -151,8 +276,21 @@ void BldPacketHeader::setPacketSize( unsigned int sData )
 }
 
 
-int BldPacketHeader::setPvValue( int iPvIndex, void* pPvValue )
+int BldPacketHeader::setPvValue( int iPvIndex, void* pPvValue, long lNumElements )
 {
+    const BldTypeFields* pTypeFields = getFields( setu32LE(uPhysicalId) );
+    if ( pTypeFields != NULL )
+    {
+        // PVs past the end of the table are ignored, as by the typed layouts
+        if ( iPvIndex >= 0 && (unsigned int) iPvIndex < pTypeFields->uFieldCount )
+        {
+            const BldFieldDesc& field = pTypeFields->pFields[iPvIndex];
+            packField( field, (const char*) pPvValue, lNumElements < 0 ? (long) field.uCount : lNumElements,
+                       (char*) (this + 1) );
+        }
+        return 0;
+    }
+
     TSetPvFuncPointer fn = this->lfuncSetvFunctionTable[ setu32LE(uPhysicalId) ];
     if (fn)
         return ( *fn ) ( iPvIndex, pPvValue, (void *)(this + 1));
@@ -160,79 +298,432 @@ int BldPacketHeader::setPvValue( int iPvIndex, void* pPvValue )
         return 0;
 }
 
-int setPvValuePulseEnergy( int iPvIndex, void* pPvValue, void *payload )
+int BldPacketHeader::packPayload( const double* pdValues, unsigned int uCount )
 {
+    TPackPayloadFuncPointer fn = lfuncPackPayloadTable[ setu32LE(uPhysicalId) ];
+    if (fn)
+        return ( *fn ) ( pdValues, uCount, (void *)(this + 1));
+    else
+        return 1;
+}
+
+int BldPacketHeader::packFields( const BldTypeFields* pTypeFields, const char* pStage, const long* plCounts )
+{
+    char* pPayload = (char*) (this + 1);
+    unsigned int uEnd = 0;
+    for ( unsigned int uField = 0; uField < pTypeFields->uFieldCount; uField++ )
+    {
+        // Alignment gaps are zeroed, like the tail padding below
+        const BldFieldDesc& field = pTypeFields->pFields[uField];
+        if ( field.uOffset > uEnd )
+            memset( pPayload + uEnd, 0, field.uOffset - uEnd );
+        packField( field, pStage + pTypeFields->puStageOffset[uField], plCounts[uField], pPayload );
+        uEnd = std::max( uEnd, field.uOffset + field.uCount * luWireSize[field.uWireType] );
+    }
+    if ( pTypeFields->uPayloadSize > uEnd )
+        memset( pPayload + uEnd, 0, pTypeFields->uPayloadSize - uEnd );
     return 0;
 }
 
-int setPvValuePhaseCavity( int iPvIndex, void* pPvValue, void *payload )
+/**
+ * class BldXtcHeader
+ */
+unsigned int BldXtcHeader::Setup( uint32_t uPhysId, uint32_t uXtcType, unsigned int sData )
 {
-    double* pSrcPvValue = (double*) pPvValue;
-    double* pDstPvValue = ((double*) payload) + iPvIndex;
-    
-    *pDstPvValue = BldPacketHeader::setdoubleLE(*pSrcPvValue);
+    const unsigned int uExtent = extentSize( sData );
+
+    uDamage     = 0;
+    uLogicalId  = BldPacketHeader::setu32LE( BldPacketHeader::uBldLogicalId );
+    uPhysicalId = BldPacketHeader::setu32LE( uPhysId );
+    uDataType   = BldPacketHeader::setu32LE( uXtcType );
+    uExtentSize = BldPacketHeader::setu32LE( uExtent );
+    return uExtent;
+}
+
+/**
+ * class BldContainerPacket
+ */
+BldContainerPacket::BldContainerPacket( char* pBuffer, unsigned int uBufferSize )
+    :   _pBuffer( pBuffer ), _uBufferSize( uBufferSize ), _uSize( 0 ), _uChildCount( 0 )
+{
+}
+
+void BldContainerPacket::Setup( uint32_t uSecs1, uint32_t uNSecs, uint32_t uFiducial, uint32_t uPhysId )
+{
+    _uSize          = prefixSize();
+    _uChildCount    = 0;
+    if ( _uBufferSize < _uSize )
+    {
+        printf( "BldContainerPacket::Setup() buffer size (%u) is smaller than the header (%u)\n",
+                _uBufferSize, _uSize );
+        _uSize = _uBufferSize = 0;
+        return;
+    }
+
+    // Only the prefix is written, section 2 becomes the first child
+    BldPacketHeader bldPacketHeader;
+    bldPacketHeader.SetupContainer( uSecs1, uNSecs, uFiducial, uPhysId, 0 );
+    memcpy( _pBuffer, &bldPacketHeader, _uSize );
+}
+
+void* BldContainerPacket::reserveChild( uint32_t uPhysId, uint32_t uXtcType, unsigned int sData )
+{
+    if ( _uSize == 0 || !fits( sData ) )
+        return NULL;
+
+    BldXtcHeader* pXtc = (BldXtcHeader*) ( _pBuffer + _uSize );
+    const unsigned int uExtent = pXtc->Setup( uPhysId, uXtcType, sData );
+    char* pPayload = (char*) ( pXtc + 1 );
+
+    // Zero the padding, the caller fills in the rest
+    memset( pPayload + sData, 0, uExtent - sizeof(BldXtcHeader) - sData );
+
+    _uSize += uExtent;
+    _uChildCount++;
+
+    // The parent extent covers every child so far
+    BldXtcHeader* pParent = (BldXtcHeader*) ( _pBuffer + prefixSize() - sizeof(BldXtcHeader) );
+    pParent->uExtentSize = BldPacketHeader::setu32LE( _uSize - prefixSize() + sizeof(BldXtcHeader) );
+    return pPayload;
+}
+
+int BldContainerPacket::addChild( uint32_t uPhysId, uint32_t uXtcType, const void* pData, unsigned int sData )
+{
+    void* pPayload = reserveChild( uPhysId, uXtcType, sData );
+    if ( pPayload == NULL )
+        return 1;
+    memcpy( pPayload, pData, sData );
     return 0;
 }
 
-int setPvValueFEEGasDetEnergy( int iPvIndex, void* pPvValue, void *payload )
+/**
+ * class BldPacketDecoder
+ */
+BldPacketDecoder::BldPacketDecoder( const char* pPacket, unsigned int uPacketSize )
+    :   _pPacket( pPacket ), _uEnd( 0 ), _uOffset( BldContainerPacket::prefixSize() ),
+        _bValid( false ), _bContainer( false )
+{
+    if ( pPacket == NULL || uPacketSize < sizeof(BldPacketHeader) )
+        return;
+    memcpy( &_header, pPacket, sizeof(BldPacketHeader) );
+
+    const unsigned int uParent = BldContainerPacket::prefixSize() - sizeof(BldXtcHeader);
+    _bContainer = ( ( BldPacketHeader::setu32LE( _header.uDataType ) & 0xFFFF ) == BldPacketHeader::Id_Xtc );
+
+    // Children run to the end of the parent Xtc; a single-source datagram
+    // has one child, section 2
+    const unsigned int uStart   = ( _bContainer ? uParent : _uOffset );
+    const uint32_t     uExtent  = BldPacketHeader::setu32LE( _bContainer ? _header.uExtentSize : _header.uExtentSize2 );
+    if ( uExtent < sizeof(BldXtcHeader) || uExtent > uPacketSize - uStart )
+        return;
+    _uEnd   = uStart + uExtent;
+    _bValid = true;
+}
+
+int BldPacketDecoder::nextChild( BldXtcChild* pChild )
 {
-    double* pSrcPvValue = (double*) pPvValue;
-    double* pDstPvValue = ((double*) payload) + iPvIndex;
-    
-    *pDstPvValue = BldPacketHeader::setdoubleLE(*pSrcPvValue);
+    if ( !_bValid )
+        return -1;
+    if ( _uOffset >= _uEnd )
+        return 1;
+    if ( _uEnd - _uOffset < sizeof(BldXtcHeader) )
+        return -1;
+
+    BldXtcHeader xtc;
+    memcpy( &xtc, _pPacket + _uOffset, sizeof(xtc) );
+    const uint32_t uExtent = BldPacketHeader::setu32LE( xtc.uExtentSize );
+    if ( uExtent < sizeof(BldXtcHeader) || uExtent > _uEnd - _uOffset )
+        return -1;
+
+    if ( pChild != NULL )
+    {
+        pChild->uDamage     = BldPacketHeader::setu32LE( xtc.uDamage );
+        pChild->uPhysicalId = BldPacketHeader::setu32LE( xtc.uPhysicalId );
+        pChild->uDataType   = BldPacketHeader::setu32LE( xtc.uDataType );
+        pChild->pPayload    = _pPacket + _uOffset + sizeof(BldXtcHeader);
+        pChild->sPayload    = uExtent - sizeof(BldXtcHeader);
+    }
+    _uOffset += uExtent;
     return 0;
 }
 
-int setPvValueGMD( int iPvIndex, void* pPvValue, void *payload )
+unsigned int BldPacketDecoder::getPulseCount( const BldXtcChild& child ) const
+{
+    if ( child.sPayload < sizeof(BldPulseIndex) )
+        return 0;
+
+    BldPulseIndex index;
+    memcpy( &index, child.pPayload, sizeof(index) );
+    const uint32_t uPulseCount = BldPacketHeader::setu32LE( index.uPulseCount );
+    const uint32_t uPulseSize  = BldPacketHeader::setu32LE( index.uPulseSize );
+
+    // Index and payloads must lie inside the child, checked without overflow
+    const unsigned int sPulses = child.sPayload - sizeof(BldPulseIndex);
+    const unsigned int sPerPulse = sizeof(BldPulseIndexEntry) + uPulseSize;
+    if ( uPulseSize > sPulses || uPulseCount > sPulses / sPerPulse )
+        return 0;
+    return uPulseCount;
+}
+
+int BldPacketDecoder::getPulse( const BldXtcChild& child, unsigned int uPulse, BldPulse* pPulse ) const
+{
+    if ( child.sPayload < sizeof(BldPulseIndex) )
+        return -1;
+
+    BldPulseIndex index;
+    memcpy( &index, child.pPayload, sizeof(index) );
+    const uint32_t uPulseSize = BldPacketHeader::setu32LE( index.uPulseSize );
+    const unsigned int uPulseCount = getPulseCount( child );
+    if ( uPulseCount != BldPacketHeader::setu32LE( index.uPulseCount ) )
+        return -1;
+    if ( uPulse >= uPulseCount )
+        return 1;
+
+    BldPulseIndexEntry entry;
+    memcpy( &entry, child.pPayload + sizeof(BldPulseIndex) + uPulse * sizeof(BldPulseIndexEntry), sizeof(entry) );
+    const int32_t iOffsetNs = (int32_t) BldPacketHeader::setu32LE( (uint32_t) entry.iNanoSecsOffset );
+
+    // Offsets are within +-2.1 s of the header time stamp
+    long long llNanoSecs = (long long) getNanoSecs() + iOffsetNs;
+    long long llSecs     = getSecs();
+    while ( llNanoSecs < 0 )
+    {
+        llNanoSecs += 1000000000LL;
+        llSecs--;
+    }
+    while ( llNanoSecs >= 1000000000LL )
+    {
+        llNanoSecs -= 1000000000LL;
+        llSecs++;
+    }
+
+    if ( pPulse != NULL )
+    {
+        // Entries keep the low 32 bits of the pulse ID, pulses of one
+        // datagram are within 2^31 of the first one
+        const uint32_t uEntryId = BldPacketHeader::setu32LE( entry.uFiducialId );
+        const uint64_t ullFirstId = getPulseId();
+        pPulse->ullPulseId  = ullFirstId == 0 ? 0 :
+                              ullFirstId + (int64_t) (int32_t) ( uEntryId - (uint32_t) ullFirstId );
+        pPulse->uFiducialId = ullFirstId == 0 ? uEntryId : uEntryId & 0x1FFFF;
+        pPulse->uSecs       = (uint32_t) llSecs;
+        pPulse->uNanoSecs   = (uint32_t) llNanoSecs;
+        pPulse->pPayload    = child.pPayload + sizeof(BldPulseIndex) + uPulseCount * sizeof(BldPulseIndexEntry)
+                              + uPulse * uPulseSize;
+        pPulse->sPayload    = uPulseSize;
+    }
+    return 0;
+}
+
+int setPvValuePulseEnergy( int iPvIndex, void* pPvValue, void *payload )
 {
-	char		*	pDstPvString = (char *) payload;
-#if 0
-	if ( iPvIndex == 0 )
-	{
-		const char	*	pSrcPvValue = (char *) pPvValue;
-		strncpy( pDstPvString, pSrcPvValue, 32 );
-	}
-	else
-#endif
-	{
-		double	*	pSrcPvValue = (double*) pPvValue;
-//		double	*	pDstPvValue = ((double*) (pDstPvString+32)) + (iPvIndex-1);
-		double	*	pDstPvValue = (double*) pDstPvString + iPvIndex;
-
-		*pDstPvValue = BldPacketHeader::setdoubleLE(*pSrcPvValue);
-	}
     return 0;
 }
 
-// GMD Packet: Version 0: 32 byte string, 15 doubles, OBSOLETE
-// GMD Packet: Version 1: 6 doubles
-//	From 
-//	cPclass BldDataGMDV1
-//	{
-//		public:
-//		enum	{	version	=	1	};
-//	
-//		double	milliJoulesPerPulse;	// Shot to shot pulse energy (mJ)
-//		double	milliJoulesAverage;		// Average pulse energy from ION cup current (mJ)
-//		double	correctedSumPerPulse;	// Bg corrected waveform integrated within limits in raw A/D counts
-//		double	bgValuePerSample;		// Avg background value per sample in raw A/D counts
-//		double	relativeEnergyPerPulse;	// Shot by shot pulse energy in arbitrary units
-//		double	spare1;					// Spare value for use as needed
-//	
-//		int print() const;
-//	};
-//
-//const size_t	sizeGMD = 32 + sizeof(double)*15;
-const size_t	sizeGMD = sizeof(double)*6;
+// Payload sizes fixed by the BLD ICD
+STATIC_ASSERT( sizeof(BldPhaseCavityPayload)     == sizeof(double)*4 );
+STATIC_ASSERT( sizeof(BldFEEGasDetEnergyPayload) == sizeof(double)*6 );
+STATIC_ASSERT( sizeof(BldGMDPayload)             == sizeof(double)*6 );
+
+/*
+ * Type registry
+ *
+ * Writers hold registryLock. Readers (every packet) take no lock: the
+ * tables are plain words and a field table is published with one atomic
+ * pointer store once it is complete. Replaced field tables are never
+ * freed, a client may still hold one.
+ */
+void BldPacketHeader::_setType( unsigned int uPhysicalId, uint32_t uDataType, unsigned int pktsize,
+  TSetPvFuncPointer func, unsigned int uPvCount, TPackPayloadFuncPointer pack, BldTypeFields* pTypeFields )
+{
+    if ( uPhysicalId >= NumberOfBldTypeId )
+        return;
+    ltXtcDataTypeByBldType[uPhysicalId]   = (XtcDataType) ( uDataType & 0xFFFF );
+    liBldPacketSizeByBldType[uPhysicalId] = pktsize;
+    lfuncSetvFunctionTable[uPhysicalId]   = func;
+    lfuncPackPayloadTable[uPhysicalId]    = pack;
+    luPackPvCountByBldType[uPhysicalId]   = uPvCount;
+    epicsAtomicSetPtrT( &lpvFieldsByBldType[uPhysicalId], pTypeFields );
+}
+
+template <class TPayload>
+void BldPacketHeader::_setLayout( unsigned int uPhysicalId, uint32_t uDataType )
+{
+    _setType( uPhysicalId, uDataType, sizeof(TPayload), &BldPayloadLayout<TPayload>::setPvValue,
+              BldPayloadLayout<TPayload>::uPvCount, &BldPayloadLayout<TPayload>::pack, NULL );
+}
+
+void BldPacketHeader::_initOnce( void* pArg )
+{
+    registryLock = epicsMutexMustCreate();
+    _setType( EBeam, Any, 0, &setPvValuePulseEnergy, 0, NULL, NULL );
+    _setLayout<BldPhaseCavityPayload>(     PhaseCavity,     Id_PhaseCavity );
+    _setLayout<BldFEEGasDetEnergyPayload>( FEEGasDetEnergy, Id_FEEGasDetEnergy );
+    _setLayout<BldGMDPayload>(             GMD,             Id_GMD );
+}
+
 void BldPacketHeader::Initialize(void)
 {
-    if (!init_done) {
-        init_done = 1; /* Do this first, so we don't loop! */
-        Register(EBeam,           Any,                0,                &setPvValuePulseEnergy);
-        Register(PhaseCavity,     Id_PhaseCavity,     sizeof(double)*4, &setPvValuePhaseCavity);
-        Register(FEEGasDetEnergy, Id_FEEGasDetEnergy, sizeof(double)*6, &setPvValueFEEGasDetEnergy);
-        Register(GMD,			  Id_GMD,			  sizeGMD,			&setPvValueGMD );
+    epicsThreadOnce( &registryOnce, &_initOnce, NULL );
+}
+
+void BldPacketHeader::Register( unsigned int uPhysicalId, uint32_t uDataType, unsigned int pktsize,
+  TSetPvFuncPointer func )
+{
+    Initialize();
+    epicsMutexMustLock( registryLock );
+    _setType( uPhysicalId, uDataType, pktsize, func, 0, NULL, NULL );
+    epicsMutexUnlock( registryLock );
+}
+
+void BldPacketHeader::RegisterLayout( unsigned int uPhysicalId, uint32_t uDataType, unsigned int pktsize,
+  TSetPvFuncPointer func, unsigned int uPvCount, TPackPayloadFuncPointer pack )
+{
+    Initialize();
+    epicsMutexMustLock( registryLock );
+    _setType( uPhysicalId, uDataType, pktsize, func, uPvCount, pack, NULL );
+    epicsMutexUnlock( registryLock );
+}
+
+int BldPacketHeader::RegisterFields( unsigned int uPhysicalId, uint32_t uDataType,
+  const BldFieldDesc* pFields, unsigned int uFieldCount )
+{
+    if ( uPhysicalId >= NumberOfBldTypeId || pFields == NULL || uFieldCount == 0 )
+    {
+        printf( "BldPacketHeader::RegisterFields() Physical id %u out of range or no fields\n", uPhysicalId );
+        return 1;
+    }
+
+    unsigned int uPayloadSize = 0, uStageSize = 0;
+    unsigned int* puStageOffset = new unsigned int[uFieldCount];
+    for ( unsigned int uField = 0; uField < uFieldCount; uField++ )
+    {
+        const BldFieldDesc& field = pFields[uField];
+        const unsigned int uDbrSize = getDbrElementSize( field.iDbrType );
+        if ( field.uWireType >= BldFieldDesc::NumberOfWireTypes || uDbrSize == 0 || field.uCount == 0 )
+        {
+            printf( "BldPacketHeader::RegisterFields() Field %u: wire type %u, DBR type %d, %u elements not supported\n",
+                    uField, field.uWireType, field.iDbrType, field.uCount );
+            delete [] puStageOffset;
+            return 1;
+        }
+        uPayloadSize = std::max( uPayloadSize, field.uOffset + field.uCount * luWireSize[field.uWireType] );
+        puStageOffset[uField] = uStageSize;
+        uStageSize += ( field.uCount * uDbrSize + 7 ) & ~7u;
     }
+    // Keep the Xtc extent a multiple of 4 bytes, as BldXtcHeader::extentSize() does for container children
+    uPayloadSize = ( uPayloadSize + 3 ) & ~3u;
+
+    BldFieldDesc* pFieldsCopy = new BldFieldDesc[uFieldCount];
+    std::copy( pFields, pFields + uFieldCount, pFieldsCopy );
+    BldTypeFields* pTypeFields  = new BldTypeFields;
+    pTypeFields->uFieldCount    = uFieldCount;
+    pTypeFields->uPayloadSize   = uPayloadSize;
+    pTypeFields->uStageSize     = uStageSize;
+    pTypeFields->pFields        = pFieldsCopy;
+    pTypeFields->puStageOffset  = puStageOffset;
+
+    Initialize();
+    epicsMutexMustLock( registryLock );
+    _setType( uPhysicalId, uDataType, uPayloadSize, NULL, 0, NULL, pTypeFields );
+    epicsMutexUnlock( registryLock );
+    return 0;
+}
+
+unsigned int BldPacketHeader::getPayloadSize( unsigned int uPhysicalId )
+{
+    return uPhysicalId < NumberOfBldTypeId ? (unsigned int) liBldPacketSizeByBldType[uPhysicalId] : 0;
+}
+
+unsigned int BldPacketHeader::getPackerPvCount( unsigned int uPhysicalId )
+{
+    return uPhysicalId < NumberOfBldTypeId && lfuncPackPayloadTable[uPhysicalId] != NULL ?
+      luPackPvCountByBldType[uPhysicalId] : 0;
+}
+
+const BldTypeFields* BldPacketHeader::getFields( unsigned int uPhysicalId )
+{
+    if ( uPhysicalId >= NumberOfBldTypeId )
+        return NULL;
+    return (const BldTypeFields*) epicsAtomicGetPtrT( &lpvFieldsByBldType[uPhysicalId] );
+}
+
+unsigned int BldPacketHeader::getDbrElementSize( short iDbrType )
+{
+    switch ( iDbrType )
+    {
+    case DBR_CHAR:
+    case DBR_UCHAR:		return 1;
+    case DBR_SHORT:
+    case DBR_USHORT:
+    case DBR_ENUM:		return 2;
+    case DBR_LONG:
+    case DBR_ULONG:
+    case DBR_FLOAT:		return 4;
+    case DBR_DOUBLE:	return 8;
+    default:			return 0;
+    }
+}
+
+/*
+ * Field list of BldRegisterFields()
+ */
+static const struct { const char* sName; unsigned short uWireType; short iDbrType; } lWireNames[] =
+{
+    { "int8",   BldFieldDesc::WireInt8,     DBR_CHAR    },
+    { "uint8",  BldFieldDesc::WireUInt8,    DBR_UCHAR   },
+    { "int16",  BldFieldDesc::WireInt16,    DBR_SHORT   },
+    { "uint16", BldFieldDesc::WireUInt16,   DBR_USHORT  },
+    { "int32",  BldFieldDesc::WireInt32,    DBR_LONG    },
+    { "uint32", BldFieldDesc::WireUInt32,   DBR_ULONG   },
+    { "float",  BldFieldDesc::WireFloat,    DBR_FLOAT   },
+    { "double", BldFieldDesc::WireDouble,   DBR_DOUBLE  },
+};
+
+static const struct { const char* sName; short iDbrType; } lDbrNames[] =
+{
+    { "char", DBR_CHAR }, { "uchar", DBR_UCHAR }, { "short", DBR_SHORT }, { "ushort", DBR_USHORT },
+    { "long", DBR_LONG }, { "ulong", DBR_ULONG }, { "float", DBR_FLOAT }, { "double", DBR_DOUBLE },
+    { "enum", DBR_ENUM },
+};
+
+/// Parse "wire[count][@dbr]", uOffset is left to the caller
+static int parseField( const std::string& sField, BldFieldDesc* pField )
+{
+    const size_t uAt    = sField.find( '@' );
+    const size_t uOpen  = sField.find( '[' );
+    const std::string sWire = sField.substr( 0, std::min( uAt, uOpen ) );
+
+    size_t uWire = 0;
+    while ( uWire < sizeof(lWireNames) / sizeof(lWireNames[0]) && sWire != lWireNames[uWire].sName )
+        uWire++;
+    if ( uWire == sizeof(lWireNames) / sizeof(lWireNames[0]) )
+        return 1;
+    pField->uWireType   = lWireNames[uWire].uWireType;
+    pField->iDbrType    = lWireNames[uWire].iDbrType;
+    pField->uCount      = 1;
+
+    if ( uOpen != std::string::npos && uOpen < uAt )
+    {
+        const std::string sCount = sField.substr( uOpen + 1, std::min( uAt, sField.size() ) - uOpen - 1 );
+        char* pEnd = NULL;
+        const unsigned long uCount = strtoul( sCount.c_str(), &pEnd, 0 );
+        if ( uCount == 0 || uCount > 0xFFFF || pEnd == sCount.c_str() || std::string( pEnd ) != "]" )
+            return 1;
+        pField->uCount = (unsigned short) uCount;
+    }
+
+    if ( uAt != std::string::npos )
+    {
+        const std::string sDbr = sField.substr( uAt + 1 );
+        size_t uDbr = 0;
+        while ( uDbr < sizeof(lDbrNames) / sizeof(lDbrNames[0]) && sDbr != lDbrNames[uDbr].sName )
+            uDbr++;
+        if ( uDbr == sizeof(lDbrNames) / sizeof(lDbrNames[0]) )
+            return 1;
+        pField->iDbrType = lDbrNames[uDbr].iDbrType;
+    }
+    return 0;
 }
 
 } // namespace EpicsBld
@@ -244,4 +735,42 @@ extern "C"
     {
         EpicsBld::BldPacketHeader::Register(uPhysicalId, uDataType, pktsize, func);
     }
+
+    int BldRegisterFields(unsigned int uPhysicalId, uint32_t uDataType, const char* sFields)
+    {
+        using EpicsBld::BldFieldDesc;
+
+        if ( sFields == NULL )
+        {
+            printf( "BldRegisterFields(): No field list\n" );
+            return 1;
+        }
+
+        // Fields follow each other at their natural alignment
+        const std::string sList( sFields );
+        const char* sSeparators = " \t,";
+        std::vector<BldFieldDesc> vFields;
+        unsigned int uOffset = 0;
+        size_t uStart = sList.find_first_not_of( sSeparators );
+        while ( uStart != std::string::npos )
+        {
+            const size_t uEnd = std::min( sList.find_first_of( sSeparators, uStart ), sList.size() );
+            const std::string sField = sList.substr( uStart, uEnd - uStart );
+            BldFieldDesc field;
+            if ( EpicsBld::parseField( sField, &field ) != 0 )
+            {
+                printf( "BldRegisterFields(): Bad field \"%s\", expected wire[count][@dbr]\n", sField.c_str() );
+                return 1;
+            }
+            const unsigned int uWireSize = EpicsBld::luWireSize[field.uWireType];
+            uOffset = ( uOffset + uWireSize - 1 ) / uWireSize * uWireSize;
+            field.uOffset = uOffset;
+            uOffset += field.uCount * uWireSize;
+            vFields.push_back( field );
+            uStart = sList.find_first_not_of( sSeparators, uEnd );
+        }
+
+        return EpicsBld::BldPacketHeader::RegisterFields( uPhysicalId, uDataType,
+          vFields.empty() ? NULL : &vFields[0], (unsigned int) vFields.size() );
+    }
 }
@@ -7,6 +7,36 @@ namespace EpicsBld
 {   
 
 typedef int (*TSetPvFuncPointer)(int iPvIndex, void* pPvValue, void* payload);
+typedef int (*TPackPayloadFuncPointer)(const double* pdValues, unsigned int uCount, void* payload);
+
+/**
+ * One field of a data-driven payload layout, see BldPacketHeader::RegisterFields()
+ *
+ * The PV at the field's position in the PV list is read as iDbrType and
+ * stored as uCount little-endian elements of uWireType at uOffset. A PV
+ * with fewer elements leaves the rest of the field zero.
+ */
+struct BldFieldDesc
+{
+    enum EWireType  {   WireInt8,   WireUInt8,  WireInt16,  WireUInt16,
+                        WireInt32,  WireUInt32, WireFloat,  WireDouble,
+                        NumberOfWireTypes };
+
+    unsigned int    uOffset;        /// payload byte offset, need not be aligned
+    unsigned short  uWireType;      /// EWireType
+    unsigned short  uCount;         /// elements
+    short           iDbrType;       /// DBR_CHAR .. DBR_DOUBLE or DBR_ENUM, not DBR_STRING
+};
+
+/// Field table of a BLD type, never changed or freed once registered
+struct BldTypeFields
+{
+    unsigned int            uFieldCount;
+    unsigned int            uPayloadSize;   /// end of the last field, rounded up to 4 bytes
+    unsigned int            uStageSize;     /// PV values packFields() reads, see puStageOffset
+    const BldFieldDesc*     pFields;
+    const unsigned int*     puStageOffset;  /// where each field's PV values start, 8-byte aligned
+};
     
 class BldPacketHeader
 {
@@ -155,40 +185,96 @@ public:
 	int Setup(	unsigned int	sData,		uint32_t	uSecs1,		uint32_t	uNSecs,
 				uint32_t		uFiducial,	uint32_t	uPhysId,	uint32_t	uXtcType	);
 
+	// Container form: Xtc section 1 becomes an Id_Xtc parent of sChildren
+	// bytes of child Xtcs, section 2 is left to the first child
+	int SetupContainer(	uint32_t	uSecs1,		uint32_t	uNSecs,		uint32_t	uFiducial,
+						uint32_t	uPhysId,	unsigned int	sChildren,
+						uint32_t	uXtcType = Id_Xtc	);
+
+    // Idempotent and thread-safe, registers the built-in types on first use
     static void Initialize(void);
 
+    // Registration is thread-safe and replaces what the type had. A client
+    // sending the type picks the change up at its next bldStart().
     static void Register(unsigned int uPhysicalId, uint32_t uDataType, unsigned int pktsize,
-                         TSetPvFuncPointer func) 
-    {
-        Initialize();
-        if (uPhysicalId < NumberOfBldTypeId) {
-            ltXtcDataTypeByBldType[uPhysicalId] = (XtcDataType) ( uDataType & 0xFFFF );
-            liBldPacketSizeByBldType[uPhysicalId] = pktsize;
-            lfuncSetvFunctionTable[uPhysicalId] = func;
-        }
-    }
+                         TSetPvFuncPointer func);
+
+    // Typed layout: a per-PV setter plus a whole-packet packer taking uPvCount
+    // doubles, see BldRegisterLayout() in bldPayloadLayout.h
+    static void RegisterLayout(unsigned int uPhysicalId, uint32_t uDataType, unsigned int pktsize,
+                               TSetPvFuncPointer func, unsigned int uPvCount, TPackPayloadFuncPointer pack);
+
+    // Field table: the table is copied and the payload size is the end of
+    // the last field. Returns nonzero, registering nothing, if a field is invalid.
+    static int RegisterFields(unsigned int uPhysicalId, uint32_t uDataType,
+                              const BldFieldDesc* pFields, unsigned int uFieldCount);
 
-    unsigned int getPacketSize()
+    /// Registered payload size of this type in bytes, 0 if it has none
+    static unsigned int getPayloadSize(unsigned int uPhysicalId);
+    /// PVs packPayload() needs for this type, 0 if it has no typed layout
+    static unsigned int getPackerPvCount(unsigned int uPhysicalId);
+    /// Field table of this type, NULL if it has none
+    static const BldTypeFields* getFields(unsigned int uPhysicalId);
+    /// Bytes per element of a DBR type a field may be read as, 0 for the others
+    static unsigned int getDbrElementSize(short iDbrType);
+
+    unsigned int getPacketSize() const
     {
         return (unsigned int)  setu32LE(uExtentSize) + 10 * sizeof(uint32_t);
     }
     
 	void setPacketSize( unsigned int	sData );
 
-    int setPvValue( int iPvIndex, void* pPvValue );
+	// The per-shot words of a header copied from one the full constructor built
+	void setTimeStamp( uint32_t uSecs1, uint32_t uNanoSecs1, uint32_t uFiducialId1 )
+	{
+		uNanoSecs	= setu32LE( uNanoSecs1 );
+		uSecs		= setu32LE( uSecs1 );
+		uFiducialId	= setu32LE( uFiducialId1 );
+	}
+
+	// 64-bit pulse ID in the MBZ words, high half in uMBZ1; 0 means none.
+	// uFiducialId keeps the low 17 bits so fiducial-only receivers still work
+	void setPulseId( uint64_t ullPulseId )
+	{
+		uMBZ1 = setu32LE( (uint32_t) ( ullPulseId >> 32 ) );
+		uMBZ2 = setu32LE( (uint32_t) ullPulseId );
+	}
+
+	uint64_t getPulseId() const
+	{
+		return ( (uint64_t) setu32LE( uMBZ1 ) << 32 ) | setu32LE( uMBZ2 );
+	}
+
+    // One PV; lNumElements matters to field tables only, -1 for the full field
+    int setPvValue( int iPvIndex, void* pPvValue, long lNumElements = -1 );
+    // All PV values of the packet in one call, nonzero if the type has no packer or uCount is short
+    int packPayload( const double* pdValues, unsigned int uCount );
+    // All fields of a field table in one loop, field i from pStage + puStageOffset[i] holding plCounts[i] elements
+    int packFields( const BldTypeFields* pTypeFields, const char* pStage, const long* plCounts );
 
 private:    
+    friend class BldXtcHeader;
+
     static const uint32_t uBldLogicalId = 0x06000000; // from PDS Repository: pdsdata/xtc/Level.hh: Level::Reporter            
     static const uint32_t uDamgeTrue = 0x4000; // from Bld ICD
 
-    static int init_done;
-    
     /*
-     * static tables
+     * static tables, written under the registry lock only
      */    
     static XtcDataType ltXtcDataTypeByBldType[NumberOfBldTypeId];
     static int liBldPacketSizeByBldType[NumberOfBldTypeId];
     static TSetPvFuncPointer lfuncSetvFunctionTable[NumberOfBldTypeId];
+    static TPackPayloadFuncPointer lfuncPackPayloadTable[NumberOfBldTypeId];
+    static unsigned int luPackPvCountByBldType[NumberOfBldTypeId];
+    static void* lpvFieldsByBldType[NumberOfBldTypeId];   /// BldTypeFields*, published atomically
+
+    static void _initOnce(void* pArg);
+    static void _setType(unsigned int uPhysicalId, uint32_t uDataType, unsigned int pktsize,
+                         TSetPvFuncPointer func, unsigned int uPvCount, TPackPayloadFuncPointer pack,
+                         BldTypeFields* pTypeFields);
+    template <class TPayload>
+    static void _setLayout(unsigned int uPhysicalId, uint32_t uDataType);
 
 public:  
 // Check for little endian
@@ -225,6 +311,172 @@ public:
     
 };
 
+/**
+ * One Xtc header as it appears on the wire, little-endian like BldPacketHeader
+ *
+ * Xtc section 2 of BldPacketHeader has this layout. In a container packet
+ * each child source starts with one, followed by its payload padded to a
+ * multiple of 4 bytes; the extent covers header, payload and padding.
+ */
+class BldXtcHeader
+{
+public:
+    uint32_t uDamage;
+    uint32_t uLogicalId;
+    uint32_t uPhysicalId;
+    uint32_t uDataType;
+    uint32_t uExtentSize;
+
+    /// Set up the Xtc of a child with sData bytes of payload, return its extent
+    unsigned int Setup( uint32_t uPhysId, uint32_t uXtcType, unsigned int sData );
+
+    static unsigned int extentSize( unsigned int sData )
+    {
+        return sizeof(BldXtcHeader) + ( ( sData + 3 ) & ~3u );
+    }
+};
+
+/**
+ * Packs the payloads of several BLD sources into one container datagram
+ *
+ * Xtc section 1 of the header is an Id_Xtc parent whose extent covers one
+ * child Xtc per source (see BldXtcHeader), so an IOC sending many small BLD
+ * types on one fiducial sends one datagram instead of one per source.
+ * Receivers must opt in, BldPacketDecoder reads both forms.
+ *
+ * Design Issue:
+ * 1. The buffer is owned by the caller, 4-byte aligned, and must outlive the packer.
+ * 2. The value semantics are disabled.
+ */
+class BldContainerPacket
+{
+public:
+    BldContainerPacket( char* pBuffer, unsigned int uBufferSize );
+
+    /// Start a new datagram, dropping any children added so far
+    void Setup( uint32_t uSecs1, uint32_t uNSecs, uint32_t uFiducial, uint32_t uPhysId );
+
+    /// Add a child of sData bytes, return where its payload goes, NULL if it does not fit
+    void* reserveChild( uint32_t uPhysId, uint32_t uXtcType, unsigned int sData );
+    /// Add a child and copy its payload in, return 0 if successful, 1 if it does not fit
+    int addChild( uint32_t uPhysId, uint32_t uXtcType, const void* pData, unsigned int sData );
+
+    bool fits( unsigned int sData ) const
+    {
+        return _uSize + BldXtcHeader::extentSize( sData ) <= _uBufferSize;
+    }
+    unsigned int getChildCount() const { return _uChildCount; }
+    unsigned int getPacketSize() const { return _uSize; }
+    const char* getPacket() const { return _pBuffer; }
+
+    /// Bytes in front of the first child: time stamp, fiducial and the parent Xtc
+    static unsigned int prefixSize() { return sizeof(BldPacketHeader) - sizeof(BldXtcHeader); }
+
+private:
+    char*           _pBuffer;
+    unsigned int    _uBufferSize;
+    unsigned int    _uSize;
+    unsigned int    _uChildCount;
+
+    ///  Disable value semantics. No definitions (function bodies).
+    BldContainerPacket(const BldContainerPacket&);
+    BldContainerPacket& operator=(const BldContainerPacket&);
+};
+
+/**
+ * Per-pulse index of a multi-pulse datagram
+ *
+ * A multi-pulse datagram is a container whose parent type is uMultiPulseType
+ * and whose one child is the source's Xtc. The child payload is this index,
+ * uPulseCount BldPulseIndexEntry, then uPulseCount payloads of uPulseSize
+ * bytes. The header time stamp and fiducial are those of the first pulse.
+ */
+struct BldPulseIndex
+{
+    enum { uMultiPulseType = BldPacketHeader::Id_Xtc | (1 << 16) };    /// Id_Xtc, version 1
+
+    uint32_t uPulseCount;
+    uint32_t uPulseSize;
+};
+
+/**
+ * One pulse of a multi-pulse datagram, its time is relative to the header time stamp
+ *
+ * When the header carries a pulse ID, uFiducialId holds the low 32 bits of the
+ * pulse's own ID, the fiducial being its low 17 bits.
+ */
+struct BldPulseIndexEntry
+{
+    uint32_t uFiducialId;
+    int32_t  iNanoSecsOffset;
+};
+
+/// One source of a received datagram, as returned by BldPacketDecoder
+struct BldXtcChild
+{
+    uint32_t        uDamage;
+    uint32_t        uPhysicalId;
+    uint32_t        uDataType;
+    const char*     pPayload;
+    unsigned int    sPayload;       /// padding included for container children
+};
+
+/// One pulse of a multi-pulse child, as returned by BldPacketDecoder::getPulse()
+struct BldPulse
+{
+    uint64_t        ullPulseId;     /// 0 unless the datagram carries pulse IDs
+    uint32_t        uFiducialId;
+    uint32_t        uSecs;
+    uint32_t        uNanoSecs;
+    const char*     pPayload;
+    unsigned int    sPayload;
+};
+
+/**
+ * Walks the sources of a received BLD datagram, single-source or container
+ *
+ * Fields are returned in host byte order. Every extent is checked against
+ * the datagram size before it is followed.
+ */
+class BldPacketDecoder
+{
+public:
+    BldPacketDecoder( const char* pPacket, unsigned int uPacketSize );
+
+    /// Header complete and its extent inside the datagram
+    bool isValid() const { return _bValid; }
+    bool isContainer() const { return _bContainer; }
+    bool isMultiPulse() const
+    {
+        return _bContainer && BldPacketHeader::setu32LE( _header.uDataType ) == BldPulseIndex::uMultiPulseType;
+    }
+
+    uint32_t getSecs() const { return BldPacketHeader::setu32LE( _header.uSecs ); }
+    uint32_t getNanoSecs() const { return BldPacketHeader::setu32LE( _header.uNanoSecs ); }
+    uint32_t getFiducialId() const { return BldPacketHeader::setu32LE( _header.uFiducialId ); }
+    /// 64-bit pulse ID, 0 if the sender only sets the fiducial
+    uint64_t getPulseId() const { return _header.getPulseId(); }
+    /// Physical id of the parent Xtc, the only source of a single-source datagram
+    uint32_t getPhysicalId() const { return BldPacketHeader::setu32LE( _header.uPhysicalId ); }
+
+    /// Next source: 0 and *pChild filled in, 1 after the last one, -1 if the datagram is malformed
+    int nextChild( BldXtcChild* pChild );
+    void rewind() { _uOffset = BldContainerPacket::prefixSize(); }
+
+    /// Number of pulses in a child of a multi-pulse datagram, 0 if its index is malformed
+    unsigned int getPulseCount( const BldXtcChild& child ) const;
+    /// Pulse uPulse of a child: 0 and *pPulse filled in, 1 if there is no such pulse, -1 if malformed
+    int getPulse( const BldXtcChild& child, unsigned int uPulse, BldPulse* pPulse ) const;
+
+private:
+    BldPacketHeader _header;        /// copied out, received buffers need not be aligned
+    const char*     _pPacket;
+    unsigned int    _uEnd;          /// end of the parent Xtc
+    unsigned int    _uOffset;       /// next child Xtc
+    bool            _bValid;
+    bool            _bContainer;
+};
+
 }
 
 extern "C" void BldRegister(	unsigned int	uPhysicalId,
@@ -232,4 +484,16 @@ extern "C" void BldRegister(	unsigned int	uPhysicalId,
 								unsigned int	pktsize,
                             	int (*func)(int iPvIndex, void* pPvValue, void* payload) );
 
+/*
+ * Register a BLD type from a field list, for iocsh: fields separated by
+ * spaces or commas, each "wire[count][@dbr]", laid out in order at their
+ * natural alignment. wire is int8, uint8, int16, uint16, int32, uint32,
+ * float or double; dbr is char, uchar, short, ushort, long, ulong, float,
+ * double or enum, the one matching wire by default.
+ * Example: "double double float[16]@double uint32@long"
+ */
+extern "C" int BldRegisterFields(	unsigned int	uPhysicalId,
+									uint32_t		uDataType,
+									const char	*	sFields );
+
 #endif
@@ -0,0 +1,93 @@
+#ifndef BLD_PAYLOAD_LAYOUT_H
+#define BLD_PAYLOAD_LAYOUT_H
+
+#include <epicsAssert.h>
+
+#include "bldPacket.h"
+#include "bldByteSwap.h"
+
+namespace EpicsBld
+{
+/*
+ * Typed payloads of the built-in BLD types, from pdsdata/bld/bldData.hh
+ *
+ * One double per PV, in PV list order. BldPayloadLayout<> derives the
+ * payload size and the packers from the struct.
+ */
+struct BldPhaseCavityPayload
+{
+    double  fFitTime1;                  // ps
+    double  fFitTime2;                  // ps
+    double  fCharge1;                   // pC
+    double  fCharge2;                   // pC
+};
+
+struct BldFEEGasDetEnergyPayload
+{
+    double  f_11_ENRC;                  // mJ
+    double  f_12_ENRC;                  // mJ
+    double  f_21_ENRC;                  // mJ
+    double  f_22_ENRC;                  // mJ
+    double  f_63_ENRC;                  // mJ, version 1
+    double  f_64_ENRC;                  // mJ, version 1
+};
+
+// GMD Packet: Version 1 (BldDataGMDV1), version 0 with its 32 byte string is obsolete
+struct BldGMDPayload
+{
+    double  milliJoulesPerPulse;        // Shot to shot pulse energy (mJ)
+    double  milliJoulesAverage;         // Average pulse energy from ION cup current (mJ)
+    double  correctedSumPerPulse;       // Bg corrected waveform integrated within limits in raw A/D counts
+    double  bgValuePerSample;           // Avg background value per sample in raw A/D counts
+    double  relativeEnergyPerPulse;     // Shot by shot pulse energy in arbitrary units
+    double  spare1;                     // Spare value for use as needed
+};
+
+/**
+ * Compile-time packers of a typed payload
+ *
+ * pack() takes the values of a whole packet and stores them with one
+ * BldStoreLE64() call, setPvValue() stores one value and is the
+ * TSetPvFuncPointer used where PVs arrive one at a time (monitor mode).
+ *
+ * Design Issue:
+ * 1. TPayload must hold doubles only, so it has no padding and its size
+ *    gives the PV count; this is checked when the packers are instantiated.
+ * 2. PVs past the end of the layout are ignored, the packet size of the
+ *    type never covers them.
+ */
+template <class TPayload>
+class BldPayloadLayout
+{
+public:
+    enum { uPvCount = sizeof(TPayload) / sizeof(double) };
+
+    static int pack( const double* pdValues, unsigned int uCount, void* pPayload )
+    {
+        STATIC_ASSERT( sizeof(TPayload) % sizeof(double) == 0 );
+        if ( uCount < (unsigned int) uPvCount )
+            return 1;
+        BldStoreLE64( pdValues, uPvCount, pPayload );
+        return 0;
+    }
+
+    static int setPvValue( int iPvIndex, void* pPvValue, void* pPayload )
+    {
+        STATIC_ASSERT( sizeof(TPayload) % sizeof(double) == 0 );
+        if ( iPvIndex >= 0 && iPvIndex < (int) uPvCount )
+            ((double*) pPayload)[iPvIndex] = BldPacketHeader::setdoubleLE( *(double*) pPvValue );
+        return 0;
+    }
+};
+
+/// Register a BLD type by its typed payload, see BldPacketHeader::RegisterLayout()
+template <class TPayload>
+void BldRegisterLayout( unsigned int uPhysicalId, uint32_t uDataType )
+{
+    BldPacketHeader::RegisterLayout( uPhysicalId, uDataType, sizeof(TPayload), &BldPayloadLayout<TPayload>::setPvValue,
+                                     BldPayloadLayout<TPayload>::uPvCount, &BldPayloadLayout<TPayload>::pack );
+}
+
+} // namespace EpicsBld
+
+#endif
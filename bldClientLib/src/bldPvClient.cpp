@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <assert.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <algorithm>
 #include <memory>
+#include <new>
 #include <string>
 #include <vector>
 #include <string.h>
@@ -13,15 +15,25 @@
 #include <registryFunction.h>
 #include <subRecord.h>
 #include <epicsExport.h>
+#include <epicsAtomic.h>
+#include <epicsMutex.h>
+#include <epicsThread.h>
 #include <epicsTime.h>
+#include <epicsTimer.h>
 #include <dbAddr.h>
 #include <dbAccess.h>
+#include <dbLock.h>
 #include <dbTest.h>
+#include <dbChannel.h>
+#include <dbEvent.h>
+#include <caeventmask.h>
 
 #include "bldPvClient.h"
 #include "bldNetworkClient.h"
 #include "bldClientSub.h"
 #include "bldPacket.h"
+#include "bldByteSwap.h"
+#include "bldAsyncSender.h"
 
 /*
  * Global C function definitions
@@ -121,6 +133,115 @@ int BldSendPacket(	int					bldClientId,
     return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSendPacket( srcId, xtcType, pts, pPkt, sPkt );
 }
 
+int BldSendPacketPulseId(	int					bldClientId,
+							unsigned int		srcId,
+							unsigned int		xtcType,
+							epicsTimeStamp	*	pts,
+							unsigned long long	ullPulseId,
+							void			*	pPkt,
+							size_t				sPkt	)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSendPacketPulseId( srcId, xtcType, pts, ullPulseId, pPkt, sPkt );
+}
+
+int BldSendPackets(	int						bldClientId,
+					epicsTimeStamp		*	pts,
+					const BldPacketDesc	*	pPackets,
+					unsigned int			uPacketCount )
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSendPackets( pts, pPackets, uPacketCount );
+}
+
+void* BldAcquirePacket(int bldClientId, size_t sPkt)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldAcquirePacket( sPkt );
+}
+
+int BldCommitPacket(	int					bldClientId,
+						void			*	pPayload,
+						unsigned int		srcId,
+						unsigned int		xtcType,
+						epicsTimeStamp	*	pts,
+						size_t				sPkt	)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldCommitPacket( pPayload, srcId, xtcType, pts, sPkt );
+}
+
+void BldReleasePacket(int bldClientId, void* pPayload)
+{
+    EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldReleasePacket( pPayload );
+}
+
+int BldSetBatchMode(int bldClientId, unsigned int uMaxBatch, unsigned int uDeadlineUs)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetBatchMode( uMaxBatch, uDeadlineUs );
+}
+
+int BldFlush(int bldClientId)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldFlush();
+}
+
+int BldSetAsyncMode(int bldClientId, unsigned int uRingDepth, int iOverflowPolicy)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetAsyncMode( uRingDepth, iOverflowPolicy );
+}
+
+int BldSetBackpressure(int bldClientId, int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetBackpressure( iPolicy, uSndBufPackets, uPolicyArg );
+}
+
+int BldSetMonitorMode(int bldClientId, int iEnable)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetMonitorMode( iEnable );
+}
+
+int BldSetContainerMode(int bldClientId, int iEnable, unsigned int uPhysicalId)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetContainerMode( iEnable, uPhysicalId );
+}
+
+int BldSetPulseBatch(int bldClientId, unsigned int uMaxPulses, unsigned int uDeadlineUs)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetPulseBatch( uMaxPulses, uDeadlineUs );
+}
+
+int BldSetPulseIdMode(int bldClientId, int iEnable)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetPulseIdMode( iEnable );
+}
+
+int BldSetNetworkFlags(int bldClientId, unsigned int uFlags)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetNetworkFlags( uFlags );
+}
+
+int BldSetTransport(int bldClientId, const char* sTransport)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldSetTransport( sTransport );
+}
+
+void BldShowTransports(void)
+{
+    EpicsBld::BldNetworkClientFactory::showTransports();
+}
+
+int BldGetStats(int bldClientId, BldSendStats* pClientStats, BldSendStats* pNetworkStats)
+{
+    return EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldGetStats( pClientStats, pNetworkStats );
+}
+
+void BldResetStats(int bldClientId)
+{
+    EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldResetStats();
+}
+
+void BldShowStats(int bldClientId, int iReset)
+{
+    EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).bldShowStats( iReset );
+}
+
 void BldSetDebugLevel(int bldClientId, int iDebugLevel)
 {
     EpicsBld::BldPvClientFactory::getSingletonBldPvClient(bldClientId).setDebugLevel(iDebugLevel);
@@ -174,6 +295,40 @@ public:
 			epicsTimeStamp	*	pTsFiducial,
 			void			*	pPacket,
 			size_t				sPacket	); 
+    virtual int bldSendPacketPulseId(
+			unsigned int		srcPhysicalId,
+			unsigned int		xtcDataType,
+			epicsTimeStamp	*	pTsFiducial,
+			unsigned long long	ullPulseId,
+			void			*	pPacket,
+			size_t				sPacket	);
+    virtual int bldSendPackets(
+			epicsTimeStamp		*	pTsFiducial,
+			const BldPacketDesc	*	pPackets,
+			unsigned int			uPacketCount );
+    virtual void* bldAcquirePacket( size_t sPacket );
+    virtual int bldCommitPacket(
+			void			*	pPayload,
+			unsigned int		srcPhysicalId,
+			unsigned int		xtcDataType,
+			epicsTimeStamp	*	pTsFiducial,
+			size_t				sPacket	);
+    virtual void bldReleasePacket( void* pPayload );
+
+    virtual int bldSetBatchMode( unsigned int uMaxBatch, unsigned int uDeadlineUs );
+    virtual int bldFlush();
+    virtual int bldSetAsyncMode( unsigned int uRingDepth, int iOverflowPolicy );
+    virtual int bldSetBackpressure( int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg );
+    virtual int bldSetNetworkFlags( unsigned int uFlags );
+    virtual int bldSetMonitorMode( int iEnable );
+    virtual int bldSetContainerMode( int iEnable, unsigned int uPhysicalId );
+    virtual int bldSetPulseBatch( unsigned int uMaxPulses, unsigned int uDeadlineUs );
+    virtual int bldSetPulseIdMode( int iEnable );
+    virtual int bldSetTransport( const char* sTransport );
+
+    virtual int bldGetStats( BldSendStats* pClientStats, BldSendStats* pNetworkStats );
+    virtual void bldResetStats();
+    virtual void bldShowStats( int iReset );
 
     // debug information control
     virtual void setDebugLevel(int iDebugLevel);
@@ -187,11 +342,38 @@ public:
 	}
 
     static BldPvClientBasic& getSingletonObject(int bldClientId); // singelton interface
+
+    // Checks a PV list the way bldStart() lays it out, without the database
+    static int checkPvList( unsigned int uSrcPhysicalId, unsigned int uMaxDataSize, const char* sBldPvList );
     
 private:
+    /*
+     * Client registry: BLD_MAX_CLIENTS slots in chunks of uClientChunkSize,
+     * a chunk is allocated with the first client in it. Slots and chunks are
+     * published with epicsAtomicSetPtrT() once filled and never cleared, so
+     * getSingletonObject() only takes _registryLock to create a client.
+     */
+    enum { uClientChunkSize = 16, uClientChunks = BLD_MAX_CLIENTS / uClientChunkSize };
+    static EpicsAtomicPtrT      _lpClientChunks[uClientChunks];
+    static epicsMutexId         _registryLock;
+    static epicsThreadOnceId    _registryOnce;
+    static void _registryInit(void* pArg);
+    static BldPvClientBasic& _createClient(int bldClientId);
+
+    /// Clients start on their own cache line and are padded to whole lines
+    enum { uCacheLine = 64 };
+    static void* operator new(size_t uSize);
+    static void operator delete(void* p);
+    static void* _mallocAligned(size_t uSize);
+    static void _freeAligned(void* p);
+
     bool _bBldStarted;
     std::auto_ptr<EpicsBld::BldNetworkClientInterface> _apBldNetworkClient;
+    std::auto_ptr<EpicsBld::BldAsyncSender> _apBldAsyncSender;
+    epicsMutexId    _networkLock;   /// held to replace _apBldNetworkClient, and by the stats calls reading it
     int _iDebugLevel;
+
+    void _resetNetworkClient( EpicsBld::BldNetworkClientInterface* pNetworkClient );
     
     string          _sBldPvPreSubRec, _sBldPvPostSubRec;
     unsigned int    _uBldServerAddr;
@@ -201,9 +383,20 @@ private:
     unsigned int    _uSrcPhysicalId, _uxtcDataType;
     string          _sBldPvPreTrigger, _sBldPvPostTrigger, _sBldPvFiducial;
     string          _sBldPvList, _sBldPvPreTriggerPrevFLNK, _sBldPvPostTriggerPrevFLNK;
-    unsigned int    _uFiducialIdPrev;
+    int             _iFiducialIdPrev;  /// last fiducial sent, only through _exchangeFiducial()
     unsigned int    _uFiducialIdCur;
+    bool            _bPulseIdMode;     /// fiducial PV holds a 64-bit pulse ID, set while stopped
+    unsigned long long _ullPulseIdCur; /// read by bldPrepareData() in pulse-ID mode
     epicsTimeStamp  _uFiducialTime;
+    BldPacketHeader _headerTemplate;   /// bldSendData() header built by bldStart(), little-endian
+    unsigned int    _uBatchMax, _uBatchDeadlineUs;
+    unsigned int    _uAsyncRingDepth;
+    int             _iAsyncOverflow;
+    int             _iBpPolicy;
+    unsigned int    _uBpSndBufPackets, _uBpPolicyArg;
+    unsigned int    _uNetworkFlags;
+    string          _sTransport;
+    BldSendStatsCounter _sendStats;    /// bldSendData()/bldSendPacket() calls, packing included
     
      BldPvClientBasic(); /// Singleton. No explicit instantiation
      ~BldPvClientBasic();
@@ -218,14 +411,305 @@ private:
 #define iMTU 9000   // Ethernet packet MTU
     static const char sPvListSeparators[];
 
-    long llBufPvVal[iMTU / sizeof(long)]; // Align with long int boundaries
-    char lcMsgBuffer[iMTU];
+    /*
+     * Per-shot buffers, sized from _uMaxDataSize by _allocBuffers() at
+     * bldStart() and kept until the client is destroyed
+     */
+    enum { uPvBufferMinSize = 512 };    /// room for the FLNK strings bldStart()/bldStop() read
+    long*           llBufPvVal;         /// PV value scratch, _uPvBufferSize bytes, cache line aligned
+    char*           lcMsgBuffer;        /// packet under construction, _uMsgBufferSize bytes
+    unsigned int    _uPvBufferSize;
+    unsigned int    _uMsgBufferSize;
+
+    void _allocBuffers();
+    void _freeBuffers();
+    static unsigned int _pvBufferSize( unsigned int uMaxDataSize );
+
+    /**
+     * One PV of the read plan
+     *
+     * Resolved once by bldStart(), so bldSendData() and bldPrepareData()
+     * do no string work, allocation or name lookups per shot.
+     */
+    struct BldPvPlanEntry
+    {
+        DBADDR          dbAddr;
+        string          sName;              /// PV name as resolved, without a "[N]" suffix
+        short           iRequestType;       /// DBR type asked of dbGetField(), DBR_STRING for enums
+        long            lNumElements;       /// elements that fit in _uPvBufferSize bytes
+        unsigned int    uPayloadOffset;     /// where it goes in the payload, a double slot unless a field table says
+        unsigned int    uArrayCount;        /// N of a "NAME[N]" entry, 0 for a scalar PV
+        int             iSetterIndex;       /// setPvValue() index: the field, or the first double slot
+    };
+    std::vector<BldPvPlanEntry> _vPvPlan;   /// _sBldPvList in order, read-only while started
+    BldPvPlanEntry  _fiducialPlan;
+    bool            _bFiducialPlanned;
+
+    int _buildReadPlan();
+
+    /// Types with a typed layout (bldPayloadLayout.h) stage the PV values
+    /// here and pack them in one pass, 0 when the per-PV setter is used
+    unsigned int        _uPackPvCount;
+    std::vector<double> _vdPvStage;
+
+    /// Types with a field table stage each PV's raw DBR values and counts
+    /// and pack them with one packFields() call, NULL otherwise
+    const BldTypeFields* _pTypeFields;
+    std::vector<double>  _vdFieldStage;     /// _pTypeFields->uStageSize bytes, double for alignment
+    std::vector<long>    _vlFieldCounts;
+
+    /// Store lNumElements doubles of an array entry in its payload slots, little-endian, zero filling the rest
+    static void _storePvArray( const BldPvPlanEntry& pvPlan, const void* pValues, long lNumElements, char* pPayload )
+    {
+        BldStoreLE64( pValues, (unsigned int) lNumElements, pPayload + pvPlan.uPayloadOffset );
+        memset( pPayload + pvPlan.uPayloadOffset + lNumElements * sizeof(double), 0,
+          ( pvPlan.uArrayCount - lNumElements ) * sizeof(double) );
+    }
+
+    /// Store lNumElements values in llBufPvVal as PV uPvIndex of the packet
+    int _storePvValue( BldPacketHeader* pBldPacketHeader, unsigned int uPvIndex, long lNumElements )
+    {
+        if ( _pTypeFields != NULL )
+        {
+            if ( uPvIndex < _pTypeFields->uFieldCount )
+            {
+                memcpy( (char*) &_vdFieldStage[0] + _pTypeFields->puStageOffset[uPvIndex], llBufPvVal,
+                  lNumElements * BldPacketHeader::getDbrElementSize( _pTypeFields->pFields[uPvIndex].iDbrType ) );
+                _vlFieldCounts[uPvIndex] = lNumElements;
+            }
+            return 0;
+        }
+        const BldPvPlanEntry& pvPlan = _vPvPlan[uPvIndex];
+        if ( _uPackPvCount == 0 )
+        {
+            if ( pvPlan.uArrayCount == 0 )
+                return pBldPacketHeader->setPvValue( pvPlan.iSetterIndex, llBufPvVal, lNumElements );
+            _storePvArray( pvPlan, llBufPvVal, lNumElements, (char*) (pBldPacketHeader + 1) );
+            return 0;
+        }
+        // Array slots were checked against the layout by _buildReadPlan()
+        double* pdStage = &_vdPvStage[0] + pvPlan.iSetterIndex;
+        if ( pvPlan.uArrayCount != 0 )
+        {
+            memcpy( pdStage, llBufPvVal, lNumElements * sizeof(double) );
+            std::fill( pdStage + lNumElements, pdStage + pvPlan.uArrayCount, 0.0 );
+        }
+        else if ( (unsigned int) pvPlan.iSetterIndex < _uPackPvCount )
+            *pdStage = *(double*) llBufPvVal;
+        return 0;
+    }
+
+    /**
+     * PVs of the read plan that share a lockset
+     *
+     * bldSendData() takes the lockset's scan lock once and reads all of them
+     * with dbGet(), instead of one dbGetField() lock round trip per PV.
+     */
+    struct BldPvLockGroup
+    {
+        unsigned long   uLockId;            /// dbLockGetLockId() at bldStart, for bldShowConfig
+        unsigned int    uFirst;             /// first slot in _vuLockOrder
+        unsigned int    uCount;
+    };
+    std::vector<BldPvLockGroup> _vLockGroups;
+    std::vector<unsigned int>   _vuLockOrder;       /// _vPvPlan indices, grouped by lockset
+    std::vector<unsigned int>   _vuLockDeferred;    /// scratch: PVs that left their lockset since bldStart
+    unsigned long   _uLockPackets;          /// packets read through _vLockGroups
+    unsigned long   _uLockAcquisitions;     /// scan lock round trips for them
+    unsigned long   _uLockFallbacks;        /// PVs read on their own since they left their lockset
+    size_t          _uPlanPvCount;          /// _vPvPlan and _vLockGroups sizes for the stats,
+    size_t          _uPlanLockGroupCount;   /// set by bldStart() and bldStop()
+
+    void _groupByLockset();
+    void _readLockGroups( BldPacketHeader* pBldPacketHeader );
+
+    /*
+     * Monitor mode: dbEvent subscriptions on dbChannels (EPICS 3.15 and
+     * later) keep a shadow payload current, so
+     * bldSendData() publishes it without reading any PV. The event task
+     * writes the back copy, bldSendData() sends the front one, and
+     * _publishShadow() swaps them when the back copy has news.
+     */
+    struct BldPvMonitor
+    {
+        BldPvClientBasic*   pClient;
+        unsigned int        uPvIndex;
+        dbChannel*          pChannel;
+        dbEventSubscription subscription;
+    };
+    bool            _bMonitorMode;
+    dbEventCtx      _monitorCtx;
+    std::vector<BldPvMonitor> _vMonitors;   /// one per _vPvPlan entry, not resized while subscribed
+    epicsMutexId    _shadowLock;
+    long*           _plShadow[2];           /// BldPacketHeader + payload each
+    unsigned int    _uShadowSize;
+    unsigned int    _uShadowFront;          /// the complete copy bldSendData() sends
+    bool            _bShadowDirty;          /// back copy has updates not yet published
+    bool            _bShadowStale;          /// back copy lacks updates published since it was written
+    unsigned long   _uMonitorUpdates;
+    long*           _llMonitorBuf;          /// event task scratch, _uPvBufferSize bytes
+
+    int _startMonitors();
+    void _stopMonitors();
+    BldPacketHeader* _publishShadow();
+    static void _monitorCallback( void* pArg, struct dbChannel* pChannel, int iEventsRemaining,
+      struct db_field_log* pfl );
+
+    /// Send through the async ring if enabled, otherwise directly
+    int _sendRaw( int iSizeData, const char* pData )
+    {
+        if ( _apBldAsyncSender.get() != NULL )
+        {
+            epicsMutexMustLock( _asyncProducerLock );
+            int iFail = _apBldAsyncSender->send( iSizeData, pData );
+            epicsMutexUnlock( _asyncProducerLock );
+            return iFail;
+        }
+        return _apBldNetworkClient->sendRawData( iSizeData, pData );
+    }
+    int _sendRawV( const struct iovec* pIov, int iIovCount )
+    {
+        if ( _apBldAsyncSender.get() != NULL )
+        {
+            epicsMutexMustLock( _asyncProducerLock );
+            int iFail = _apBldAsyncSender->sendV( pIov, iIovCount );
+            epicsMutexUnlock( _asyncProducerLock );
+            return iFail;
+        }
+        return _apBldNetworkClient->sendRawDataV( pIov, iIovCount );
+    }
+
+    /// Several gathered packets, iIovPerPacket buffers each, in one network client call
+    int _sendRawVBatch( const struct iovec* pIov, int iIovPerPacket, int iPacketCount )
+    {
+        if ( _apBldAsyncSender.get() != NULL )
+        {
+            // Keep the packets together in the ring
+            int iFail = 0;
+            epicsMutexMustLock( _asyncProducerLock );
+            for ( int iPacket = 0; iPacket < iPacketCount; iPacket++ )
+            {
+                if ( _apBldAsyncSender->sendV( pIov + iPacket * iIovPerPacket, iIovPerPacket ) != 0 )
+                    iFail = 1;
+            }
+            epicsMutexUnlock( _asyncProducerLock );
+            return iFail;
+        }
+        return _apBldNetworkClient->sendRawDataVBatch( pIov, iIovPerPacket, iPacketCount );
+    }
+
+    /// BldAsyncSender takes one producer at a time, bldSendPacket() may have several
+    epicsMutexId    _asyncProducerLock;
+
+    unsigned int _exchangeFiducial( unsigned int uFiducialId );
+    unsigned int _packetFiducial( const epicsTimeStamp* pTsFiducial );
+
+    /*
+     * 64-bit pulse-ID tracking, guarded by _pulseIdLock
+     *
+     * There is no 64-bit compare-and-swap on every EPICS target, so the last
+     * pulse ID lives behind a mutex held for a compare and a few adds.
+     */
+    epicsMutexId        _pulseIdLock;
+    unsigned long long  _ullPulseIdPrev;    /// highest pulse ID sent, PULSE_ID_NOT_SET before the first
+    unsigned long       _uPulseIdsSent, _uPulseIdDuplicates, _uPulseIdGaps, _uPulseIdOutOfOrder;
+    unsigned long long  _ullPulseIdsMissed;
+
+    unsigned int _packetPulseId( unsigned long long ullPulseId );
+
+    enum { uSendPacketsChunk = 32 };        /// headers bldSendPackets() builds on the stack per send
+
+    /// Container mode of bldSendPackets(), set while stopped
+    bool            _bContainerMode;
+    unsigned int    _uContainerPhysicalId;
+
+    void _sendContainers( uint32_t uSecs, uint32_t uNSecs, unsigned int uFiducialId,
+      const BldPacketDesc* pPackets, unsigned int uPacketCount, unsigned int& uDatagrams, size_t& uSentSize );
+
+    /*
+     * Multi-pulse batching (bldSetPulseBatch()), pending pulses guarded by _pulseLock
+     *
+     * bldSendData() copies each pulse's payload behind the pending ones and
+     * its fiducial and time offset into the index; the datagram is gathered
+     * from header, index and payloads when it is flushed. Index offsets are
+     * 32-bit nanoseconds, so a batch also ends before it spans +-2.1 s.
+     */
+    enum { uPulseBatchLimit = 1024 };       /// upper bound for bldSetPulseBatch(uMaxPulses)
+    enum { uUdpIpHeaderSize = 28 };         /// taken off iMTU for the datagram size limit
+    enum EPulseFlush { PULSE_FLUSH_COUNT, PULSE_FLUSH_SIZE, PULSE_FLUSH_SPAN, PULSE_FLUSH_DEADLINE,
+      PULSE_FLUSH_EXPLICIT, PULSE_FLUSH_REASONS };
+    unsigned int        _uPulseBatchMax;    /// pulses per datagram, 0 or 1 disables
+    unsigned int        _uPulseDeadlineUs;
+    epicsMutexId        _pulseLock;
+    epicsTimerQueueId   _pulseTimerQueue;
+    epicsTimerId        _pulseTimer;
+    unsigned int        _uPulseMaxSize;     /// datagram size limit, header included
+    char*               _pPulsePayloads;    /// _uPulseMaxSize bytes
+    BldPulseIndexEntry* _pPulseIndex;       /// _uPulseBatchMax entries, little-endian
+    unsigned long long* _pullPulseAddNs;    /// when each pending pulse was added
+    unsigned int        _uPulseCount;
+    unsigned int        _uPulseSize;        /// payload size of every pending pulse
+    uint32_t            _uPulseSecs, _uPulseNSecs, _uPulseFiducialId;  /// first pending pulse
+    unsigned long long  _ullPulseFirstId;   /// and its pulse ID, entries keep the low 32 bits of theirs
+    uint32_t            _uPulseDamage;      /// damage of the pending pulses, or-ed, little-endian
+    unsigned long       _uPulseDatagrams, _uPulsesSent;
+    unsigned long       _luPulseFlushes[PULSE_FLUSH_REASONS];
+    unsigned long long  _ullPulseLatencySumNs, _ullPulseLatencyMaxNs;
+
+    void _startPulseBatch();
+    void _stopPulseBatch();
+    int _addPulse( const BldPacketHeader* pBldPacketHeader, uint32_t uSecs, uint32_t uNSecs, unsigned int uFiducialId,
+      unsigned long long ullPulseId );
+    int _flushPulsesLocked( EPulseFlush eReason );
+    unsigned int _pulseDatagramSize( unsigned int uPulseCount, unsigned int uPulseSize ) const
+    {
+        return BldContainerPacket::prefixSize()
+          + BldXtcHeader::extentSize( sizeof(BldPulseIndex) + uPulseCount * (sizeof(BldPulseIndexEntry) + uPulseSize) );
+    }
+    static void _pulseDeadlineCallback( void* pArg );
+
+    /*
+     * Packet leases (bldAcquirePacket()/bldCommitPacket()), guarded by _leaseLock
+     *
+     * A lease is a zero-copy transmit buffer of the network client when it
+     * hands those out, otherwise a slot of _pLeasePool. The pool is allocated
+     * with the first lease and only resized while no slot is leased.
+     */
+    enum { uLeaseSlots = 32 };
+    epicsMutexId    _leaseLock;
+    char*           _pLeasePool;            /// uLeaseSlots slots of _uLeaseSlotSize bytes, cache line aligned
+    unsigned int    _uLeaseSlotSize;
+    unsigned int    _luLeaseFree[uLeaseSlots];
+    unsigned int    _uLeaseFreeCount;
+    unsigned long   _uLeasesCommitted, _uLeasesReleased, _uLeasesDenied;
+
+    char* _leasePoolSlot( unsigned int uSize );
+    bool _isPoolLease( const char* pBuffer ) const
+    {
+        return _pLeasePool != NULL && pBuffer >= _pLeasePool && pBuffer < _pLeasePool + uLeaseSlots * _uLeaseSlotSize;
+    }
+    void _returnLease( char* pBuffer );
+
+    /// Account one bldSendData()/bldSendPacket() call in _sendStats
+    void _recordSend( unsigned long long ullStartNs, int iRetErrorCode, size_t uSize )
+    {
+        _sendStats.recordLatency( ullStartNs );
+        if ( iRetErrorCode == 0 )
+            _sendStats.recordSend( 1, uSize );
+        else
+            _sendStats.recordFailure( 0 );
+    }
 
     static int _splitPvList( const string& sBldPvList, std::vector<string>& vsBldPv );
+    static int _splitPvArray( const string& sBldPv, string& sPvName, unsigned int* puArrayCount );
+    static int _layoutPvEntry( const string& sBldPv, unsigned int uSrcPhysicalId, unsigned int uPvBufferSize,
+      unsigned int* puSlot, string& sPvName, unsigned int* puArrayCount );
     
     /* PV access and report */    
     static int readPv(const char *sVariableName, int iBufferSize, void* pBuffer, 
       short* piValueType, long* plNumElements, epicsTimeStamp *ts );
+    static int planPv(const char *sVariableName, int iBufferSize, BldPvPlanEntry* pEntry );
+    static int readPv( BldPvPlanEntry& entry, void* pBuffer, epicsTimeStamp *ts, long* plNumElements = NULL );
     static int writePv(const char * sVariableName, const char * pBuffer ); 
     static int printPv(const char *sVariableName, void* pBuffer, 
       short iValueType = DBR_STRING, long lNumElements = 1 );
@@ -259,28 +743,134 @@ BldPvClientInterface& BldPvClientFactory::getSingletonBldPvClient(int bldClientI
 
 const char BldPvClientBasic::sPvListSeparators[] = " ,;\r\n";
 
+EpicsAtomicPtrT     BldPvClientBasic::_lpClientChunks[BldPvClientBasic::uClientChunks];
+epicsMutexId        BldPvClientBasic::_registryLock = NULL;
+epicsThreadOnceId   BldPvClientBasic::_registryOnce = EPICS_THREAD_ONCE_INIT;
+
 /* static member functions */
  
 BldPvClientBasic& BldPvClientBasic::getSingletonObject(int bldClientId)
 {
-    static BldPvClientBasic bldDataClient[10]; // Ick!
-	assert( bldClientId < 10 && "Make sure your first arg to Bld* shell commands is 0 or bldClientId" );
-    return bldDataClient[bldClientId];
+	assert( bldClientId >= 0 && bldClientId < BLD_MAX_CLIENTS &&
+	  "Make sure your first arg to Bld* shell commands is 0 or bldClientId" );
+
+    EpicsAtomicPtrT* ppChunk = (EpicsAtomicPtrT*) epicsAtomicGetPtrT( &_lpClientChunks[bldClientId / uClientChunkSize] );
+    if ( ppChunk != NULL )
+    {
+        BldPvClientBasic* pClient = (BldPvClientBasic*) epicsAtomicGetPtrT( &ppChunk[bldClientId % uClientChunkSize] );
+        if ( pClient != NULL )
+            return *pClient;
+    }
+    return _createClient( bldClientId );
+}
+
+void BldPvClientBasic::_registryInit(void* pArg)
+{
+    _registryLock = epicsMutexMustCreate();
+}
+
+BldPvClientBasic& BldPvClientBasic::_createClient(int bldClientId)
+{
+    epicsThreadOnce( &_registryOnce, _registryInit, NULL );
+
+    epicsMutexMustLock( _registryLock );
+    EpicsAtomicPtrT* ppChunk = (EpicsAtomicPtrT*) _lpClientChunks[bldClientId / uClientChunkSize];
+    if ( ppChunk == NULL )
+    {
+        ppChunk = new EpicsAtomicPtrT[uClientChunkSize];
+        for ( int iSlot = 0; iSlot < uClientChunkSize; iSlot++ )
+            ppChunk[iSlot] = NULL;
+        epicsAtomicSetPtrT( &_lpClientChunks[bldClientId / uClientChunkSize], ppChunk );
+    }
+
+    BldPvClientBasic* pClient = (BldPvClientBasic*) ppChunk[bldClientId % uClientChunkSize];
+    if ( pClient == NULL )
+    {
+        pClient = new BldPvClientBasic();
+        epicsAtomicSetPtrT( &ppChunk[bldClientId % uClientChunkSize], pClient );
+    }
+    epicsMutexUnlock( _registryLock );
+    return *pClient;
+}
+
+void* BldPvClientBasic::operator new(size_t uSize)
+{
+    void* p = _mallocAligned( (uSize + uCacheLine - 1) & ~(size_t) (uCacheLine - 1) );
+    if ( p == NULL )
+        throw std::bad_alloc();
+    return p;
+}
+
+void BldPvClientBasic::operator delete(void* p)
+{
+    _freeAligned( p );
+}
+
+/**
+ * malloc() a block starting on a cache line, the raw pointer is kept just before it
+ */
+void* BldPvClientBasic::_mallocAligned(size_t uSize)
+{
+    char* pRaw = (char*) malloc( uSize + uCacheLine + sizeof(void*) );
+    if ( pRaw == NULL )
+        return NULL;
+    char* pAligned = (char*) ( ((size_t) pRaw + sizeof(void*) + uCacheLine - 1) & ~(size_t) (uCacheLine - 1) );
+    ((void**) pAligned)[-1] = pRaw;
+    return pAligned;
+}
+
+void BldPvClientBasic::_freeAligned(void* p)
+{
+    if ( p != NULL )
+        free( ((void**) p)[-1] );
 }
 
 /* public member functions */
 
-BldPvClientBasic::BldPvClientBasic() : _bBldStarted(false), _iDebugLevel(0),
+BldPvClientBasic::BldPvClientBasic() : _bBldStarted(false), _networkLock(epicsMutexMustCreate()), _iDebugLevel(0),
   _uBldServerAddr(0), _uBldServerPort(0), _uMaxDataSize(0), _uSrcPhysicalId(0), _uxtcDataType(0),
-  _uFiducialIdPrev(FIDUCIAL_NOT_SET), _uFiducialIdCur(FIDUCIAL_NOT_SET)
+  _iFiducialIdPrev(FIDUCIAL_NOT_SET), _uFiducialIdCur(FIDUCIAL_NOT_SET),
+  _bPulseIdMode(false), _ullPulseIdCur(PULSE_ID_NOT_SET),
+  _uBatchMax(0), _uBatchDeadlineUs(0), _uAsyncRingDepth(0), _iAsyncOverflow(BLD_ASYNC_DROP_NEWEST),
+  _iBpPolicy(BLD_BACKPRESSURE_BLOCK), _uBpSndBufPackets(0), _uBpPolicyArg(0),
+  _uNetworkFlags(0), _sTransport("udp"), llBufPvVal(NULL), lcMsgBuffer(NULL),
+  _uPvBufferSize(0), _uMsgBufferSize(0), _bFiducialPlanned(false), _uPackPvCount(0),
+  _pTypeFields(NULL),
+  _uLockPackets(0), _uLockAcquisitions(0), _uLockFallbacks(0), _uPlanPvCount(0), _uPlanLockGroupCount(0),
+  _bMonitorMode(false), _monitorCtx(NULL), _shadowLock(epicsMutexMustCreate()),
+  _uShadowSize(0), _uShadowFront(0), _bShadowDirty(false), _bShadowStale(false), _uMonitorUpdates(0),
+  _llMonitorBuf(NULL), _asyncProducerLock(epicsMutexMustCreate()),
+  _pulseIdLock(epicsMutexMustCreate()), _ullPulseIdPrev(PULSE_ID_NOT_SET), _uPulseIdsSent(0),
+  _uPulseIdDuplicates(0), _uPulseIdGaps(0), _uPulseIdOutOfOrder(0), _ullPulseIdsMissed(0),
+  _bContainerMode(false), _uContainerPhysicalId(0),
+  _uPulseBatchMax(0), _uPulseDeadlineUs(0), _pulseLock(epicsMutexMustCreate()), _pulseTimerQueue(NULL),
+  _pulseTimer(NULL), _uPulseMaxSize(0), _pPulsePayloads(NULL), _pPulseIndex(NULL), _pullPulseAddNs(NULL),
+  _uPulseCount(0), _uPulseSize(0), _uPulseSecs(0), _uPulseNSecs(0), _uPulseFiducialId(0),
+  _ullPulseFirstId(PULSE_ID_NOT_SET), _uPulseDamage(0),
+  _uPulseDatagrams(0), _uPulsesSent(0), _ullPulseLatencySumNs(0), _ullPulseLatencyMaxNs(0),
+  _leaseLock(epicsMutexMustCreate()), _pLeasePool(NULL), _uLeaseSlotSize(0), _uLeaseFreeCount(0),
+  _uLeasesCommitted(0), _uLeasesReleased(0), _uLeasesDenied(0)
 
 {
+    // Clients are heap allocated, members left out above start out undefined
+    _uFiducialTime.secPastEpoch = 0;
+    _uFiducialTime.nsec         = 0;
+    _plShadow[0] = _plShadow[1] = NULL;
+    memset( _luPulseFlushes, 0, sizeof(_luPulseFlushes) );
 }
 
 BldPvClientBasic::~BldPvClientBasic()
 {
     if ( _bBldStarted )
         bldStop();
+    epicsMutexDestroy( _shadowLock );
+    epicsMutexDestroy( _asyncProducerLock );
+    epicsMutexDestroy( _leaseLock );
+    epicsMutexDestroy( _pulseLock );
+    epicsMutexDestroy( _pulseIdLock );
+    epicsMutexDestroy( _networkLock );
+    _freeAligned( _pLeasePool );
+    _freeBuffers();
 }
 
 void BldPvClientBasic::setDebugLevel(int iDebugLevel)
@@ -306,15 +896,37 @@ int BldPvClientBasic::bldStart()
 	try
 	{
 		const unsigned char ucTTL = 32; /// minimum: 1 + (# of routers in the middle)
-				
-		_apBldNetworkClient.reset(
-		  EpicsBld::BldNetworkClientFactory::createBldNetworkClient( _uBldServerAddr, _uBldServerPort, 
-		  _uMaxDataSize + sizeof(BldPacketHeader), ucTTL, _sBldInterfaceIp.c_str() ) );
+
+		_allocBuffers();
+		if ( _buildReadPlan() != 0 )
+			throw string("Failed to resolve the BLD PVs\n");
+		// Size and type checks run here once, a bad configuration is
+		// reported now and every packet goes out damaged as before
+		new ( &_headerTemplate ) BldPacketHeader( _uMaxDataSize + sizeof(BldPacketHeader), 0, 0, 0, 0,
+		  _uSrcPhysicalId, _uxtcDataType );
+		if ( _bMonitorMode && _startMonitors() != 0 )
+			throw string("Failed to subscribe to the BLD PVs\n");
+		_startPulseBatch();
+
+		// Multi-pulse datagrams may be larger than one packet
+		const unsigned int uMaxPacketSize = std::max( (unsigned int) (_uMaxDataSize + sizeof(BldPacketHeader)),
+													  _uPulseMaxSize );
+		_resetNetworkClient(
+		  EpicsBld::BldNetworkClientFactory::createBldTransport( _sTransport.c_str(), _uBldServerAddr,
+		  _uBldServerPort, uMaxPacketSize, ucTTL, _sBldInterfaceIp.c_str(),
+		  _uNetworkFlags ) );
 
 		if ( _apBldNetworkClient.get() == NULL )
 			throw string("BldNetworkClient Init fail\n");
 
 		_apBldNetworkClient->setDebugLevel( _iDebugLevel );
+		if ( _uBatchMax > 1 )
+			_apBldNetworkClient->setBatchMode( _uBatchMax, _uBatchDeadlineUs );
+		if ( _iBpPolicy != BLD_BACKPRESSURE_BLOCK || _uBpSndBufPackets != 0 )
+			_apBldNetworkClient->setBackpressure( _iBpPolicy, _uBpSndBufPackets, _uBpPolicyArg );
+		if ( _uAsyncRingDepth > 0 )
+			_apBldAsyncSender.reset( new BldAsyncSender( _apBldNetworkClient.get(), _uAsyncRingDepth,
+			  uMaxPacketSize, (BldAsyncSender::EOverflowPolicy) _iAsyncOverflow ) );
 		
 		/*
 		 * setup forward link:  _sBldPvPreTrigger -> _sBldPvPreSubRec -> _sBldPvPreTriggerPrevFLNK
@@ -330,7 +942,7 @@ int BldPvClientBasic::bldStart()
 			string tsBldPvPreTriggerFLNK = 
 				(_sBldPvPreTrigger.find('.') == string::npos) ? _sBldPvPreTrigger + ".FLNK"
 															  : _sBldPvPreTrigger;
-			if ( readPv( tsBldPvPreTriggerFLNK.c_str(), sizeof(llBufPvVal), llBufPvVal,
+			if ( readPv( tsBldPvPreTriggerFLNK.c_str(), _uPvBufferSize, llBufPvVal,
 						&iFieldType, &lNumElements, NULL ) != 0 )
 				throw string("readPv(") + tsBldPvPreTriggerFLNK + ") Failed\n";
 			char* lcBufPvVal = (char*) llBufPvVal;
@@ -376,7 +988,7 @@ int BldPvClientBasic::bldStart()
 
 			// Read PV: (_sBldPvPostTrigger).FLNK
 			string tsPvPostTriggerFLNK = _sBldPvPostTrigger + ".FLNK";
-			if ( readPv( tsPvPostTriggerFLNK.c_str(), sizeof(llBufPvVal), llBufPvVal, &iFieldType, &lNumElements, NULL ) != 0 )
+			if ( readPv( tsPvPostTriggerFLNK.c_str(), _uPvBufferSize, llBufPvVal, &iFieldType, &lNumElements, NULL ) != 0 )
 				throw string("readPv(") + tsPvPostTriggerFLNK + ") Failed\n";
 			char* lcBufPvVal = (char*) llBufPvVal;
 			_sBldPvPostTriggerPrevFLNK.assign(lcBufPvVal);
@@ -412,11 +1024,17 @@ int BldPvClientBasic::bldStart()
 	}   
 	catch (string& sError)
 	{
+		_stopPulseBatch();
+		_stopMonitors();
+		_apBldAsyncSender.reset();
+		_resetNetworkClient( NULL );
 		printf( "[FAILED]\n" );    
 		printf( "BldPvClientBasic::bldStart() : %s\n", sError.c_str() );     
 		return 2;
 	}
 
+    epicsAtomicSetSizeT( &_uPlanPvCount, _vPvPlan.size() );
+    epicsAtomicSetSizeT( &_uPlanLockGroupCount, _vLockGroups.size() );
     printf( "[OK]\n" );    
     _bBldStarted = true;
     return 0;
@@ -497,7 +1115,22 @@ int BldPvClientBasic::bldStop()
 
 		_sBldPvPostTriggerPrevFLNK.clear();
 		
-		_apBldNetworkClient.release();
+		// Send the pending pulses, then drain the send ring and stop
+		// the sender thread before we let go of the network client it sends to.
+		// The client sends what its batch still holds and closes its socket.
+		_stopPulseBatch();
+		_apBldAsyncSender.reset();
+		if ( _apBldNetworkClient.get() != NULL )
+			_apBldNetworkClient->flush();
+		_resetNetworkClient( NULL );
+
+		_stopMonitors();
+		epicsAtomicSetSizeT( &_uPlanPvCount, 0 );
+		epicsAtomicSetSizeT( &_uPlanLockGroupCount, 0 );
+		_vPvPlan.clear();
+		_vLockGroups.clear();
+		_vuLockOrder.clear();
+		_bFiducialPlanned = false;
 	}   
 	catch (string& sError)
 	{
@@ -540,22 +1173,35 @@ int BldPvClientBasic::bldPrepareData()
     
 	try
 	{       
-		short int iFieldType = 0;
-		long lNumElements = 0;
-		
 		unsigned int uFiducialId = 0x1FFFF;
-		if ( _sBldPvFiducial.length() > 0 )
+		_ullPulseIdCur = PULSE_ID_NOT_SET;
+		if ( _bFiducialPlanned )
 		{
 			if ( 
-				readPv( _sBldPvFiducial.c_str(), sizeof(llBufPvVal), llBufPvVal, &iFieldType, &lNumElements, &_uFiducialTime )
+				readPv( _fiducialPlan, llBufPvVal, &_uFiducialTime )
 				!= 0 )
 				throw string("readPv(") + _sBldPvFiducial + ") Failed to read Fiducial PV!\n";
 						
-			uFiducialId  = *(unsigned long int*) llBufPvVal;
+			if ( _bPulseIdMode )
+			{
+				// Read as DBR_DOUBLE, see _buildReadPlan()
+				const double dPulseId = *(double*) llBufPvVal;
+				if ( !( dPulseId >= 1.0 && dPulseId < 18446744073709551616.0 ) )
+					throw string( "Invalid pulse ID read from " + _sBldPvFiducial + "\n" );
+				_ullPulseIdCur = (unsigned long long) dPulseId;
+				uFiducialId = (unsigned int) ( _ullPulseIdCur & FIDUCIAL_MASK );
+			}
+			else
+				uFiducialId  = *(unsigned long int*) llBufPvVal;
 		}
 	 
 		_uFiducialIdCur = uFiducialId;
-		if ( _uFiducialIdCur >= FIDUCIAL_INVALID )
+		if ( _bPulseIdMode )
+		{
+			if ( _ullPulseIdCur == PULSE_ID_NOT_SET )
+				throw string( "Pulse-ID mode needs a fiducial PV holding the pulse ID\n" );
+		}
+		else if ( _uFiducialIdCur >= FIDUCIAL_INVALID )
 			throw string( "Invalid fiducial read from " + _sBldPvFiducial + "\n" );
 	}
 	catch (string& sError)
@@ -567,7 +1213,7 @@ int BldPvClientBasic::bldPrepareData()
 	}
         
     if ( _iDebugLevel >= 3 )
-        printf( "Preparing Data: Get Fiducial Id 0x%05X\n", _uFiducialIdCur ); 
+        printf( "Preparing Data: Get Fiducial Id 0x%05X Pulse Id %llu\n", _uFiducialIdCur, _ullPulseIdCur ); 
         
     return iRetErrorCode;
     
@@ -579,20 +1225,16 @@ int BldPvClientBasic::bldSendData()
         return 1; // return status, without error report
 
     int iRetErrorCode = 0;
+    char* pTxBuffer = NULL; // zero-copy buffer leased from the network client
+    size_t uSentSize = 0;
+    bool bPulseBatched = false; // the datagram goes out, and is counted, when the batch is flushed
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
     
 	try
 	{
 		if ( _apBldNetworkClient.get() == NULL )
 			throw string( "BldNetworkClient is uninitialized\n" );
 
-		short int iFieldType = 0;
-		long lNumElements = 0;
-
-		std::vector<string> vsBldPv;
-		_splitPvList( _sBldPvList, vsBldPv );
-		
-		BldPacketHeader* pBldPacketHeader = (BldPacketHeader*) lcMsgBuffer;
-
 		/* Set bld packet header */    
 		struct timespec ts;
 #if 0
@@ -608,7 +1250,19 @@ int BldPvClientBasic::bldSendData()
 		// see if it's been set by the bldPreTrigger.
 		unsigned int uFiducialId = _uFiducialIdCur;
 		_uFiducialIdCur = FIDUCIAL_NOT_SET;
-		if ( uFiducialId >= FIDUCIAL_INVALID )
+		const unsigned long long ullPulseId = _ullPulseIdCur;
+		_ullPulseIdCur = PULSE_ID_NOT_SET;
+		if ( _bPulseIdMode && ullPulseId == PULSE_ID_NOT_SET )
+		{
+			static unsigned long	msgCount	= 0;
+
+			if ( !(msgCount++ % 10000) || ( _iDebugLevel >= 2 ) )
+				throw string( "Pulse ID not set.  Did your bldPreTrigger PV process?\n" );
+			return 2;
+		}
+		if ( _bPulseIdMode )
+			uFiducialId = _packetPulseId( ullPulseId );
+		else if ( uFiducialId >= FIDUCIAL_INVALID )
 		{
 			static unsigned long	msgCount	= 0;
 
@@ -621,10 +1275,13 @@ int BldPvClientBasic::bldSendData()
 			}
 			return 2;
 		}
+        // In pulse-ID mode _packetPulseId() has caught duplicates already,
+        // the 17-bit fiducial wraps every few seconds at high rates
+        const unsigned int uFiducialIdPrev = _bPulseIdMode ? FIDUCIAL_NOT_SET : _exchangeFiducial( uFiducialId );
         if ( _iDebugLevel < 0 )
-			printf( "bldSendData: Cur Fiducial Id 0x%05X, Prev Fiducial Id 0x%05X\n", uFiducialId, _uFiducialIdPrev ); 
+			printf( "bldSendData: Cur Fiducial Id 0x%05X, Prev Fiducial Id 0x%05X\n", uFiducialId, uFiducialIdPrev ); 
 
-        if (_uFiducialIdPrev == uFiducialId) {
+        if (uFiducialIdPrev == uFiducialId) {
                         time_t t;
                         struct tm *tmp;
                         t = time(NULL);
@@ -636,44 +1293,61 @@ int BldPvClientBasic::bldSendData()
 			throw string("Duplicate Fiducial in BLD!\n");
 			return 2;
         }
-        _uFiducialIdPrev = uFiducialId;
 	 
-		// Create a BldPacketHeader
-		const unsigned int uDamage = 0;
-		new ( pBldPacketHeader ) BldPacketHeader( sizeof(lcMsgBuffer), 
-		  ts.tv_sec, ts.tv_nsec, uFiducialId, uDamage, _uSrcPhysicalId, _uxtcDataType);
+		// In zero-copy mode build the packet directly in a pinned transmit
+		// buffer, unless the async ring is going to copy it anyway
+		char* pMsgBuffer = lcMsgBuffer;
+		if ( _apBldAsyncSender.get() == NULL && (_uNetworkFlags & BLD_NETWORK_ZEROCOPY) && !_bMonitorMode
+		  && _uPulseBatchMax <= 1 )
+		{
+			const unsigned int uTxSize = _uMaxDataSize + sizeof(BldPacketHeader);
+			pTxBuffer = _apBldNetworkClient->acquireTxBuffer( uTxSize );
+			if ( pTxBuffer != NULL )
+				pMsgBuffer = pTxBuffer;
+		}
+		BldPacketHeader* pBldPacketHeader = (BldPacketHeader*) pMsgBuffer;
+
+		// In monitor mode the payload is packed already, send the latest complete copy
+		if ( _bMonitorMode )
+		{
+			pBldPacketHeader = _publishShadow();
+		}
+
+		// Copy the header bldStart() validated, only the time stamp,
+		// fiducial and pulse ID change from shot to shot
+		memcpy( pBldPacketHeader, &_headerTemplate, sizeof(BldPacketHeader) );
+		pBldPacketHeader->setTimeStamp( ts.tv_sec, ts.tv_nsec, uFiducialId );
+		pBldPacketHeader->setPulseId( ullPulseId );
 		//char* pcMsgBuffer = (char*) (pBldPacketHeader + 1);
 		//unsigned int uDataSize = sizeof(BldPacketHeader);
 		//const int iMaxMsgSize = sizeof(lcMsgBuffer);
 
 		/* Set bld pv values */        
-		int iPvIndex = 0;
-		for ( std::vector<string>::const_iterator itsBldPv = vsBldPv.begin();
-		  itsBldPv != vsBldPv.end(); itsBldPv++, iPvIndex++ )
-		{
-			const string& sBldPv = *itsBldPv;
-			if ( _iDebugLevel >= 3 )
-				printf( "Reading PV %s...\n", sBldPv.c_str());
-			if ( 
-			  readPv( sBldPv.c_str(), sizeof(llBufPvVal), llBufPvVal, &iFieldType, &lNumElements, NULL )
-			  != 0 )
-				throw string("readPv(") + sBldPv + ") Failed\n";
-			
-			//if ( _iDebugLevel >= 3)
-			//    printf( "Msg Buffer before PV %s Available Size %d: %s\n", sBldPv.c_str(), iMaxMsgSize - uDataSize, lcMsgBuffer);
-			
-			int iFail = pBldPacketHeader->setPvValue( iPvIndex, llBufPvVal );
-			if ( iFail != 0 )
-				throw string("pBldPacketHeader->setPvValue() for PV ") + sBldPv + ") Failed\n";
-		}
+		if ( !_bMonitorMode )
+			_readLockGroups( pBldPacketHeader );
 
 		//if ( uDataSize > _uMaxDataSize )
 		//    throw string("Data Size is larger than max value\n");
 					
 		/* Send out bld */    
-		int iFailSend = _apBldNetworkClient->sendRawData( pBldPacketHeader->getPacketSize(), lcMsgBuffer);
+		int iFailSend;
+		if ( _uPulseBatchMax > 1 )
+		{
+			iFailSend = _addPulse( pBldPacketHeader, ts.tv_sec, ts.tv_nsec, uFiducialId, ullPulseId );
+			bPulseBatched = true;
+		}
+		else if ( pTxBuffer != NULL )
+		{
+			// The buffer belongs to the network client again, sent or not
+			char* pSendBuffer = pTxBuffer;
+			pTxBuffer = NULL;
+			iFailSend = _apBldNetworkClient->sendTxBuffer( pSendBuffer, pBldPacketHeader->getPacketSize() );
+		}
+		else
+			iFailSend = _sendRaw( pBldPacketHeader->getPacketSize(), (const char*) pBldPacketHeader );
 		if ( iFailSend != 0 )
 			throw string( "_apBldNetworkClient->sendRawData() Failed\n", _sBldPvList.c_str() );
+		uSentSize = pBldPacketHeader->getPacketSize();
 
 		if ( _iDebugLevel >= 2 )
 		{
@@ -689,6 +1363,13 @@ int BldPvClientBasic::bldSendData()
 		  
 		iRetErrorCode = 2;
 	}
+	if ( pTxBuffer != NULL )
+		_apBldNetworkClient->releaseTxBuffer( pTxBuffer );
+
+	if ( bPulseBatched )
+		_sendStats.recordLatency( ullStartNs );
+	else
+		_recordSend( ullStartNs, iRetErrorCode, uSentSize );
         
     return iRetErrorCode;
 }
@@ -701,54 +1382,56 @@ int BldPvClientBasic::bldSendPacket(
 	epicsTimeStamp	*	pTsFiducial,
 	void			*	pPacket,
 	size_t				sPacket	)
+{
+    return bldSendPacketPulseId( srcPhysicalId, xtcDataType, pTsFiducial, PULSE_ID_NOT_SET, pPacket, sPacket );
+}
+
+// bldSendPacket() with a 64-bit pulse ID, the fiducial is its low 17 bits.
+// PULSE_ID_NOT_SET takes the fiducial from the time stamp instead.
+int BldPvClientBasic::bldSendPacketPulseId(
+	unsigned int		srcPhysicalId,
+	unsigned int		xtcDataType,
+	epicsTimeStamp	*	pTsFiducial,
+	unsigned long long	ullPulseId,
+	void			*	pPacket,
+	size_t				sPacket	)
 {
     if ( !_bBldStarted )
         return 1; // return status, without error report
 
     int iRetErrorCode = 0;
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
 
 	try
 	{
 		if ( _apBldNetworkClient.get() == NULL )
 			throw string( "BldNetworkClient is uninitialized\n" );
 
-		/* Set bld packet header */
-		struct timespec		ts;
-		unsigned int		uFiducialId;
-		/* New regime - Use the fiducial timestamp! */
-		ts.tv_sec	= pTsFiducial->secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH;
-		ts.tv_nsec	= pTsFiducial->nsec;
-		uFiducialId	= pTsFiducial->nsec & FIDUCIAL_MASK;
-		if ( uFiducialId >= FIDUCIAL_INVALID )
-			throw string( "Invalid Fiducial 0x1FFFF\n" );
-		if (_uFiducialIdPrev == uFiducialId)
-			throw string("Duplicate Fiducial in bldPacket!\n");
-        _uFiducialIdPrev = uFiducialId;
-
 		if ( sPacket > _uMaxDataSize )
 		    throw string("Packet Size is larger than max value\n");
 
-		// Create a BldPacketHeader in our network msg buffer
-		BldPacketHeader		*	pBldPacketHeader = (BldPacketHeader*) lcMsgBuffer;
-		new ( pBldPacketHeader ) BldPacketHeader( );
-		pBldPacketHeader->Setup(	sPacket, ts.tv_sec, ts.tv_nsec,
-									uFiducialId, srcPhysicalId, xtcDataType	);
-
-		// Get ptr and size for data buffer
-		// The lcMsgBuffer starts w/ a BldPacketHeader object,
-		// which is then followed by the data buffer which must
-		// fit into the one jumbo MTU sized buffer.
-		void		*	pHeaderData	= (void *)(pBldPacketHeader + 1);
-		size_t			sMsgBufferLeft	= sizeof(lcMsgBuffer) - sizeof(BldPacketHeader);
-		if ( sPacket > sMsgBufferLeft )
-		    throw string( "bldSendPacket: Error, Packet too large for buffer!\n");
-
-		// Load the packet into the header
-		memcpy( pHeaderData, pPacket, sPacket );
-		assert( ((char *)pHeaderData - lcMsgBuffer) == sizeof(BldPacketHeader) );
+		/* Set bld packet header */
+		const unsigned int	uFiducialId	= ( ullPulseId == PULSE_ID_NOT_SET ?
+		  _packetFiducial( pTsFiducial ) : _packetPulseId( ullPulseId ) );
+
+		// Build the BldPacketHeader on the stack and hand header and
+		// payload to the network client as separate buffers, so the
+		// driver's payload is never copied in user space. Nothing here
+		// is shared with other producers, the network client and the
+		// async ring serialize the send itself.
+		BldPacketHeader		bldPacketHeader;
+		bldPacketHeader.Setup(	sPacket, pTsFiducial->secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH, pTsFiducial->nsec,
+								uFiducialId, srcPhysicalId, xtcDataType	);
+		bldPacketHeader.setPulseId( ullPulseId );
+
+		struct iovec	iov[2];
+		iov[0].iov_base	= (caddr_t)( &bldPacketHeader );
+		iov[0].iov_len	= sizeof(BldPacketHeader);
+		iov[1].iov_base	= (caddr_t)( pPacket );
+		iov[1].iov_len	= sPacket;
 
 		/* Send out bld */
-		int iFailSend = _apBldNetworkClient->sendRawData( sizeof(BldPacketHeader) + sPacket, lcMsgBuffer);
+		int iFailSend = _sendRawV( iov, 2 );
 		if ( iFailSend != 0 )
 			throw string( "bldSendPacket: _apBldNetworkClient->sendRawData() Failed\n" );
 
@@ -765,159 +1448,1637 @@ int BldPvClientBasic::bldSendPacket(
 		iRetErrorCode = 2;
 	}
 
+	_recordSend( ullStartNs, iRetErrorCode, sizeof(BldPacketHeader) + sPacket );
+
     return iRetErrorCode;
 }
 
-bool BldPvClientBasic::IsStarted() const
+// Multi-source form of bldSendPacket(): one fiducial, one header pass,
+// one multi-message send per uSendPacketsChunk packets, or in container
+// mode one datagram per as many sources as fit
+int BldPvClientBasic::bldSendPackets(
+	epicsTimeStamp		*	pTsFiducial,
+	const BldPacketDesc	*	pPackets,
+	unsigned int			uPacketCount )
 {
-    return _bBldStarted;
-}
+    if ( !_bBldStarted )
+        return 1; // return status, without error report
+    if ( uPacketCount == 0 )
+        return 0;
 
-int BldPvClientBasic::bldConfigSend(
-	const char		*	sAddr,
-	unsigned short		uPort, 
-	unsigned int		uMaxDataSize,
-	const char		*	sInterfaceIp	)
-{
-    BldPacketHeader::Initialize();
+    // Datagrams on the wire and their bytes, and the ones that failed
+    int iRetErrorCode = 0;
+    size_t uSentSize = 0;
+    unsigned int uDatagrams = 0;
+    unsigned int uFailed = uPacketCount;
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
 
-    if ( _bBldStarted )
-    {
-        printf( "BldPvClientBasic::bldConfigSend() : Need to stop bld before config\n" );
-        return 1;
-    }
-            
-    // Check for valid parameters
-    // Note: sInterfaceIp == NULL is okay, which means default NIC is used
-    if ( sAddr == NULL || uMaxDataSize <= 0 ) 
-    {
-        printf( "BldPvClientBasic::bldConfigSend() : Input parameter invalid\n" );
-        return 2;
-    }
+	try
+	{
+		if ( _apBldNetworkClient.get() == NULL )
+			throw string( "BldNetworkClient is uninitialized\n" );
+		if ( pPackets == NULL )
+			throw string( "No packet descriptors\n" );
 
-    printf( "Configuring bld:\n" );
-    
-    _uBldServerAddr = ntohl( inet_addr( sAddr ) );
-    _uBldServerPort = uPort;
-    _uMaxDataSize = uMaxDataSize;
-    _sBldInterfaceIp.assign(sInterfaceIp == NULL? "" : sInterfaceIp);  
+		// Check every packet before the fiducial is claimed, so a bad
+		// descriptor sends nothing and the fiducial can be retried
+		for ( unsigned int uPacket = 0; uPacket < uPacketCount; uPacket++ )
+		{
+			if ( pPackets[uPacket].sPacket > _uMaxDataSize
+			  || BldXtcHeader::extentSize( pPackets[uPacket].sPacket ) > _uMaxDataSize + sizeof(BldXtcHeader) )
+				throw string( "Packet Size is larger than max value\n" );
+			if ( pPackets[uPacket].pPacket == NULL && pPackets[uPacket].sPacket != 0 )
+				throw string( "Packet without payload\n" );
+		}
 
-    bldShowConfig();
- 
-    return 0;
-}
+		const unsigned int	uFiducialId	= _packetFiducial( pTsFiducial );
+		const uint32_t		uSecs		= pTsFiducial->secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH;
 
-int BldPvClientBasic::bldConfig( const char* sAddr, unsigned short uPort, 
-  unsigned int uMaxDataSize, const char* sInterfaceIp, unsigned int uSrcPhysicalId, unsigned int uxtcDataType, 
-  const char* sBldPvPreTrigger, const char* sBldPvPostTrigger, const char* sBldPvFiducial, const char* sBldPvList )
-{
-    BldPacketHeader::Initialize();
+		BldPacketHeader		lBldPacketHeader[uSendPacketsChunk];
+		struct iovec		lIov[2 * uSendPacketsChunk];
+		if ( _bContainerMode )
+		{
+			// Containers are built as they go, a failed send loses the one datagram
+			uFailed = 1;
+			_sendContainers( uSecs, pTsFiducial->nsec, uFiducialId, pPackets, uPacketCount, uDatagrams, uSentSize );
+		}
+		else for ( unsigned int uFirst = 0; uFirst < uPacketCount; uFirst += uSendPacketsChunk )
+		{
+			const unsigned int uChunk = std::min( uPacketCount - uFirst, (unsigned int) uSendPacketsChunk );
+			size_t uChunkSize = 0;
+			for ( unsigned int uPacket = 0; uPacket < uChunk; uPacket++ )
+			{
+				const BldPacketDesc& desc = pPackets[uFirst + uPacket];
+				lBldPacketHeader[uPacket].Setup( desc.sPacket, uSecs, pTsFiducial->nsec,
+												 uFiducialId, desc.srcPhysicalId, desc.xtcDataType );
+				lIov[2 * uPacket].iov_base		= (caddr_t)( &lBldPacketHeader[uPacket] );
+				lIov[2 * uPacket].iov_len		= sizeof(BldPacketHeader);
+				lIov[2 * uPacket + 1].iov_base	= (caddr_t)( desc.pPacket );
+				lIov[2 * uPacket + 1].iov_len	= desc.sPacket;
+				uChunkSize += sizeof(BldPacketHeader) + desc.sPacket;
+			}
 
-    if ( _bBldStarted )
-    {
+			/* Send out bld */
+			int iFailSend = _sendRawVBatch( lIov, 2, uChunk );
+			if ( iFailSend != 0 )
+				throw string( "bldSendPackets: _apBldNetworkClient->sendRawDataVBatch() Failed\n" );
+			uSentSize += uChunkSize;
+			uDatagrams += uChunk;
+			uFailed -= uChunk;
+		}
+
+		if ( _iDebugLevel >= 2 )
+		{
+			printf( "Sent %u Bld packets to Addr %x Port %d Interface %s Fiducial 0x%05X\n",
+			  uPacketCount, _uBldServerAddr, _uBldServerPort, GetInterfaceIp(), uFiducialId );
+		}
+	}
+	catch (string& sError)
+	{
+		printf( "BldPvClientBasic::bldSendPackets() : %s\n", sError.c_str() );
+
+		iRetErrorCode = 2;
+	}
+
+	_sendStats.recordLatency( ullStartNs );
+	if ( uDatagrams != 0 )
+		_sendStats.recordSend( uDatagrams, uSentSize );
+	if ( iRetErrorCode != 0 )
+		_sendStats.recordFailure( 0, uFailed );
+
+    return iRetErrorCode;
+}
+
+/**
+ * Send the packets of bldSendPackets() as container datagrams
+ *
+ * Each datagram takes sources while they fit in the max data size, header
+ * included, and at most uSendPacketsChunk of them. Payloads are gathered
+ * straight from the caller's buffers. Throws on a failed send, uDatagrams
+ * and uSentSize then count the datagrams sent before it.
+ */
+void BldPvClientBasic::_sendContainers( uint32_t uSecs, uint32_t uNSecs, unsigned int uFiducialId,
+  const BldPacketDesc* pPackets, unsigned int uPacketCount, unsigned int& uDatagrams, size_t& uSentSize )
+{
+	static const char	lcPadding[4]	= { 0, 0, 0, 0 };
+	const unsigned int	uMaxPacketSize	= _uMaxDataSize + sizeof(BldPacketHeader);
+
+	BldPacketHeader		bldPacketHeader;
+	BldXtcHeader		lXtc[uSendPacketsChunk];
+	struct iovec		lIov[1 + 3 * uSendPacketsChunk];
+
+	unsigned int uPacket = 0;
+	while ( uPacket < uPacketCount )
+	{
+		// Take sources while they fit, the first one always does
+		unsigned int	uSize		= BldContainerPacket::prefixSize();
+		int				iIovCount	= 1;
+		for ( unsigned int uChild = 0; uChild < uSendPacketsChunk && uPacket < uPacketCount; uChild++, uPacket++ )
+		{
+			const BldPacketDesc& desc = pPackets[uPacket];
+			if ( uChild != 0 && uSize + BldXtcHeader::extentSize( desc.sPacket ) > uMaxPacketSize )
+				break;
+
+			const unsigned int uExtent = lXtc[uChild].Setup( desc.srcPhysicalId, desc.xtcDataType, desc.sPacket );
+			lIov[iIovCount].iov_base	= (caddr_t)( &lXtc[uChild] );
+			lIov[iIovCount].iov_len		= sizeof(BldXtcHeader);
+			iIovCount++;
+			if ( desc.sPacket != 0 )
+			{
+				lIov[iIovCount].iov_base	= (caddr_t)( desc.pPacket );
+				lIov[iIovCount].iov_len		= desc.sPacket;
+				iIovCount++;
+			}
+			if ( uExtent != sizeof(BldXtcHeader) + desc.sPacket )
+			{
+				lIov[iIovCount].iov_base	= (caddr_t)( lcPadding );
+				lIov[iIovCount].iov_len		= uExtent - sizeof(BldXtcHeader) - desc.sPacket;
+				iIovCount++;
+			}
+			uSize += uExtent;
+		}
+
+		bldPacketHeader.SetupContainer( uSecs, uNSecs, uFiducialId, _uContainerPhysicalId,
+										uSize - BldContainerPacket::prefixSize() );
+		lIov[0].iov_base	= (caddr_t)( &bldPacketHeader );
+		lIov[0].iov_len		= BldContainerPacket::prefixSize();
+
+		/* Send out bld */
+		if ( _sendRawV( lIov, iIovCount ) != 0 )
+			throw string( "bldSendPackets: _apBldNetworkClient->sendRawDataV() Failed\n" );
+		uSentSize += uSize;
+		uDatagrams++;
+	}
+}
+
+/**
+ * Lease payload space for one packet, directly behind its BldPacketHeader
+ *
+ * The driver writes its payload there and passes the pointer to
+ * bldCommitPacket(), or to bldReleasePacket() to drop it, so the payload is
+ * written exactly once. Every lease must be committed or released before
+ * bldStop().
+ *
+ * @return  the payload pointer, NULL if not started, sPacket is too large or no buffer is free
+ */
+void* BldPvClientBasic::bldAcquirePacket( size_t sPacket )
+{
+    if ( !_bBldStarted || _apBldNetworkClient.get() == NULL )
+        return NULL;
+    if ( sPacket > _uMaxDataSize )
+    {
+        printf( "BldPvClientBasic::bldAcquirePacket() : Packet Size %zu is larger than max value %u\n",
+          sPacket, _uMaxDataSize );
+        return NULL;
+    }
+
+    const unsigned int uSize = sizeof(BldPacketHeader) + sPacket;
+    char* pBuffer = NULL;
+    // Pinned buffers only help when the packet goes to the kernel from here
+    if ( _apBldAsyncSender.get() == NULL )
+        pBuffer = _apBldNetworkClient->acquireTxBuffer( uSize );
+    if ( pBuffer == NULL )
+        pBuffer = _leasePoolSlot( uSize );
+    if ( pBuffer == NULL )
+        return NULL;
+
+    new ( pBuffer ) BldPacketHeader();
+    return (BldPacketHeader*) pBuffer + 1;
+}
+
+/**
+ * Stamp the header of a leased packet and send it
+ *
+ * The lease ends here, whether the send succeeds or not.
+ */
+int BldPvClientBasic::bldCommitPacket(
+	void			*	pPayload,
+	unsigned int		srcPhysicalId,
+	unsigned int		xtcDataType,
+	epicsTimeStamp	*	pTsFiducial,
+	size_t				sPacket	)
+{
+    if ( pPayload == NULL )
+        return 1;
+
+    char* pBuffer = (char*) ( (BldPacketHeader*) pPayload - 1 );
+    if ( !_bBldStarted || _apBldNetworkClient.get() == NULL )
+    {
+        bldReleasePacket( pPayload );
+        return 1; // return status, without error report
+    }
+
+    int iRetErrorCode = 0;
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+
+	try
+	{
+		const unsigned int	uFiducialId	= _packetFiducial( pTsFiducial );
+
+		if ( sPacket > _uMaxDataSize )
+		    throw string("Packet Size is larger than max value\n");
+
+		BldPacketHeader* pBldPacketHeader = (BldPacketHeader*) pBuffer;
+		pBldPacketHeader->Setup(	sPacket, pTsFiducial->secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH,
+									pTsFiducial->nsec, uFiducialId, srcPhysicalId, xtcDataType	);
+
+		/* Send out bld */
+		int iFailSend;
+		if ( _isPoolLease( pBuffer ) )
+		{
+			iFailSend = _sendRaw( sizeof(BldPacketHeader) + sPacket, pBuffer );
+			_returnLease( pBuffer );
+		}
+		else
+		{
+			iFailSend = _apBldNetworkClient->sendTxBuffer( pBuffer, sizeof(BldPacketHeader) + sPacket );
+			epicsMutexMustLock( _leaseLock );
+			_uLeasesCommitted++;
+			epicsMutexUnlock( _leaseLock );
+		}
+		pBuffer = NULL;
+		if ( iFailSend != 0 )
+			throw string( "bldCommitPacket: _apBldNetworkClient->sendRawData() Failed\n" );
+
+		if ( _iDebugLevel >= 2 )
+		{
+			printf( "Sent Bld to Addr %x Port %d Interface %s sPkt %zu Fiducial 0x%05X\n",
+			  _uBldServerAddr, _uBldServerPort, GetInterfaceIp(), sPacket, uFiducialId );
+		}
+	}
+	catch (string& sError)
+	{
+		printf( "BldPvClientBasic::bldCommitPacket() : %s\n", sError.c_str() );
+
+		iRetErrorCode = 2;
+	}
+	if ( pBuffer != NULL )
+		bldReleasePacket( pPayload );
+
+	_recordSend( ullStartNs, iRetErrorCode, sizeof(BldPacketHeader) + sPacket );
+
+    return iRetErrorCode;
+}
+
+void BldPvClientBasic::bldReleasePacket( void* pPayload )
+{
+    if ( pPayload == NULL )
+        return;
+
+    char* pBuffer = (char*) ( (BldPacketHeader*) pPayload - 1 );
+    if ( _isPoolLease( pBuffer ) )
+    {
+        epicsMutexMustLock( _leaseLock );
+        _luLeaseFree[_uLeaseFreeCount++] = ( pBuffer - _pLeasePool ) / _uLeaseSlotSize;
+        _uLeasesReleased++;
+        epicsMutexUnlock( _leaseLock );
+    }
+    else if ( _apBldNetworkClient.get() != NULL )
+    {
+        _apBldNetworkClient->releaseTxBuffer( pBuffer );
+        epicsMutexMustLock( _leaseLock );
+        _uLeasesReleased++;
+        epicsMutexUnlock( _leaseLock );
+    }
+}
+
+int BldPvClientBasic::bldSetBatchMode( unsigned int uMaxBatch, unsigned int uDeadlineUs )
+{
+    _uBatchMax        = uMaxBatch;
+    _uBatchDeadlineUs = uDeadlineUs;
+
+    // Takes effect right away if we're running, otherwise on the next bldStart()
+    if ( _apBldNetworkClient.get() != NULL )
+        return _apBldNetworkClient->setBatchMode( _uBatchMax, _uBatchDeadlineUs );
+    return 0;
+}
+
+int BldPvClientBasic::bldFlush()
+{
+    if ( !_bBldStarted || _apBldNetworkClient.get() == NULL )
+        return 1; // return status, without error report
+
+    epicsMutexMustLock( _pulseLock );
+    int iRetErrorCode = _flushPulsesLocked( PULSE_FLUSH_EXPLICIT );
+    epicsMutexUnlock( _pulseLock );
+    return _apBldNetworkClient->flush() | iRetErrorCode;
+}
+
+int BldPvClientBasic::bldSetAsyncMode( unsigned int uRingDepth, int iOverflowPolicy )
+{
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldSetAsyncMode() : Need to stop bld before config\n" );
+        return 1;
+    }
+    if ( iOverflowPolicy != BLD_ASYNC_DROP_NEWEST && iOverflowPolicy != BLD_ASYNC_SEND_SYNC )
+    {
+        printf( "BldPvClientBasic::bldSetAsyncMode() : Invalid overflow policy %d\n", iOverflowPolicy );
+        return 2;
+    }
+
+    _uAsyncRingDepth = uRingDepth;
+    _iAsyncOverflow  = iOverflowPolicy;
+    return 0;
+}
+
+int BldPvClientBasic::bldSetBackpressure( int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg )
+{
+    if ( iPolicy < BLD_BACKPRESSURE_BLOCK || iPolicy > BLD_BACKPRESSURE_SPIN )
+    {
+        printf( "BldPvClientBasic::bldSetBackpressure() : Invalid policy %d\n", iPolicy );
+        return 2;
+    }
+
+    _iBpPolicy        = iPolicy;
+    _uBpSndBufPackets = uSndBufPackets;
+    _uBpPolicyArg     = uPolicyArg;
+
+    // Takes effect right away if we're running, otherwise on the next bldStart()
+    if ( _apBldNetworkClient.get() != NULL )
+        return _apBldNetworkClient->setBackpressure( _iBpPolicy, _uBpSndBufPackets, _uBpPolicyArg );
+    return 0;
+}
+
+int BldPvClientBasic::bldSetMonitorMode( int iEnable )
+{
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldSetMonitorMode() : Need to stop bld before config\n" );
+        return 1;
+    }
+
+    _bMonitorMode = ( iEnable != 0 );
+    return 0;
+}
+
+int BldPvClientBasic::bldSetContainerMode( int iEnable, unsigned int uPhysicalId )
+{
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldSetContainerMode() : Need to stop bld before config\n" );
+        return 1;
+    }
+
+    _bContainerMode         = ( iEnable != 0 );
+    _uContainerPhysicalId   = uPhysicalId;
+    return 0;
+}
+
+int BldPvClientBasic::bldSetPulseIdMode( int iEnable )
+{
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldSetPulseIdMode() : Need to stop bld before config\n" );
+        return 1;
+    }
+
+    _bPulseIdMode = ( iEnable != 0 );
+    return 0;
+}
+
+int BldPvClientBasic::bldSetPulseBatch( unsigned int uMaxPulses, unsigned int uDeadlineUs )
+{
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldSetPulseBatch() : Need to stop bld before config\n" );
+        return 1;
+    }
+    if ( uMaxPulses > uPulseBatchLimit )
+    {
+        printf( "BldPvClientBasic::bldSetPulseBatch() : %u pulses per datagram, limited to %u\n",
+          uMaxPulses, (unsigned int) uPulseBatchLimit );
+        uMaxPulses = uPulseBatchLimit;
+    }
+
+    _uPulseBatchMax     = uMaxPulses;
+    _uPulseDeadlineUs   = uDeadlineUs;
+    return 0;
+}
+
+int BldPvClientBasic::bldSetNetworkFlags( unsigned int uFlags )
+{
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldSetNetworkFlags() : Need to stop bld before config\n" );
+        return 1;
+    }
+
+    _uNetworkFlags = uFlags;
+    return 0;
+}
+
+int BldPvClientBasic::bldSetTransport( const char* sTransport )
+{
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldSetTransport() : Need to stop bld before config\n" );
+        return 1;
+    }
+
+    _sTransport = ( sTransport != NULL && sTransport[0] != 0 ? sTransport : "udp" );
+    return 0;
+}
+
+int BldPvClientBasic::bldGetStats( BldSendStats* pClientStats, BldSendStats* pNetworkStats )
+{
+    _sendStats.snapshot( pClientStats );
+    if ( pNetworkStats == NULL )
+        return 0;
+
+    int iRetErrorCode = 0;
+    epicsMutexMustLock( _networkLock );
+    if ( _apBldNetworkClient.get() != NULL )
+        _apBldNetworkClient->getSendStats( pNetworkStats );
+    else
+    {
+        memset( pNetworkStats, 0, sizeof(*pNetworkStats) );
+        iRetErrorCode = 1;
+    }
+    epicsMutexUnlock( _networkLock );
+    return iRetErrorCode;
+}
+
+void BldPvClientBasic::bldResetStats()
+{
+    _sendStats.reset();
+    _uLockPackets      = 0;
+    _uLockAcquisitions = 0;
+    _uLockFallbacks    = 0;
+    epicsMutexMustLock( _leaseLock );
+    _uLeasesCommitted  = 0;
+    _uLeasesReleased   = 0;
+    _uLeasesDenied     = 0;
+    epicsMutexUnlock( _leaseLock );
+    epicsMutexMustLock( _pulseLock );
+    _uPulseDatagrams      = 0;
+    _uPulsesSent          = 0;
+    memset( _luPulseFlushes, 0, sizeof(_luPulseFlushes) );
+    _ullPulseLatencySumNs = 0;
+    _ullPulseLatencyMaxNs = 0;
+    epicsMutexUnlock( _pulseLock );
+    epicsMutexMustLock( _pulseIdLock );
+    _uPulseIdsSent      = 0;
+    _uPulseIdDuplicates = 0;
+    _uPulseIdGaps       = 0;
+    _uPulseIdOutOfOrder = 0;
+    _ullPulseIdsMissed  = 0;
+    epicsMutexUnlock( _pulseIdLock );
+    epicsMutexMustLock( _networkLock );
+    if ( _apBldNetworkClient.get() != NULL )
+        _apBldNetworkClient->resetSendStats();
+    epicsMutexUnlock( _networkLock );
+}
+
+void BldPvClientBasic::bldShowStats( int iReset )
+{
+    BldSendStats    clientStats, networkStats;
+    int iNoNetwork = bldGetStats( &clientStats, &networkStats );
+    const unsigned long uLockPackets = _uLockPackets, uLockAcquisitions = _uLockAcquisitions;
+    const unsigned long uLockFallbacks = _uLockFallbacks;
+    epicsMutexMustLock( _leaseLock );
+    const unsigned long uLeasesCommitted = _uLeasesCommitted, uLeasesReleased = _uLeasesReleased;
+    const unsigned long uLeasesDenied = _uLeasesDenied;
+    const unsigned int uLeasesOut = ( _pLeasePool != NULL ? uLeaseSlots - _uLeaseFreeCount : 0 );
+    epicsMutexUnlock( _leaseLock );
+    epicsMutexMustLock( _pulseLock );
+    const unsigned long uPulseDatagrams = _uPulseDatagrams, uPulsesSent = _uPulsesSent;
+    unsigned long luPulseFlushes[PULSE_FLUSH_REASONS];
+    memcpy( luPulseFlushes, _luPulseFlushes, sizeof(luPulseFlushes) );
+    const unsigned long long ullPulseLatencySumNs = _ullPulseLatencySumNs;
+    const unsigned long long ullPulseLatencyMaxNs = _ullPulseLatencyMaxNs;
+    epicsMutexUnlock( _pulseLock );
+    epicsMutexMustLock( _pulseIdLock );
+    const unsigned long long ullPulseIdPrev = _ullPulseIdPrev, ullPulseIdsMissed = _ullPulseIdsMissed;
+    const unsigned long uPulseIdsSent = _uPulseIdsSent, uPulseIdDuplicates = _uPulseIdDuplicates;
+    const unsigned long uPulseIdGaps = _uPulseIdGaps, uPulseIdOutOfOrder = _uPulseIdOutOfOrder;
+    epicsMutexUnlock( _pulseIdLock );
+    if ( iReset != 0 )
+        bldResetStats();
+
+    printf( "BLD Send Stats (%s):\n", _bBldStarted ? "started" : "stopped" );
+    BldShowSendStats( "Client", &clientStats );
+    printf( "  Scan locks: %lu over %lu packets (%.2f per packet, %zu locksets for %zu PVs), %lu fallbacks\n",
+      uLockAcquisitions, uLockPackets, uLockPackets == 0 ? 0.0 : (double) uLockAcquisitions / uLockPackets,
+      epicsAtomicGetSizeT( &_uPlanLockGroupCount ), epicsAtomicGetSizeT( &_uPlanPvCount ), uLockFallbacks );
+    printf( "  Packet leases: %lu committed, %lu released, %lu denied, %u pool slots leased\n",
+      uLeasesCommitted, uLeasesReleased, uLeasesDenied, uLeasesOut );
+    if ( _uPulseBatchMax > 1 || uPulseDatagrams != 0 )
+    {
+        // Added latency: how long each pulse waited in the batch for the datagram to go out
+        printf( "  Pulse batches: %lu pulses in %lu datagrams (%.1f per datagram), flushed by count %lu "
+          "size %lu span %lu deadline %lu explicit %lu\n",
+          uPulsesSent, uPulseDatagrams, uPulseDatagrams == 0 ? 0.0 : (double) uPulsesSent / uPulseDatagrams,
+          luPulseFlushes[PULSE_FLUSH_COUNT], luPulseFlushes[PULSE_FLUSH_SIZE], luPulseFlushes[PULSE_FLUSH_SPAN],
+          luPulseFlushes[PULSE_FLUSH_DEADLINE], luPulseFlushes[PULSE_FLUSH_EXPLICIT] );
+        printf( "    added latency avg %.1f us max %.1f us\n",
+          uPulsesSent == 0 ? 0.0 : ullPulseLatencySumNs * 1e-3 / uPulsesSent, ullPulseLatencyMaxNs * 1e-3 );
+    }
+    if ( ullPulseIdPrev != PULSE_ID_NOT_SET )
+        printf( "  Pulse IDs: last %llu, %lu sent, %lu duplicates, %lu gaps (%llu pulses missed), %lu out of order\n",
+          ullPulseIdPrev, uPulseIdsSent, uPulseIdDuplicates, uPulseIdGaps, ullPulseIdsMissed, uPulseIdOutOfOrder );
+    if ( iNoNetwork == 0 )
+        BldShowSendStats( "Network", &networkStats );
+    else
+        printf( "  Network: not started\n" );
+}
+
+bool BldPvClientBasic::IsStarted() const
+{
+    return _bBldStarted;
+}
+
+int BldPvClientBasic::bldConfigSend(
+	const char		*	sAddr,
+	unsigned short		uPort, 
+	unsigned int		uMaxDataSize,
+	const char		*	sInterfaceIp	)
+{
+    BldPacketHeader::Initialize();
+
+    if ( _bBldStarted )
+    {
+        printf( "BldPvClientBasic::bldConfigSend() : Need to stop bld before config\n" );
+        return 1;
+    }
+            
+    // Check for valid parameters
+    // Note: sInterfaceIp == NULL is okay, which means default NIC is used
+    if ( sAddr == NULL || uMaxDataSize <= 0 ) 
+    {
+        printf( "BldPvClientBasic::bldConfigSend() : Input parameter invalid\n" );
+        return 2;
+    }
+
+    printf( "Configuring bld:\n" );
+    
+    _uBldServerAddr = ntohl( inet_addr( sAddr ) );
+    _uBldServerPort = uPort;
+    _uMaxDataSize = uMaxDataSize;
+    _sBldInterfaceIp.assign(sInterfaceIp == NULL? "" : sInterfaceIp);  
+
+    bldShowConfig();
+ 
+    return 0;
+}
+
+int BldPvClientBasic::bldConfig( const char* sAddr, unsigned short uPort, 
+  unsigned int uMaxDataSize, const char* sInterfaceIp, unsigned int uSrcPhysicalId, unsigned int uxtcDataType, 
+  const char* sBldPvPreTrigger, const char* sBldPvPostTrigger, const char* sBldPvFiducial, const char* sBldPvList )
+{
+    BldPacketHeader::Initialize();
+
+    if ( _bBldStarted )
+    {
         printf( "BldPvClientBasic::bldConfig() : Need to stop bld before config\n" );
         return 1;
     }
-            
-    // Check for valid parameters
-    // Note: sInterfaceIp == NULL is okay, which means default NIC is used
-    if ( sAddr == NULL || uMaxDataSize <= 0 || sBldPvPreTrigger == NULL || sBldPvPostTrigger == NULL || sBldPvList == NULL ) 
+            
+    // Check for valid parameters
+    // Note: sInterfaceIp == NULL is okay, which means default NIC is used
+    if ( sAddr == NULL || uMaxDataSize <= 0 || sBldPvPreTrigger == NULL || sBldPvPostTrigger == NULL || sBldPvList == NULL ) 
+    {
+        printf( "BldPvClientBasic::bldConfig() : Input parameter invalid\n" );
+        return 2;
+    }
+
+    printf( "Configuring bld:\n" );
+    
+    _uBldServerAddr = ntohl( inet_addr( sAddr ) );
+    _uBldServerPort = uPort;    
+    _uMaxDataSize = uMaxDataSize;
+    _sBldInterfaceIp.assign(sInterfaceIp == NULL? "" : sInterfaceIp);  
+    _uSrcPhysicalId = uSrcPhysicalId;
+    _uxtcDataType = uxtcDataType;
+    _sBldPvPreTrigger.assign(sBldPvPreTrigger);
+    _sBldPvPostTrigger.assign(sBldPvPostTrigger);
+    _sBldPvFiducial.assign(sBldPvFiducial); 
+    _sBldPvList.assign(sBldPvList);
+                      
+    bldShowConfig();
+    
+    return 0;
+}
+
+void BldPvClientBasic::bldShowConfig()
+{
+    unsigned int uServerNetworkAddr = htonl(_uBldServerAddr);
+    unsigned char* pcAddr = (unsigned char*) &uServerNetworkAddr;
+    printf(	"  Configurable parameters:\n"
+			"    Server Addr %u.%u.%u.%u  Port %d  MaxDataSize %u\n"
+			"    MulticastIF %s\n",
+			pcAddr[0], pcAddr[1], pcAddr[2], pcAddr[3],
+			_uBldServerPort, _uMaxDataSize, GetInterfaceIp()	);
+    if ( _sTransport != "udp" )
+		printf(	"    Transport %s\n", _sTransport.c_str() );
+    if ( _uNetworkFlags != 0 )
+		printf(	"    Network Flags 0x%X%s%s%s%s\n", _uNetworkFlags,
+				(_uNetworkFlags & BLD_NETWORK_CONNECTED) ? " (connected)" : "",
+				(_uNetworkFlags & BLD_NETWORK_ZEROCOPY) ? " (zerocopy)" : "",
+				(_uNetworkFlags & BLD_NETWORK_IO_URING) ? " (io_uring)" : "",
+				(_uNetworkFlags & BLD_NETWORK_SQPOLL) ? " (sqpoll)" : "" );
+    if ( _uSrcPhysicalId || _uxtcDataType )
+		printf(	"    Source Id %d Data Version %d Data Type %d (0x%X)\n",
+				_uSrcPhysicalId, (_uxtcDataType>>16), (_uxtcDataType&0xFFFF), _uxtcDataType );
+    if ( _bContainerMode )
+		printf(	"    Container Mode: BldSendPackets() sources packed into Id_Xtc from Source Id %u\n",
+				_uContainerPhysicalId );
+    if ( _uPulseBatchMax > 1 )
+		printf(	"    Pulse Batch: up to %u pulses per datagram, deadline %u us\n",
+				_uPulseBatchMax, _uPulseDeadlineUs );
+    if ( _bPulseIdMode )
+		printf(	"    Pulse-ID Mode: %s read as a 64-bit pulse ID\n", _sBldPvFiducial.c_str() );
+
+	if ( _sBldPvPreTrigger.size() == 0 && _sBldPvList.size() == 0 )
+	{
+		// Simple BldConfigSend
+		printf( "BLD Configured w/o PV dependencies.\n"
+				"Use BldSendPacket() from driver code to send packets\n" );
+	}
+	else
+	{
+		// Full BldConfig w/ PreTrigger, PostTrigger, and PV list
+		printf(
+		  "    PvPreTrigger <%s>\n"
+		  "    PvPostTrigger <%s>\n"
+		  "    PvFiducial <%s>\n"
+		  "    PvList <%s>\n",
+		  _sBldPvPreTrigger.c_str(), _sBldPvPostTrigger.c_str(),
+		  _sBldPvFiducial.c_str(),   _sBldPvList.c_str() );
+		if ( _bBldStarted )
+			printf( "    Read Plan: %zu PVs in %zu locksets%s, %s\n", _vPvPlan.size(), _vLockGroups.size(),
+					_bFiducialPlanned ? " + fiducial" : "",
+					_uPackPvCount != 0 ? "typed packer" : ( _pTypeFields != NULL ? "field table" : "per-PV setter" ) );
+		if ( _bMonitorMode )
+			printf( "    Monitor Mode: %zu subscriptions, %lu updates\n", _vMonitors.size(), _uMonitorUpdates );
+		if ( _iDebugLevel >= 2 )
+		{
+			for ( size_t uPvIndex = 0; uPvIndex < _vPvPlan.size(); uPvIndex++ )
+				printf( "      [%zu] %s  dbr type %d  elements %ld  payload offset %u\n", uPvIndex,
+						_vPvPlan[uPvIndex].dbAddr.precord->name, _vPvPlan[uPvIndex].iRequestType,
+						_vPvPlan[uPvIndex].lNumElements, _vPvPlan[uPvIndex].uPayloadOffset );
+			for ( size_t uGroup = 0; uGroup < _vLockGroups.size(); uGroup++ )
+				printf( "      lockset %lu: %u PVs, first %s\n", _vLockGroups[uGroup].uLockId,
+						_vLockGroups[uGroup].uCount,
+						_vPvPlan[_vuLockOrder[_vLockGroups[uGroup].uFirst]].dbAddr.precord->name );
+		}
+
+		printf( "  Internal Settings:\n"
+		  "    Pre  Subroutine Record <%s>  PvPreTrigger.FLNK <%s>\n"
+		  "    Post Subroutine Record <%s>  PvPostTrigger.FLNK <%s>\n",
+		  _sBldPvPreSubRec.c_str(), _sBldPvPreTriggerPrevFLNK.c_str(),
+		  _sBldPvPostSubRec.c_str(), _sBldPvPostTriggerPrevFLNK.c_str() );      
+		if ( _sBldPvPreTrigger.size() != 0 && _sBldPvPreTrigger == _sBldPvPreSubRec )
+		{
+			printf( "WARNING: PvPreTrigger is same PV as %s!\n", _sBldPvPreSubRec.c_str() );
+			printf( "Normally, PvPreTrigger should be the name of a local PV\n"
+					"that processes when the fiducial is ready to fetch.\n" );
+		}
+		if ( _sBldPvPostTrigger.size() != 0 && _sBldPvPostTrigger == _sBldPvPostSubRec )
+		{
+			printf( "WARNING: PvPostTrigger is same PV as %s!\n", _sBldPvPostSubRec.c_str() );
+			printf( "Normally, PvPostTrigger should be the name of a local PV\n"
+					"that you want to process after the BLD data has been sent.\n" );
+		}
+	}
+	if ( _uBatchMax > 1 )
+	{
+		printf( "    Batch Mode: max %u packets, deadline %u us\n", _uBatchMax, _uBatchDeadlineUs );
+		if ( _apBldNetworkClient.get() != NULL )
+		{
+			BldBatchStats	stats;
+			_apBldNetworkClient->getBatchStats( &stats );
+			printf( "    Batch Stats: queued %lu sent %lu dropped %lu batches %lu syscalls %lu max batch %u\n"
+					"                 flushes: count %lu deadline %lu explicit %lu ring full %lu\n",
+					stats.uPktsQueued, stats.uPktsSent, stats.uPktsDropped, stats.uBatches,
+					stats.uSendCalls, stats.uMaxBatch,
+					stats.uFlushByCount, stats.uFlushByDeadline, stats.uFlushExplicit, stats.uFlushByRingFull );
+		}
+	}
+	if ( _iBpPolicy != BLD_BACKPRESSURE_BLOCK || _uBpSndBufPackets != 0 )
+	{
+		static const char* lsPolicy[] = { "block", "drop newest", "drop oldest", "spin" };
+		printf( "    Backpressure: %s, send buffer %u packets, policy arg %u\n",
+				lsPolicy[_iBpPolicy], _uBpSndBufPackets, _uBpPolicyArg );
+		if ( _apBldNetworkClient.get() != NULL )
+		{
+			BldBackpressureStats	stats;
+			_apBldNetworkClient->getBackpressureStats( &stats );
+			printf( "    Backpressure Stats: would block %lu dropped newest %lu SO_SNDBUF %u bytes\n"
+					"                        queued %lu queue sent %lu dropped oldest %lu high water %u\n"
+					"                        spins %lu spin sent %lu spin timeouts %lu\n",
+					stats.uWouldBlock, stats.uDropNewest, stats.uSndBufBytes,
+					stats.uQueued, stats.uQueueSent, stats.uDropOldest, stats.uQueueHighWater,
+					stats.uSpins, stats.uSpinSent, stats.uSpinTimeouts );
+		}
+	}
+	if ( _uAsyncRingDepth > 0 )
+	{
+		printf( "    Async Mode: ring depth %u, on overflow %s\n", _uAsyncRingDepth,
+				_iAsyncOverflow == BLD_ASYNC_SEND_SYNC ? "send sync" : "drop newest" );
+		if ( _apBldAsyncSender.get() != NULL )
+		{
+			BldAsyncStats	stats;
+			_apBldAsyncSender->getStats( &stats );
+			printf( "    Async Stats: queued %zu sent %zu failed %zu dropped %zu sync %zu high water %zu/%u\n",
+					stats.uPktsQueued, stats.uPktsSent, stats.uSendFailed, stats.uPktsDropped,
+					stats.uSyncSent, stats.uHighWater, _apBldAsyncSender->getRingDepth() );
+		}
+	}
+	if ( _apBldNetworkClient.get() != NULL )
+	{
+		BldBatchStats	stats;
+		_apBldNetworkClient->getBatchStats( &stats );
+		if ( stats.uBursts != 0 )
+			printf( "    Burst Stats: bursts %lu packets %lu gso sends %lu\n",
+					stats.uBursts, stats.uBurstPkts, stats.uGsoSends );
+	}
+	BldZeroCopyStats	zcStats;
+	if ( _apBldNetworkClient.get() != NULL && _apBldNetworkClient->getZeroCopyStats( &zcStats ) == 0 )
+		printf( "    ZeroCopy Stats: sends %lu completions %lu copied %lu pool exhausted %lu in flight %u (max %u)\n"
+				"                    completion lag us: min %.1f avg %.1f max %.1f\n",
+				zcStats.uZeroCopySends, zcStats.uCompletions, zcStats.uCopied, zcStats.uPoolExhausted,
+				zcStats.uInFlight, zcStats.uInFlightMax,
+				zcStats.dfLagMinUs, zcStats.dfLagAvgUs, zcStats.dfLagMaxUs );
+	printf( "    DebugLevel %d\n", _iDebugLevel );      
+}
+
+/*
+ * private static member functions
+ */
+int BldPvClientBasic::_splitPvList( const string& sBldPvList, std::vector<string>& vsBldPv )
+{
+    size_t	uOffsetStart = sBldPvList.find_first_not_of( sPvListSeparators, 0 );
+    while ( uOffsetStart != string::npos )      
+    {
+        size_t uOffsetEnd = sBldPvList.find_first_of( sPvListSeparators, uOffsetStart+1 );
+
+        if ( uOffsetEnd == string::npos )        
+        {
+            vsBldPv.push_back( sBldPvList.substr( uOffsetStart, string::npos ) );
+            break;
+        }
+        
+        vsBldPv.push_back( sBldPvList.substr( uOffsetStart, uOffsetEnd - uOffsetStart ) );
+        uOffsetStart = sBldPvList.find_first_not_of( sPvListSeparators, uOffsetEnd+1 );        
+    }
+    return 0;
+}
+
+/**
+ * Split a PV list entry "NAME[N]" into NAME and N, a plain name has N = 0
+ */
+int BldPvClientBasic::_splitPvArray( const string& sBldPv, string& sPvName, unsigned int* puArrayCount )
+{
+    *puArrayCount = 0;
+    const size_t uBracket = sBldPv.find( '[' );
+    if ( uBracket == string::npos )
+    {
+        sPvName = sBldPv;
+        return 0;
+    }
+
+    const char* sCount = sBldPv.c_str() + uBracket + 1;
+    char* sEnd = NULL;
+    const unsigned long ulCount = strtoul( sCount, &sEnd, 10 );
+    if ( uBracket == 0 || sEnd == sCount || ulCount == 0 || ulCount > 0xFFFF || strcmp( sEnd, "]" ) != 0 )
+    {
+        printf( "_splitPvArray(): Invalid PV list entry %s, expected NAME or NAME[count]\n", sBldPv.c_str() );
+        return 1;
+    }
+    sPvName = sBldPv.substr( 0, uBracket );
+    *puArrayCount = (unsigned int) ulCount;
+    return 0;
+}
+
+/**
+ * Split a PV list entry and give it the next double slots of the payload
+ *
+ * *puSlot is the first free slot and is moved past the entry. Without a field
+ * table an array must fit the payload of uSrcPhysicalId and one read of
+ * uPvBufferSize bytes, so it can be stored with one bulk copy per shot.
+ */
+int BldPvClientBasic::_layoutPvEntry( const string& sBldPv, unsigned int uSrcPhysicalId, unsigned int uPvBufferSize,
+  unsigned int* puSlot, string& sPvName, unsigned int* puArrayCount )
+{
+    if ( _splitPvArray( sBldPv, sPvName, puArrayCount ) != 0 )
+        return 1;
+
+    const unsigned int uFirstSlot = *puSlot;
+    *puSlot += std::max( *puArrayCount, 1U );
+    if ( *puArrayCount == 0 || BldPacketHeader::getFields( uSrcPhysicalId ) != NULL )
+        return 0;
+
+    const unsigned int uPayloadSize = BldPacketHeader::getPayloadSize( uSrcPhysicalId );
+    if ( *puSlot * sizeof(double) > uPayloadSize || *puArrayCount * sizeof(double) > uPvBufferSize )
+    {
+        printf( "_layoutPvEntry(): %s needs payload bytes %u to %u, type %u has %u and PVs are read "
+                "%u bytes at a time\n", sBldPv.c_str(), (unsigned int) ( uFirstSlot * sizeof(double) ),
+                (unsigned int) ( *puSlot * sizeof(double) ), uSrcPhysicalId, uPayloadSize, uPvBufferSize );
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Check the entries of a PV list and the room its arrays need, as
+ * _buildReadPlan() would for a client configured with uMaxDataSize.
+ * The PVs themselves are not looked up.
+ */
+int BldPvClientBasic::checkPvList( unsigned int uSrcPhysicalId, unsigned int uMaxDataSize, const char* sBldPvList )
+{
+    BldPacketHeader::Initialize();
+
+    if ( sBldPvList == NULL )
+    {
+        printf( "BldPvClientBasic::checkPvList() : No PV list\n" );
+        return 1;
+    }
+
+    std::vector<string> vsBldPv;
+    _splitPvList( sBldPvList, vsBldPv );
+
+    unsigned int uSlot = 0;
+    for ( size_t uPvIndex = 0; uPvIndex < vsBldPv.size(); uPvIndex++ )
+    {
+        string sPvName;
+        unsigned int uArrayCount = 0;
+        if ( _layoutPvEntry( vsBldPv[uPvIndex], uSrcPhysicalId, _pvBufferSize( uMaxDataSize ), &uSlot, sPvName,
+          &uArrayCount ) != 0 )
+            return 1;
+    }
+    printf( "PV list: %zu PVs in %u double slots, type %u has %u payload bytes\n", vsBldPv.size(), uSlot,
+      uSrcPhysicalId, BldPacketHeader::getPayloadSize( uSrcPhysicalId ) );
+    return 0;
+}
+
+/**
+ * Record uFiducialId as the last fiducial sent and return the one before it
+ *
+ * Lock-free, so concurrent bldSendPacket() callers each see a distinct
+ * predecessor and a duplicate is caught exactly once.
+ */
+unsigned int BldPvClientBasic::_exchangeFiducial( unsigned int uFiducialId )
+{
+    int iFiducialIdPrev;
+    do
+        iFiducialIdPrev = epicsAtomicGetIntT( &_iFiducialIdPrev );
+    while ( epicsAtomicCmpAndSwapIntT( &_iFiducialIdPrev, iFiducialIdPrev, (int) uFiducialId ) != iFiducialIdPrev );
+    return (unsigned int) iFiducialIdPrev;
+}
+
+/**
+ * Validate the fiducial of a driver packet and record it as the last one sent
+ */
+unsigned int BldPvClientBasic::_packetFiducial( const epicsTimeStamp* pTsFiducial )
+{
+    /* New regime - Use the fiducial timestamp! */
+    const unsigned int uFiducialId = pTsFiducial->nsec & FIDUCIAL_MASK;
+    if ( uFiducialId >= FIDUCIAL_INVALID )
+        throw string( "Invalid Fiducial 0x1FFFF\n" );
+    if ( _exchangeFiducial( uFiducialId ) == uFiducialId )
+        throw string("Duplicate Fiducial in bldPacket!\n");
+    return uFiducialId;
+}
+
+/**
+ * Validate a 64-bit pulse ID, count gaps and duplicates, and return its fiducial
+ *
+ * Duplicates are checked against the highest pulse ID sent so far. A lower one
+ * is sent and counted as out of order, concurrent bldSendPacketPulseId()
+ * callers may legitimately race that way.
+ */
+unsigned int BldPvClientBasic::_packetPulseId( unsigned long long ullPulseId )
+{
+    if ( ullPulseId == PULSE_ID_NOT_SET )
+        throw string( "Invalid Pulse ID 0\n" );
+
+    epicsMutexMustLock( _pulseIdLock );
+    const unsigned long long ullPulseIdPrev = _ullPulseIdPrev;
+    if ( ullPulseId == ullPulseIdPrev )
+        _uPulseIdDuplicates++;
+    else if ( ullPulseId < ullPulseIdPrev )
+    {
+        _uPulseIdOutOfOrder++;
+        _uPulseIdsSent++;
+    }
+    else
+    {
+        if ( ullPulseIdPrev != PULSE_ID_NOT_SET && ullPulseId - ullPulseIdPrev > 1 )
+        {
+            _uPulseIdGaps++;
+            _ullPulseIdsMissed += ullPulseId - ullPulseIdPrev - 1;
+        }
+        _ullPulseIdPrev = ullPulseId;
+        _uPulseIdsSent++;
+    }
+    epicsMutexUnlock( _pulseIdLock );
+
+    if ( ullPulseId == ullPulseIdPrev )
+        throw string( "Duplicate Pulse ID in BLD!\n" );
+    return (unsigned int) ( ullPulseId & FIDUCIAL_MASK );
+}
+
+/**
+ * Take a free slot of the lease pool, allocating or resizing the pool if none is leased
+ */
+char* BldPvClientBasic::_leasePoolSlot( unsigned int uSize )
+{
+    const unsigned int uSlotSize = ( std::max( uSize, _uMsgBufferSize ) + uCacheLine - 1 ) & ~(uCacheLine - 1);
+    char* pBuffer = NULL;
+
+    epicsMutexMustLock( _leaseLock );
+    if ( ( _pLeasePool == NULL || uSlotSize > _uLeaseSlotSize ) && _uLeaseFreeCount == uLeaseSlots )
+    {
+        _freeAligned( _pLeasePool );
+        _pLeasePool = NULL;
+    }
+    if ( _pLeasePool == NULL )
+    {
+        _pLeasePool = (char*) _mallocAligned( uLeaseSlots * uSlotSize );
+        _uLeaseSlotSize = uSlotSize;
+        _uLeaseFreeCount = 0;
+        for ( unsigned int uSlot = 0; _pLeasePool != NULL && uSlot < uLeaseSlots; uSlot++ )
+            _luLeaseFree[_uLeaseFreeCount++] = uLeaseSlots - 1 - uSlot;
+    }
+    if ( _pLeasePool != NULL && uSize <= _uLeaseSlotSize && _uLeaseFreeCount > 0 )
+        pBuffer = _pLeasePool + _luLeaseFree[--_uLeaseFreeCount] * _uLeaseSlotSize;
+    else
+        _uLeasesDenied++;
+    epicsMutexUnlock( _leaseLock );
+    return pBuffer;
+}
+
+void BldPvClientBasic::_returnLease( char* pBuffer )
+{
+    epicsMutexMustLock( _leaseLock );
+    _luLeaseFree[_uLeaseFreeCount++] = ( pBuffer - _pLeasePool ) / _uLeaseSlotSize;
+    _uLeasesCommitted++;
+    epicsMutexUnlock( _leaseLock );
+}
+
+/**
+ * Replace the network client, the stats calls may be reading it from another thread
+ */
+void BldPvClientBasic::_resetNetworkClient( BldNetworkClientInterface* pNetworkClient )
+{
+    epicsMutexMustLock( _networkLock );
+    _apBldNetworkClient.reset( pNetworkClient );
+    epicsMutexUnlock( _networkLock );
+}
+
+/**
+ * Size the per-shot buffers for _uMaxDataSize. Called by bldStart() only.
+ */
+void BldPvClientBasic::_allocBuffers()
+{
+    const unsigned int uMsgBufferSize = _uMaxDataSize + sizeof(BldPacketHeader);
+    const unsigned int uPvBufferSize  = _pvBufferSize( _uMaxDataSize );
+    if ( uMsgBufferSize == _uMsgBufferSize && uPvBufferSize == _uPvBufferSize )
+        return;
+
+    _freeBuffers();
+    llBufPvVal  = (long*) _mallocAligned( uPvBufferSize );
+    lcMsgBuffer = (char*) _mallocAligned( uMsgBufferSize );
+    if ( llBufPvVal == NULL || lcMsgBuffer == NULL )
+    {
+        _freeBuffers();
+        throw string("Failed to allocate the BLD buffers\n");
+    }
+    _uPvBufferSize  = uPvBufferSize;
+    _uMsgBufferSize = uMsgBufferSize;
+}
+
+/// Bytes of the PV value scratch for uMaxDataSize, whole longs
+unsigned int BldPvClientBasic::_pvBufferSize( unsigned int uMaxDataSize )
+{
+    return ( std::max( uMaxDataSize, (unsigned int) uPvBufferMinSize ) + sizeof(long) - 1 ) & ~(sizeof(long) - 1);
+}
+
+void BldPvClientBasic::_freeBuffers()
+{
+    _freeAligned( llBufPvVal );
+    _freeAligned( lcMsgBuffer );
+    llBufPvVal      = NULL;
+    lcMsgBuffer     = NULL;
+    _uPvBufferSize  = 0;
+    _uMsgBufferSize = 0;
+}
+
+/**
+ * Resolve the fiducial PV and the PV list. Called by bldStart() only.
+ */
+int BldPvClientBasic::_buildReadPlan()
+{
+    std::vector<string> vsBldPv;
+    _splitPvList( _sBldPvList, vsBldPv );
+
+    _vPvPlan.clear();
+    _vPvPlan.reserve( vsBldPv.size() );
+    _bFiducialPlanned = false;
+
+    // Each PV takes the next double slot of the payload, an array entry N of them
+    _pTypeFields = BldPacketHeader::getFields( _uSrcPhysicalId );
+    const bool bLayout = ( BldPacketHeader::getPackerPvCount( _uSrcPhysicalId ) != 0 );
+    unsigned int uSlot = 0;
+    for ( size_t uPvIndex = 0; uPvIndex < vsBldPv.size(); uPvIndex++ )
+    {
+        string sPvName;
+        BldPvPlanEntry pvPlan;
+        unsigned int uArrayCount = 0;
+        const unsigned int uFirstSlot = uSlot;
+        if ( _layoutPvEntry( vsBldPv[uPvIndex], _uSrcPhysicalId, _uPvBufferSize, &uSlot, sPvName,
+          &uArrayCount ) != 0 || planPv( sPvName.c_str(), _uPvBufferSize, &pvPlan ) != 0 )
+        {
+            _vPvPlan.clear();
+            return 1;
+        }
+        pvPlan.uPayloadOffset = uFirstSlot * sizeof(double);
+        pvPlan.uArrayCount    = uArrayCount;
+        pvPlan.iSetterIndex   = (int) uFirstSlot;
+        if ( uArrayCount != 0 && _pTypeFields == NULL )
+        {
+            pvPlan.iRequestType = DBR_DOUBLE;
+            pvPlan.lNumElements = std::min( (long) pvPlan.dbAddr.no_elements, (long) uArrayCount );
+        }
+        else if ( bLayout )
+        {
+            // A typed layout holds doubles, staged or set one value per PV
+            pvPlan.iRequestType = DBR_DOUBLE;
+            pvPlan.lNumElements = 1;
+        }
+        _vPvPlan.push_back( pvPlan );
+    }
+
+    // A PV list shorter than the typed layout keeps the per-PV setter,
+    // which leaves the missing fields alone
+    _uPackPvCount = BldPacketHeader::getPackerPvCount( _uSrcPhysicalId );
+    if ( uSlot < _uPackPvCount )
+        _uPackPvCount = 0;
+    _vdPvStage.assign( _uPackPvCount, 0.0 );
+
+    // A field table says how each PV is read; fields without a PV stay zero
+    if ( _pTypeFields != NULL )
     {
-        printf( "BldPvClientBasic::bldConfig() : Input parameter invalid\n" );
-        return 2;
+        for ( size_t uPvIndex = 0; uPvIndex < _vPvPlan.size() && uPvIndex < _pTypeFields->uFieldCount; uPvIndex++ )
+        {
+            const BldFieldDesc& field = _pTypeFields->pFields[uPvIndex];
+            BldPvPlanEntry& pvPlan = _vPvPlan[uPvIndex];
+            pvPlan.iRequestType = field.iDbrType;
+            pvPlan.lNumElements = std::min( (long) pvPlan.dbAddr.no_elements, std::min( (long) field.uCount,
+              (long) ( _uPvBufferSize / BldPacketHeader::getDbrElementSize( field.iDbrType ) ) ) );
+            if ( pvPlan.uArrayCount != 0 )
+                pvPlan.lNumElements = std::min( pvPlan.lNumElements, (long) pvPlan.uArrayCount );
+            pvPlan.uPayloadOffset = field.uOffset;
+            pvPlan.iSetterIndex   = (int) uPvIndex;
+        }
+        _vdFieldStage.assign( ( _pTypeFields->uStageSize + sizeof(double) - 1 ) / sizeof(double), 0.0 );
+        _vlFieldCounts.assign( _pTypeFields->uFieldCount, 0 );
     }
 
-    printf( "Configuring bld:\n" );
-    
-    _uBldServerAddr = ntohl( inet_addr( sAddr ) );
-    _uBldServerPort = uPort;    
-    _uMaxDataSize = uMaxDataSize;
-    _sBldInterfaceIp.assign(sInterfaceIp == NULL? "" : sInterfaceIp);  
-    _uSrcPhysicalId = uSrcPhysicalId;
-    _uxtcDataType = uxtcDataType;
-    _sBldPvPreTrigger.assign(sBldPvPreTrigger);
-    _sBldPvPostTrigger.assign(sBldPvPostTrigger);
-    _sBldPvFiducial.assign(sBldPvFiducial); 
-    _sBldPvList.assign(sBldPvList);
-                      
-    bldShowConfig();
-    
+    if ( _sBldPvFiducial.length() > 0 )
+    {
+        if ( planPv( _sBldPvFiducial.c_str(), _uPvBufferSize, &_fiducialPlan ) != 0 )
+        {
+            _vPvPlan.clear();
+            return 1;
+        }
+        // A pulse ID is read as a double whatever the field type: exact up
+        // to 2^53, and databases before EPICS 7 have no 64-bit integer fields
+        if ( _bPulseIdMode )
+        {
+            _fiducialPlan.iRequestType = DBR_DOUBLE;
+            _fiducialPlan.lNumElements = 1;
+        }
+        _bFiducialPlanned = true;
+    }
+
+    _groupByLockset();
+
+    if ( _iDebugLevel >= 1 )
+        printf( "Read plan: %zu PVs in %zu locksets%s\n", _vPvPlan.size(), _vLockGroups.size(),
+          _bFiducialPlanned ? " + fiducial" : "" );
     return 0;
 }
 
-void BldPvClientBasic::bldShowConfig()
+/**
+ * Group the read plan by lockset, keeping the PV list order within each group
+ */
+void BldPvClientBasic::_groupByLockset()
 {
-    unsigned int uServerNetworkAddr = htonl(_uBldServerAddr);
-    unsigned char* pcAddr = (unsigned char*) &uServerNetworkAddr;
-    printf(	"  Configurable parameters:\n"
-			"    Server Addr %u.%u.%u.%u  Port %d  MaxDataSize %u\n"
-			"    MulticastIF %s\n",
-			pcAddr[0], pcAddr[1], pcAddr[2], pcAddr[3],
-			_uBldServerPort, _uMaxDataSize, GetInterfaceIp()	);
-    if ( _uSrcPhysicalId || _uxtcDataType )
-		printf(	"    Source Id %d Data Version %d Data Type %d (0x%X)\n",
-				_uSrcPhysicalId, (_uxtcDataType>>16), (_uxtcDataType&0xFFFF), _uxtcDataType );
+    std::vector< std::pair<unsigned long, unsigned int> > vLockIndex;
+    vLockIndex.reserve( _vPvPlan.size() );
+    for ( size_t uPvIndex = 0; uPvIndex < _vPvPlan.size(); uPvIndex++ )
+        vLockIndex.push_back( std::make_pair( dbLockGetLockId( _vPvPlan[uPvIndex].dbAddr.precord ),
+          (unsigned int) uPvIndex ) );
+    std::stable_sort( vLockIndex.begin(), vLockIndex.end() );
+
+    _vLockGroups.clear();
+    _vuLockOrder.clear();
+    _vuLockOrder.reserve( vLockIndex.size() );
+    _vuLockDeferred.clear();
+    _vuLockDeferred.reserve( vLockIndex.size() );
+    for ( size_t uSlot = 0; uSlot < vLockIndex.size(); uSlot++ )
+    {
+        if ( _vLockGroups.empty() || _vLockGroups.back().uLockId != vLockIndex[uSlot].first )
+        {
+            BldPvLockGroup group;
+            group.uLockId = vLockIndex[uSlot].first;
+            group.uFirst  = uSlot;
+            group.uCount  = 0;
+            _vLockGroups.push_back( group );
+        }
+        _vLockGroups.back().uCount++;
+        _vuLockOrder.push_back( vLockIndex[uSlot].second );
+    }
+}
 
-	if ( _sBldPvPreTrigger.size() == 0 && _sBldPvList.size() == 0 )
-	{
-		// Simple BldConfigSend
-		printf( "BLD Configured w/o PV dependencies.\n"
-				"Use BldSendPacket() from driver code to send packets\n" );
-	}
-	else
-	{
-		// Full BldConfig w/ PreTrigger, PostTrigger, and PV list
-		printf(
-		  "    PvPreTrigger <%s>\n"
-		  "    PvPostTrigger <%s>\n"
-		  "    PvFiducial <%s>\n"
-		  "    PvList <%s>\n",
-		  _sBldPvPreTrigger.c_str(), _sBldPvPostTrigger.c_str(),
-		  _sBldPvFiducial.c_str(),   _sBldPvList.c_str() );
+/**
+ * Read the PV list into the packet, one scan lock round trip per lockset
+ *
+ * Locksets change when links are modified at run time. A PV that no longer
+ * shares the group's lockset is skipped under the lock and read afterwards
+ * with its own dbGetField(), never by locking a second lockset.
+ */
+void BldPvClientBasic::_readLockGroups( BldPacketHeader* pBldPacketHeader )
+{
+    unsigned long uAcquisitions = 0;
+    _vuLockDeferred.clear();
 
-		printf( "  Internal Settings:\n"
-		  "    Pre  Subroutine Record <%s>  PvPreTrigger.FLNK <%s>\n"
-		  "    Post Subroutine Record <%s>  PvPostTrigger.FLNK <%s>\n",
-		  _sBldPvPreSubRec.c_str(), _sBldPvPreTriggerPrevFLNK.c_str(),
-		  _sBldPvPostSubRec.c_str(), _sBldPvPostTriggerPrevFLNK.c_str() );      
-		if ( _sBldPvPreTrigger.size() != 0 && _sBldPvPreTrigger == _sBldPvPreSubRec )
-		{
-			printf( "WARNING: PvPreTrigger is same PV as %s!\n", _sBldPvPreSubRec.c_str() );
-			printf( "Normally, PvPreTrigger should be the name of a local PV\n"
-					"that processes when the fiducial is ready to fetch.\n" );
-		}
-		if ( _sBldPvPostTrigger.size() != 0 && _sBldPvPostTrigger == _sBldPvPostSubRec )
-		{
-			printf( "WARNING: PvPostTrigger is same PV as %s!\n", _sBldPvPostSubRec.c_str() );
-			printf( "Normally, PvPostTrigger should be the name of a local PV\n"
-					"that you want to process after the BLD data has been sent.\n" );
-		}
-	}
-	printf( "    DebugLevel %d\n", _iDebugLevel );      
+    for ( size_t uGroup = 0; uGroup < _vLockGroups.size(); uGroup++ )
+    {
+        const BldPvLockGroup& group = _vLockGroups[uGroup];
+        dbCommon* pLockRecord = _vPvPlan[_vuLockOrder[group.uFirst]].dbAddr.precord;
+        if ( _iDebugLevel >= 3 )
+            printf( "Reading lockset of %s: %u PVs...\n", pLockRecord->name, group.uCount );
+
+        const BldPvPlanEntry* pFailed = NULL;
+        dbScanLock( pLockRecord );
+        uAcquisitions++;
+        const unsigned long uLockId = dbLockGetLockId( pLockRecord );
+        for ( unsigned int uSlot = group.uFirst; uSlot < group.uFirst + group.uCount; uSlot++ )
+        {
+            const unsigned int uPvIndex = _vuLockOrder[uSlot];
+            BldPvPlanEntry& pvPlan = _vPvPlan[uPvIndex];
+            if ( uSlot != group.uFirst && dbLockGetLockId( pvPlan.dbAddr.precord ) != uLockId )
+            {
+                _vuLockDeferred.push_back( uPvIndex );
+                continue;
+            }
+
+            long lNumElements = pvPlan.lNumElements;
+            long int lOptions = 0;
+            if ( dbGet( &pvPlan.dbAddr, pvPlan.iRequestType, llBufPvVal, &lOptions, &lNumElements, NULL ) != 0 ||
+              _storePvValue( pBldPacketHeader, uPvIndex, lNumElements ) != 0 )
+            {
+                pFailed = &pvPlan;
+                break;
+            }
+        }
+        dbScanUnlock( pLockRecord );
+
+        if ( pFailed != NULL )
+        {
+            _uLockAcquisitions += uAcquisitions;
+            throw string("readPv(") + pFailed->dbAddr.precord->name + ") Failed\n";
+        }
+    }
+
+    for ( size_t uDeferred = 0; uDeferred < _vuLockDeferred.size(); uDeferred++ )
+    {
+        const unsigned int uPvIndex = _vuLockDeferred[uDeferred];
+        BldPvPlanEntry& pvPlan = _vPvPlan[uPvIndex];
+        uAcquisitions++;
+        _uLockFallbacks++;
+        long lNumElements = 0;
+        if ( readPv( pvPlan, llBufPvVal, NULL, &lNumElements ) != 0 ||
+          _storePvValue( pBldPacketHeader, uPvIndex, lNumElements ) != 0 )
+        {
+            _uLockAcquisitions += uAcquisitions;
+            throw string("readPv(") + pvPlan.dbAddr.precord->name + ") Failed\n";
+        }
+    }
+
+    // Outside the scan locks: the whole payload in one pass
+    if ( _uPackPvCount != 0 && pBldPacketHeader->packPayload( &_vdPvStage[0], _uPackPvCount ) != 0 )
+    {
+        _uLockAcquisitions += uAcquisitions;
+        throw string("packPayload() Failed\n");
+    }
+    if ( _pTypeFields != NULL )
+        pBldPacketHeader->packFields( _pTypeFields, (const char*) &_vdFieldStage[0], &_vlFieldCounts[0] );
+
+    _uLockPackets++;
+    _uLockAcquisitions += uAcquisitions;
 }
 
-/*
- * private static member functions
+/**
+ * Subscribe to every PV of the read plan. Called by bldStart() after _buildReadPlan().
  */
-int BldPvClientBasic::_splitPvList( const string& sBldPvList, std::vector<string>& vsBldPv )
+int BldPvClientBasic::_startMonitors()
 {
-    size_t	uOffsetStart = sBldPvList.find_first_not_of( sPvListSeparators, 0 );
-    while ( uOffsetStart != string::npos )      
+    _uShadowSize = _uMaxDataSize + sizeof(BldPacketHeader);
+    _llMonitorBuf = (long*) _mallocAligned( _uPvBufferSize );
+    _plShadow[0]  = new (std::nothrow) long[(_uShadowSize + sizeof(long) - 1) / sizeof(long)];
+    _plShadow[1]  = new (std::nothrow) long[(_uShadowSize + sizeof(long) - 1) / sizeof(long)];
+    if ( _llMonitorBuf == NULL || _plShadow[0] == NULL || _plShadow[1] == NULL )
     {
-        size_t uOffsetEnd = sBldPvList.find_first_of( sPvListSeparators, uOffsetStart+1 );
+        printf( "_startMonitors(): Failed to allocate the monitor buffers\n" );
+        _stopMonitors();
+        return 1;
+    }
+    for ( int iBuffer = 0; iBuffer < 2; iBuffer++ )
+    {
+        memset( _plShadow[iBuffer], 0, _uShadowSize );
+        // setPvValue() needs the physical id, the rest is stamped per shot
+        new ( _plShadow[iBuffer] ) BldPacketHeader( _uShadowSize, 0, 0, 0, 0, _uSrcPhysicalId, _uxtcDataType );
+    }
+    _uShadowFront    = 0;
+    _bShadowDirty    = false;
+    _bShadowStale    = false;
+    _uMonitorUpdates = 0;
 
-        if ( uOffsetEnd == string::npos )        
+    _monitorCtx = db_init_events();
+    if ( _monitorCtx == NULL )
+    {
+        printf( "_startMonitors(): db_init_events() failed\n" );
+        _stopMonitors();
+        return 1;
+    }
+
+    _vMonitors.resize( _vPvPlan.size() );
+    for ( size_t uPvIndex = 0; uPvIndex < _vPvPlan.size(); uPvIndex++ )
+    {
+        BldPvMonitor& monitor = _vMonitors[uPvIndex];
+        monitor.pClient      = this;
+        monitor.uPvIndex     = uPvIndex;
+        monitor.pChannel     = dbChannelCreate( _vPvPlan[uPvIndex].sName.c_str() );
+        if ( monitor.pChannel == NULL || dbChannelOpen( monitor.pChannel ) != 0 )
         {
-            vsBldPv.push_back( sBldPvList.substr( uOffsetStart, string::npos ) );
-            break;
+            printf( "_startMonitors(): dbChannelCreate/Open(%s) failed\n", _vPvPlan[uPvIndex].sName.c_str() );
+            _stopMonitors();
+            return 1;
         }
-        
-        vsBldPv.push_back( sBldPvList.substr( uOffsetStart, uOffsetEnd - uOffsetStart ) );
-        uOffsetStart = sBldPvList.find_first_not_of( sPvListSeparators, uOffsetEnd+1 );        
+        monitor.subscription = db_add_event( _monitorCtx, monitor.pChannel,
+          _monitorCallback, &monitor, DBE_VALUE | DBE_ALARM );
+        if ( monitor.subscription == NULL )
+        {
+            printf( "_startMonitors(): db_add_event(%s) failed\n", _vPvPlan[uPvIndex].sName.c_str() );
+            _stopMonitors();
+            return 1;
+        }
+    }
+
+    if ( db_start_events( _monitorCtx, "bldMonitor", NULL, NULL, epicsThreadPriorityScanHigh ) != 0 )
+    {
+        printf( "_startMonitors(): db_start_events() failed\n" );
+        _stopMonitors();
+        return 1;
+    }
+
+    // Post each current value once, so the payload starts out complete
+    for ( size_t uPvIndex = 0; uPvIndex < _vMonitors.size(); uPvIndex++ )
+    {
+        db_event_enable( _vMonitors[uPvIndex].subscription );
+        db_post_single_event( _vMonitors[uPvIndex].subscription );
+    }
+    return 0;
+}
+
+void BldPvClientBasic::_stopMonitors()
+{
+    // db_cancel_event() waits for a callback in progress to finish, so the
+    // channel can go right after its subscription
+    for ( size_t uPvIndex = 0; uPvIndex < _vMonitors.size(); uPvIndex++ )
+    {
+        if ( _vMonitors[uPvIndex].subscription != NULL )
+            db_cancel_event( _vMonitors[uPvIndex].subscription );
+        if ( _vMonitors[uPvIndex].pChannel != NULL )
+            dbChannelDelete( _vMonitors[uPvIndex].pChannel );
+    }
+    _vMonitors.clear();
+
+    if ( _monitorCtx != NULL )
+        db_close_events( _monitorCtx );
+    _monitorCtx = NULL;
+
+    for ( int iBuffer = 0; iBuffer < 2; iBuffer++ )
+    {
+        delete [] _plShadow[iBuffer];
+        _plShadow[iBuffer] = NULL;
+    }
+    _freeAligned( _llMonitorBuf );
+    _llMonitorBuf = NULL;
+}
+
+/**
+ * Allocate the pending pulse buffers and the deadline timer, if batching is on
+ *
+ * Datagrams are limited to one MTU, or to one pulse of the max data size
+ * if that is larger.
+ */
+void BldPvClientBasic::_startPulseBatch()
+{
+    _uPulseMaxSize = 0;
+    _uPulseCount   = 0;
+    _uPulseDamage  = 0;
+    if ( _uPulseBatchMax <= 1 )
+        return;
+
+    _uPulseMaxSize  = std::max( (unsigned int) (iMTU - uUdpIpHeaderSize), _pulseDatagramSize( 1, _uMaxDataSize ) );
+    _pPulsePayloads = (char*) _mallocAligned( _uPulseMaxSize );
+    _pPulseIndex    = new (std::nothrow) BldPulseIndexEntry[_uPulseBatchMax];
+    _pullPulseAddNs = new (std::nothrow) unsigned long long[_uPulseBatchMax];
+    if ( _pPulsePayloads == NULL || _pPulseIndex == NULL || _pullPulseAddNs == NULL )
+        throw string( "Failed to allocate the pulse batch buffers\n" );
+
+    if ( _uPulseDeadlineUs != 0 )
+    {
+        _pulseTimerQueue = epicsTimerQueueAllocate( 1, epicsThreadPriorityScanHigh );
+        _pulseTimer      = epicsTimerQueueCreateTimer( _pulseTimerQueue, _pulseDeadlineCallback, this );
+    }
+}
+
+/**
+ * Stop the deadline timer, send the pending pulses and free the buffers
+ */
+void BldPvClientBasic::_stopPulseBatch()
+{
+    // Destroying the timer waits for a callback in progress to finish
+    if ( _pulseTimer != NULL )
+        epicsTimerQueueDestroyTimer( _pulseTimerQueue, _pulseTimer );
+    if ( _pulseTimerQueue != NULL )
+        epicsTimerQueueRelease( _pulseTimerQueue );
+    _pulseTimer      = NULL;
+    _pulseTimerQueue = NULL;
+
+    epicsMutexMustLock( _pulseLock );
+    if ( _apBldNetworkClient.get() != NULL )
+        _flushPulsesLocked( PULSE_FLUSH_EXPLICIT );
+    _uPulseCount = 0;
+    epicsMutexUnlock( _pulseLock );
+
+    _freeAligned( _pPulsePayloads );
+    delete [] _pPulseIndex;
+    delete [] _pullPulseAddNs;
+    _pPulsePayloads = NULL;
+    _pPulseIndex    = NULL;
+    _pullPulseAddNs = NULL;
+    _uPulseMaxSize  = 0;
+}
+
+/**
+ * Add the payload of a complete packet to the pending multi-pulse datagram
+ *
+ * The pending pulses go out first if this one differs in size, would not
+ * fit, or is too far in time from the first one for the index.
+ */
+int BldPvClientBasic::_addPulse( const BldPacketHeader* pBldPacketHeader, uint32_t uSecs, uint32_t uNSecs,
+  unsigned int uFiducialId, unsigned long long ullPulseId )
+{
+    const unsigned int uPulseSize = pBldPacketHeader->getPacketSize() - sizeof(BldPacketHeader);
+    const unsigned long long ullNowNs = BldSendStatsCounter::nowNs();
+    int iRetErrorCode = 0;
+
+    epicsMutexMustLock( _pulseLock );
+    long long llOffsetNs = 0;
+    if ( _uPulseCount != 0 )
+    {
+        llOffsetNs = ( (long long) uSecs - _uPulseSecs ) * 1000000000LL + ( (long long) uNSecs - _uPulseNSecs );
+        if ( uPulseSize != _uPulseSize || _pulseDatagramSize( _uPulseCount + 1, uPulseSize ) > _uPulseMaxSize )
+            iRetErrorCode = _flushPulsesLocked( PULSE_FLUSH_SIZE );
+        else if ( llOffsetNs < -0x7FFFFFFFLL - 1 || llOffsetNs > 0x7FFFFFFFLL
+          || ullPulseId - _ullPulseFirstId + 0x80000000ULL > 0xFFFFFFFFULL )
+            iRetErrorCode = _flushPulsesLocked( PULSE_FLUSH_SPAN );
+    }
+    if ( _uPulseCount == 0 )
+    {
+        llOffsetNs          = 0;
+        _uPulseSecs         = uSecs;
+        _uPulseNSecs        = uNSecs;
+        _uPulseFiducialId   = uFiducialId;
+        _ullPulseFirstId    = ullPulseId;
+        _uPulseSize         = uPulseSize;
+        if ( _pulseTimer != NULL )
+            epicsTimerStartDelay( _pulseTimer, _uPulseDeadlineUs * 1e-6 );
+    }
+
+    BldPulseIndexEntry& entry = _pPulseIndex[_uPulseCount];
+    entry.uFiducialId       = BldPacketHeader::setu32LE( ullPulseId == PULSE_ID_NOT_SET ?
+                                uFiducialId : (uint32_t) ullPulseId );
+    entry.iNanoSecsOffset   = (int32_t) BldPacketHeader::setu32LE( (uint32_t) (int32_t) llOffsetNs );
+    memcpy( _pPulsePayloads + _uPulseCount * uPulseSize, pBldPacketHeader + 1, uPulseSize );
+    _uPulseDamage |= pBldPacketHeader->uDamage;
+    _pullPulseAddNs[_uPulseCount++] = ullNowNs;
+
+    if ( _uPulseCount >= _uPulseBatchMax )
+        iRetErrorCode |= _flushPulsesLocked( PULSE_FLUSH_COUNT );
+    epicsMutexUnlock( _pulseLock );
+    return iRetErrorCode;
+}
+
+/**
+ * Send the pending pulses as one multi-pulse datagram. Caller must hold _pulseLock.
+ */
+int BldPvClientBasic::_flushPulsesLocked( EPulseFlush eReason )
+{
+    if ( _uPulseCount == 0 )
+        return 0;
+
+    static const char lcPadding[4] = { 0, 0, 0, 0 };
+
+    BldPulseIndex index;
+    index.uPulseCount = BldPacketHeader::setu32LE( _uPulseCount );
+    index.uPulseSize  = BldPacketHeader::setu32LE( _uPulseSize );
+
+    const unsigned int uIndexSize   = _uPulseCount * sizeof(BldPulseIndexEntry);
+    const unsigned int uPayloadSize = _uPulseCount * _uPulseSize;
+    const unsigned int uData        = sizeof(BldPulseIndex) + uIndexSize + uPayloadSize;
+    BldXtcHeader xtc;
+    const unsigned int uExtent = xtc.Setup( _uSrcPhysicalId, _uxtcDataType, uData );
+    xtc.uDamage = _uPulseDamage;
+
+    BldPacketHeader bldPacketHeader;
+    bldPacketHeader.SetupContainer( _uPulseSecs, _uPulseNSecs, _uPulseFiducialId, _uSrcPhysicalId, uExtent,
+                                    BldPulseIndex::uMultiPulseType );
+    bldPacketHeader.setPulseId( _ullPulseFirstId );
+
+    struct iovec iov[6];
+    iov[0].iov_base = (caddr_t)( &bldPacketHeader );
+    iov[0].iov_len  = BldContainerPacket::prefixSize();
+    iov[1].iov_base = (caddr_t)( &xtc );
+    iov[1].iov_len  = sizeof(xtc);
+    iov[2].iov_base = (caddr_t)( &index );
+    iov[2].iov_len  = sizeof(index);
+    iov[3].iov_base = (caddr_t)( _pPulseIndex );
+    iov[3].iov_len  = uIndexSize;
+    iov[4].iov_base = (caddr_t)( _pPulsePayloads );
+    iov[4].iov_len  = uPayloadSize;
+    iov[5].iov_base = (caddr_t)( lcPadding );
+    iov[5].iov_len  = uExtent - sizeof(xtc) - uData;
+
+    const unsigned int uSize = BldContainerPacket::prefixSize() + uExtent;
+    int iFailSend = _sendRawV( iov, iov[5].iov_len != 0 ? 6 : 5 );
+    if ( iFailSend == 0 )
+        _sendStats.recordSend( 1, uSize );
+    else
+    {
+        _sendStats.recordFailure( 0 );
+        printf( "BldPvClientBasic::_flushPulsesLocked() : _apBldNetworkClient->sendRawDataV() Failed, "
+          "%u pulses lost\n", _uPulseCount );
     }
+
+    const unsigned long long ullNowNs = BldSendStatsCounter::nowNs();
+    for ( unsigned int uPulse = 0; uPulse < _uPulseCount; uPulse++ )
+    {
+        const unsigned long long ullWaitNs = ullNowNs - _pullPulseAddNs[uPulse];
+        _ullPulseLatencySumNs += ullWaitNs;
+        if ( ullWaitNs > _ullPulseLatencyMaxNs )
+            _ullPulseLatencyMaxNs = ullWaitNs;
+    }
+    _uPulseDatagrams++;
+    _uPulsesSent += _uPulseCount;
+    _luPulseFlushes[eReason]++;
+
+    _uPulseCount  = 0;
+    _uPulseDamage = 0;
+    return ( iFailSend != 0 ? 1 : 0 );
+}
+
+/**
+ * Flush the pending pulses once the first of them is _uPulseDeadlineUs old
+ */
+void BldPvClientBasic::_pulseDeadlineCallback( void* pArg )
+{
+    BldPvClientBasic* pClient = static_cast<BldPvClientBasic*>(pArg);
+
+    epicsMutexMustLock( pClient->_pulseLock );
+    if ( pClient->_uPulseCount != 0 )
+    {
+        // A count or size flush may have restarted the batch after this
+        // expiry was scheduled, so check the age of the current one
+        const unsigned long long ullAgeNs = BldSendStatsCounter::nowNs() - pClient->_pullPulseAddNs[0];
+        const double dfLeft = pClient->_uPulseDeadlineUs * 1e-6 - ullAgeNs * 1e-9;
+        if ( dfLeft > 0 )
+            epicsTimerStartDelay( pClient->_pulseTimer, dfLeft );
+        else
+            pClient->_flushPulsesLocked( PULSE_FLUSH_DEADLINE );
+    }
+    epicsMutexUnlock( pClient->_pulseLock );
+}
+
+/**
+ * Make the back copy the front one if it has updates, and return the front copy
+ */
+BldPacketHeader* BldPvClientBasic::_publishShadow()
+{
+    epicsMutexMustLock( _shadowLock );
+    if ( _bShadowDirty )
+    {
+        _uShadowFront ^= 1;
+        _bShadowDirty = false;
+        _bShadowStale = true;
+    }
+    BldPacketHeader* pBldPacketHeader = (BldPacketHeader*) _plShadow[_uShadowFront];
+    epicsMutexUnlock( _shadowLock );
+    return pBldPacketHeader;
+}
+
+/**
+ * dbEvent callback, runs in the bldMonitor event task
+ */
+void BldPvClientBasic::_monitorCallback( void* pArg, struct dbChannel* pChannel, int iEventsRemaining,
+  struct db_field_log* pfl )
+{
+    BldPvMonitor* pMonitor = static_cast<BldPvMonitor*>( pArg );
+    BldPvClientBasic* pClient = pMonitor->pClient;
+    const BldPvPlanEntry& pvPlan = pClient->_vPvPlan[pMonitor->uPvIndex];
+
+    // Read outside the shadow lock, the value comes from the event's field log
+    long lNumElements = pvPlan.lNumElements;
+    long int lOptions = 0;
+    int iStatus = dbChannelGetField( pChannel, pvPlan.iRequestType, pClient->_llMonitorBuf, &lOptions,
+      &lNumElements, pfl );
+    if ( iStatus != 0 )
+    {
+        if ( pClient->_iDebugLevel >= 2 )
+            printf( "_monitorCallback(): dbChannelGetField(%s) failed. Status  = 0x%X\n", dbChannelName( pChannel ),
+              iStatus );
+        return;
+    }
+
+    epicsMutexMustLock( pClient->_shadowLock );
+    char* pFront = (char*) pClient->_plShadow[pClient->_uShadowFront];
+    char* pBack  = (char*) pClient->_plShadow[pClient->_uShadowFront ^ 1];
+    if ( pClient->_bShadowStale )
+    {
+        // Catch up with the updates the last swap published
+        memcpy( pBack + sizeof(BldPacketHeader), pFront + sizeof(BldPacketHeader),
+          pClient->_uShadowSize - sizeof(BldPacketHeader) );
+        pClient->_bShadowStale = false;
+    }
+    if ( pvPlan.uArrayCount != 0 && pClient->_pTypeFields == NULL )
+        _storePvArray( pvPlan, pClient->_llMonitorBuf, lNumElements, pBack + sizeof(BldPacketHeader) );
+    else
+        ((BldPacketHeader*) pBack)->setPvValue( pvPlan.iSetterIndex, pClient->_llMonitorBuf, lNumElements );
+    pClient->_bShadowDirty = true;
+    pClient->_uMonitorUpdates++;
+    epicsMutexUnlock( pClient->_shadowLock );
+}
+
+/**
+ * Resolve a PV name for readPv( BldPvPlanEntry& ... ), same rules as readPv() by name
+ */
+int BldPvClientBasic::planPv( const char* sVariableName, int iBufferSize, BldPvPlanEntry* pEntry )
+{
+    if ( sVariableName == NULL || *sVariableName == 0 || pEntry == NULL )
+    {
+        printf( "planPv(): Invalid parameter\n" );
+        return 1;
+    }
+
+    int iStatus = dbNameToAddr( sVariableName, &pEntry->dbAddr );
+    if ( iStatus != 0 )
+    {
+        printf("planPv(): dbNameToAddr(%s) failed. Status  = 0x%X\n", sVariableName, iStatus);
+        return(iStatus);
+    }
+
+    pEntry->iRequestType = ( pEntry->dbAddr.dbr_field_type == DBR_ENUM ?
+      (short) DBR_STRING : pEntry->dbAddr.dbr_field_type );
+    pEntry->lNumElements = std::min( (int) pEntry->dbAddr.no_elements,
+      (iBufferSize/pEntry->dbAddr.field_size) );
+    pEntry->uPayloadOffset = 0;
+    pEntry->uArrayCount    = 0;
+    pEntry->iSetterIndex   = 0;
+    pEntry->sName          = sVariableName;
     return 0;
 }
 
+/**
+ * Read a PV resolved by planPv(), pBuffer must hold _uPvBufferSize bytes.
+ * *plNumElements, if given, gets the element count actually read.
+ */
+int BldPvClientBasic::readPv( BldPvPlanEntry& entry, void* pBuffer, epicsTimeStamp *ts, long* plNumElements )
+{
+    if (ts)
+        *ts = entry.dbAddr.precord->time;
+
+    long lNumElements = entry.lNumElements;
+    long int lOptions=0;
+    int iStatus = 
+      dbGetField(&entry.dbAddr,entry.iRequestType,pBuffer,&lOptions,
+      &lNumElements,NULL);
+    if ( iStatus != 0 )
+    {
+        printf("readPv(): dbGetField(%s) failed. Status  = 0x%X\n", entry.dbAddr.precord->name, iStatus);
+        return(iStatus);
+    }
+    if ( plNumElements != NULL )
+        *plNumElements = lNumElements;
+    return(0);
+}
+
 int BldPvClientBasic::readPv(
 	const char	*	sVariableName,
 	int			iBufferSize,
@@ -1088,3 +3249,11 @@ int BldPvClientBasic::sprintPv(const char *sVariableName, void* pBuffer,
 }
 
 } // namespace EpicsBld
+
+extern "C"
+{
+int BldCheckPvList(unsigned int uSrcPhysicalId, unsigned int uMaxDataSize, const char* sBldPvList)
+{
+    return EpicsBld::BldPvClientBasic::checkPvList( uSrcPhysicalId, uMaxDataSize, sBldPvList );
+}
+} // extern "C"
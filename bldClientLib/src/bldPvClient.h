@@ -3,6 +3,17 @@
 
 #include <epicsTime.h>
 
+#include "bldSendStats.h"
+
+/* One packet of a BldSendPackets() call */
+typedef struct BldPacketDesc
+{
+    unsigned int    srcPhysicalId;
+    unsigned int    xtcDataType;
+    void*           pPacket;        /* payload, packed little-endian as for BldSendPacket() */
+    size_t          sPacket;
+} BldPacketDesc;
+
 namespace EpicsBld
 {   
 /**
@@ -42,12 +53,98 @@ public:
  	// For RTEMS-powerpc or other big-endian platforms, use setu32LE
 	// and other little-endian conversion functions in blkdPacket.h
 	// to prepare your packets.
+	// Several threads may call bldSendPacket() on the same client at once,
+	// no external lock is needed.
     virtual int bldSendPacket(
 			unsigned int		srcPhysicalId,
 			unsigned int		xtcDataType,
 			epicsTimeStamp	*	pTsFiducial,
 			void			*	pPacket,
 			size_t				sPacket	) = 0; 
+
+	// bldSendPacket() with a 64-bit pulse ID, sent in the header's MBZ words
+	// (see BldPacketHeader::setPulseId()); the fiducial is its low 17 bits
+	// and the time stamp only gives the time. Gaps and duplicates are
+	// counted against the highest pulse ID sent.
+    virtual int bldSendPacketPulseId(
+			unsigned int		srcPhysicalId,
+			unsigned int		xtcDataType,
+			epicsTimeStamp	*	pTsFiducial,
+			unsigned long long	ullPulseId,
+			void			*	pPacket,
+			size_t				sPacket	) = 0;
+
+	// Send the packets of several sources for one fiducial in one call.
+	// The fiducial is checked once and every size before anything is sent,
+	// then all headers are built and the packets go to the network client
+	// as one multi-message send.
+    virtual int bldSendPackets(
+			epicsTimeStamp		*	pTsFiducial,
+			const BldPacketDesc	*	pPackets,
+			unsigned int			uPacketCount ) = 0;
+
+	// Zero-copy form of bldSendPacket(): bldAcquirePacket() leases payload
+	// space behind a BldPacketHeader in client-owned memory (a pinned
+	// transmit buffer in zero-copy mode), the driver packs its payload there
+	// and bldCommitPacket() stamps the header and sends it. bldReleasePacket()
+	// drops a lease unsent. NULL from bldAcquirePacket() means no buffer is
+	// free right now; bldSendPacket() still works.
+    virtual void* bldAcquirePacket( size_t sPacket ) = 0;
+    virtual int bldCommitPacket(
+			void			*	pPayload,
+			unsigned int		srcPhysicalId,
+			unsigned int		xtcDataType,
+			epicsTimeStamp	*	pTsFiducial,
+			size_t				sPacket	) = 0;
+    virtual void bldReleasePacket( void* pPayload ) = 0;
+
+    // Batch transmit: queue packets and send them with one syscall,
+    // see BldNetworkClientInterface::setBatchMode()
+    virtual int bldSetBatchMode( unsigned int uMaxBatch, unsigned int uDeadlineUs ) = 0;
+    virtual int bldFlush() = 0;
+
+    // Asynchronous send: hand packets to a sender thread through a ring of
+    // uRingDepth slots (0 disables), see BLD_ASYNC_* for iOverflowPolicy
+    virtual int bldSetAsyncMode( unsigned int uRingDepth, int iOverflowPolicy ) = 0;
+
+    // What a send does when the socket buffer is full, see BLD_BACKPRESSURE_*
+    // and BldNetworkClientInterface::setBackpressure()
+    virtual int bldSetBackpressure( int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg ) = 0;
+
+    // Monitor mode, used by the next bldStart(): PV updates are packed into a
+    // shadow payload as they arrive, bldSendData() reads no PVs
+    virtual int bldSetMonitorMode( int iEnable ) = 0;
+
+    // Container mode: bldSendPackets() packs its sources into Id_Xtc
+    // container datagrams from uPhysicalId (see BldContainerPacket), as
+    // many per datagram as fit. Receivers must understand containers.
+    virtual int bldSetContainerMode( int iEnable, unsigned int uPhysicalId ) = 0;
+
+    // Multi-pulse batching, used by the next bldStart(): bldSendData() packs
+    // the payloads of up to uMaxPulses fiducials into one datagram with a
+    // per-pulse index (see BldPulseIndex). It goes out when full, when the
+    // next pulse would not fit in an MTU, or uDeadlineUs (0 for none) after
+    // its first pulse. uMaxPulses 0 or 1 disables.
+    virtual int bldSetPulseBatch( unsigned int uMaxPulses, unsigned int uDeadlineUs ) = 0;
+
+    // Pulse-ID mode, used by the next bldStart(): the fiducial PV holds a
+    // 64-bit pulse ID (exact up to 2^53, it is read as a double) that
+    // bldPrepareData() reads and bldSendData() sends like bldSendPacketPulseId()
+    virtual int bldSetPulseIdMode( int iEnable ) = 0;
+
+    // BLD_NETWORK_* flags (see bldNetworkClient.h) used by the next bldStart()
+    virtual int bldSetNetworkFlags( unsigned int uFlags ) = 0;
+
+    // Transport used by the next bldStart(), "name" or "name:arg" (see
+    // BldNetworkClientFactory::createBldTransport()), default "udp"
+    virtual int bldSetTransport( const char* sTransport ) = 0;
+
+    // Send statistics: pClientStats times whole bldSendData()/bldSendPacket()
+    // calls, pNetworkStats the send syscalls below them. Either may be NULL.
+    // Returns 1 if there is no network client yet (pNetworkStats is zeroed).
+    virtual int bldGetStats( BldSendStats* pClientStats, BldSendStats* pNetworkStats ) = 0;
+    virtual void bldResetStats() = 0;
+    virtual void bldShowStats( int iReset ) = 0;
  
     // debug information control
     virtual void setDebugLevel(int iDebugLevel) = 0;
@@ -110,10 +207,19 @@ int BldConfigSend(	int					bldClientId,
 					unsigned short		uPort,
 					unsigned int		uMaxDataSize,
 					const char		*	sInterfaceIp	);
+/*
+ * sBldPvList names the payload PVs, separated by spaces, commas or
+ * semicolons. "NAME[N]" reads up to N elements of an array PV as doubles
+ * into N consecutive doubles of the payload, zero filled past its element
+ * count, and the PVs after it move along by N. A field table type takes
+ * the count from its field instead, N only lowers it.
+ */
 int BldConfig( int id, const char* sAddr, unsigned short uPort, unsigned int uMaxDataSize, const char* sInterfaceIp, 
                unsigned int uSrcPhysicalId, unsigned int uXtcDataType, const char* sBldPvPreTrigger,
                const char* sBldPvPostTrigger, const char* sBldPvFiducial, const char* sBldPvList );
 void BldShowConfig(int id);
+/* Checks the entries of sBldPvList and that its arrays fit, no PV is looked up */
+int BldCheckPvList(unsigned int uSrcPhysicalId, unsigned int uMaxDataSize, const char* sBldPvList);
 
 int BldSetPreSub(int id, const char* sBldSubRec); 
 int BldSetPostSub(int id, const char* sBldSubRec);
@@ -125,13 +231,53 @@ int BldSendPacket(	int					bldClientId,
 					epicsTimeStamp	*	pTsFiducial,
 					void			*	pPacket,
 					size_t				sPacket	);
+int BldSendPacketPulseId(	int					bldClientId,
+							unsigned int		srcPhysicalId,
+							unsigned int		xtcDataType,
+							epicsTimeStamp	*	pTsFiducial,
+							unsigned long long	ullPulseId,
+							void			*	pPacket,
+							size_t				sPacket	);
+int BldSendPackets(	int						bldClientId,
+					epicsTimeStamp		*	pTsFiducial,
+					const BldPacketDesc	*	pPackets,
+					unsigned int			uPacketCount );
+void* BldAcquirePacket(int id, size_t sPacket);
+int BldCommitPacket(	int					bldClientId,
+						void			*	pPayload,
+						unsigned int		srcPhysicalId,
+						unsigned int		xtcDataType,
+						epicsTimeStamp	*	pTsFiducial,
+						size_t				sPacket	);
+void BldReleasePacket(int id, void* pPayload);
+int BldSetBatchMode(int id, unsigned int uMaxBatch, unsigned int uDeadlineUs);
+int BldFlush(int id);
+int BldSetAsyncMode(int id, unsigned int uRingDepth, int iOverflowPolicy);
+int BldSetBackpressure(int id, int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg);
+int BldSetNetworkFlags(int id, unsigned int uFlags);
+int BldSetMonitorMode(int id, int iEnable);
+int BldSetContainerMode(int id, int iEnable, unsigned int uPhysicalId);
+int BldSetPulseBatch(int id, unsigned int uMaxPulses, unsigned int uDeadlineUs);
+int BldSetPulseIdMode(int id, int iEnable);
+int BldSetTransport(int id, const char* sTransport);
+void BldShowTransports(void);
+int BldGetStats(int id, BldSendStats* pClientStats, BldSendStats* pNetworkStats);
+void BldResetStats(int id);
+void BldShowStats(int id, int iReset);
 
 void BldSetDebugLevel(int id, int iDebugLevel); 
 int BldGetDebugLevel(int id); 
 
+#define BLD_MAX_CLIENTS		1024	/* client ids run from 0 to BLD_MAX_CLIENTS - 1 */
+
 #define	FIDUCIAL_NOT_SET	0x20000
 #define FIDUCIAL_MASK		0x1FFFF
 #define FIDUCIAL_INVALID	FIDUCIAL_MASK
+#define PULSE_ID_NOT_SET	0ULL	/* pulse IDs start at 1, 0 in a header means none */
+
+/* BldSetAsyncMode overflow policies: what to do when the send ring is full */
+#define BLD_ASYNC_DROP_NEWEST	0	/* drop the packet being sent */
+#define BLD_ASYNC_SEND_SYNC		1	/* send it from the caller's thread */
 
 }
 
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <epicsAtomic.h>
+
+#include "bldSendStats.h"
+
+/*
+ * Global C function definitions
+ */
+extern "C"
+{
+
+static void printLatency( char* sBuffer, size_t uSize, double dfNs )
+{
+    if ( dfNs < 1e3 )
+        snprintf( sBuffer, uSize, "%.0f ns", dfNs );
+    else if ( dfNs < 1e6 )
+        snprintf( sBuffer, uSize, "%.1f us", dfNs * 1e-3 );
+    else
+        snprintf( sBuffer, uSize, "%.1f ms", dfNs * 1e-6 );
+}
+
+void BldShowSendStats( const char* sTitle, const BldSendStats* pStats )
+{
+    if ( pStats == NULL )
+        return;
+
+    printf( "  %s: packets %zu bytes %zu calls %zu failures %zu\n", sTitle,
+      pStats->uPackets, pStats->uBytes, pStats->uCalls, pStats->uFailures );
+
+    for ( int iErrno = 0; iErrno < BLD_STATS_ERRNO_MAX; iErrno++ )
+    {
+        if ( pStats->uFailByErrno[iErrno] != 0 )
+            printf( "    errno %3d %-28s %zu\n", iErrno,
+              (iErrno == 0 ? "(not a socket error)" : strerror(iErrno)), pStats->uFailByErrno[iErrno] );
+    }
+    if ( pStats->uFailOther != 0 )
+        printf( "    errno >= %d %zu\n", BLD_STATS_ERRNO_MAX, pStats->uFailOther );
+
+    if ( pStats->uCalls == 0 )
+        return;
+
+    char sAvg[32], sMax[32];
+    printLatency( sAvg, sizeof(sAvg), (double) pStats->uLatencySumNs / pStats->uCalls );
+    printLatency( sMax, sizeof(sMax), (double) pStats->uLatencyMaxNs );
+    printf( "    latency avg %s max %s\n", sAvg, sMax );
+
+    for ( int iBucket = 0; iBucket < BLD_STATS_LATENCY_BUCKETS; iBucket++ )
+    {
+        if ( pStats->uLatencyHist[iBucket] == 0 )
+            continue;
+        char sLow[32], sHigh[32];
+        printLatency( sLow, sizeof(sLow), (double) (1ULL << iBucket) );
+        printLatency( sHigh, sizeof(sHigh), (double) (1ULL << (iBucket + 1)) );
+        printf( "    %10s - %-10s %zu (%.1f%%)\n", sLow,
+          (iBucket == BLD_STATS_LATENCY_BUCKETS - 1 ? "" : sHigh),
+          pStats->uLatencyHist[iBucket], 100.0 * pStats->uLatencyHist[iBucket] / pStats->uCalls );
+    }
+}
+
+} // extern "C"
+
+/**
+ * class member definitions
+ */
+namespace EpicsBld
+{
+/**
+ * class BldSendStatsCounter
+ */
+unsigned long long BldSendStatsCounter::nowNs()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void BldSendStatsCounter::recordSend( size_t uPackets, size_t uBytes )
+{
+    epicsAtomicAddSizeT( &_stats.uPackets, uPackets );
+    epicsAtomicAddSizeT( &_stats.uBytes, uBytes );
+}
+
+void BldSendStatsCounter::recordFailure( int iErrno, size_t uPackets )
+{
+    epicsAtomicAddSizeT( &_stats.uFailures, uPackets );
+    if ( iErrno >= 0 && iErrno < BLD_STATS_ERRNO_MAX )
+        epicsAtomicAddSizeT( &_stats.uFailByErrno[iErrno], uPackets );
+    else
+        epicsAtomicAddSizeT( &_stats.uFailOther, uPackets );
+}
+
+void BldSendStatsCounter::recordLatency( unsigned long long ullStartNs )
+{
+    unsigned long long ullNs = nowNs() - ullStartNs;
+
+    // floor(log2(ns)), with 0 ns in bucket 0
+    int iBucket = 0;
+    for ( unsigned long long ullRest = ullNs >> 1; ullRest != 0 && iBucket < BLD_STATS_LATENCY_BUCKETS - 1;
+      ullRest >>= 1 )
+        iBucket++;
+
+    epicsAtomicIncrSizeT( &_stats.uCalls );
+    epicsAtomicIncrSizeT( &_stats.uLatencyHist[iBucket] );
+    epicsAtomicAddSizeT( &_stats.uLatencySumNs, (size_t) ullNs );
+
+    size_t uMax = epicsAtomicGetSizeT( &_stats.uLatencyMaxNs );
+    while ( ullNs > uMax )
+    {
+        size_t uPrev = epicsAtomicCmpAndSwapSizeT( &_stats.uLatencyMaxNs, uMax, (size_t) ullNs );
+        if ( uPrev == uMax )
+            break;
+        uMax = uPrev;
+    }
+}
+
+void BldSendStatsCounter::snapshot( BldSendStats* pStats ) const
+{
+    if ( pStats == NULL )
+        return;
+
+    const size_t* puFrom = (const size_t*) &_stats;
+    size_t* puTo = (size_t*) pStats;
+    for ( size_t uField = 0; uField < sizeof(BldSendStats) / sizeof(size_t); uField++ )
+        puTo[uField] = epicsAtomicGetSizeT( &puFrom[uField] );
+}
+
+void BldSendStatsCounter::reset()
+{
+    size_t* puField = (size_t*) &_stats;
+    for ( size_t uField = 0; uField < sizeof(BldSendStats) / sizeof(size_t); uField++ )
+        epicsAtomicSetSizeT( &puField[uField], 0 );
+}
+
+} // namespace EpicsBld
@@ -0,0 +1,81 @@
+#ifndef BLD_SEND_STATS_H
+#define BLD_SEND_STATS_H
+
+#include <stddef.h>
+
+#define BLD_STATS_ERRNO_MAX         160 /* failures counted per errno below this, the rest in uFailOther */
+#define BLD_STATS_LATENCY_BUCKETS   32  /* bucket i: calls taking [2^i, 2^(i+1)) ns, the last one open ended */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Transmit statistics of one client
+ *
+ * Kept by both the network client (time spent in send syscalls) and the
+ * PV client (time spent in bldSendData()/bldSendPacket(), packing included).
+ * Counters are size_t, so on 32-bit targets uBytes and uLatencySumNs wrap;
+ * reset before measuring there. All fields are size_t, BldSendStatsCounter
+ * relies on that.
+ */
+typedef struct BldSendStats
+{
+    size_t  uPackets;                               /* packets sent successfully */
+    size_t  uBytes;                                 /* bytes in those packets */
+    size_t  uCalls;                                 /* timed calls (syscalls, or send requests for the PV client) */
+    size_t  uFailures;                              /* failed sends */
+    size_t  uFailByErrno[BLD_STATS_ERRNO_MAX];      /* failed sends by errno, [0] when there is none */
+    size_t  uFailOther;                             /* failed sends with errno >= BLD_STATS_ERRNO_MAX */
+    size_t  uLatencySumNs;
+    size_t  uLatencyMaxNs;
+    size_t  uLatencyHist[BLD_STATS_LATENCY_BUCKETS];
+} BldSendStats;
+
+/* Print a snapshot, sTitle names the client layer */
+void BldShowSendStats( const char* sTitle, const BldSendStats* pStats );
+
+#ifdef __cplusplus
+} // extern "C"
+
+namespace EpicsBld
+{
+/**
+ * Lock-free BldSendStats accumulator
+ *
+ * Every update is an independent atomic add, so any number of threads may
+ * record while another one takes a snapshot. A snapshot is not a consistent
+ * cut across fields, but each field is exact.
+ *
+ * Design Issue:
+ * 1. The value semantics are disabled.
+ */
+class BldSendStatsCounter
+{
+public:
+    BldSendStatsCounter() { reset(); }
+
+    /// Monotonic time stamp for latency measurements
+    static unsigned long long nowNs();
+
+    void recordSend( size_t uPackets, size_t uBytes );
+    void recordFailure( int iErrno, size_t uPackets = 1 );
+    void recordLatency( unsigned long long ullStartNs );
+
+    void snapshot( BldSendStats* pStats ) const;
+    void reset();
+
+private:
+    BldSendStats _stats;
+
+    ///  Disable value semantics. No definitions (function bodies).
+    BldSendStatsCounter(const BldSendStatsCounter&);
+    BldSendStatsCounter& operator=(const BldSendStatsCounter&);
+};
+
+} // namespace EpicsBld
+
+#endif
+
+#endif
@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+
+#include <epicsMutex.h>
+#include <epicsThread.h>
+
+#include "bldNetworkClient.h"
+#include "bldTransport.h"
+#include "bldPacket.h"
+
+using std::string;
+
+/*
+ * Transport registry
+ */
+namespace
+{
+struct BldTransportEntry
+{
+    string                                          sName;
+    EpicsBld::BldNetworkClientFactory::TransportCreator pfCreate;
+    string                                          sDescription;
+};
+
+std::vector<BldTransportEntry>* pvTransports = NULL;
+epicsMutexId                    transportLock = NULL;
+epicsThreadOnceId               transportOnce = EPICS_THREAD_ONCE_INIT;
+
+EpicsBld::BldNetworkClientInterface* createUdpTransport( unsigned int uAddr, unsigned short uPort,
+  unsigned int uMaxDataSize, unsigned char ucTTL, unsigned int uInterfaceIp, unsigned int uFlags,
+  const char* sArg )
+{
+    return EpicsBld::BldNetworkClientFactory::createBldNetworkClient( uAddr, uPort, uMaxDataSize,
+      ucTTL, uInterfaceIp, uFlags );
+}
+
+EpicsBld::BldNetworkClientInterface* createNullTransport( unsigned int uAddr, unsigned short uPort,
+  unsigned int uMaxDataSize, unsigned char ucTTL, unsigned int uInterfaceIp, unsigned int uFlags,
+  const char* sArg )
+{
+    return new EpicsBld::BldTransportNull( uMaxDataSize );
+}
+
+EpicsBld::BldNetworkClientInterface* createMemoryTransport( unsigned int uAddr, unsigned short uPort,
+  unsigned int uMaxDataSize, unsigned char ucTTL, unsigned int uInterfaceIp, unsigned int uFlags,
+  const char* sArg )
+{
+    unsigned int uDepth = ( sArg != NULL && sArg[0] != 0 ? strtoul( sArg, NULL, 0 ) : 0 );
+    return new EpicsBld::BldTransportMemory( uMaxDataSize, (uDepth != 0 ? uDepth : 1024) );
+}
+
+EpicsBld::BldNetworkClientInterface* createFileTransport( unsigned int uAddr, unsigned short uPort,
+  unsigned int uMaxDataSize, unsigned char ucTTL, unsigned int uInterfaceIp, unsigned int uFlags,
+  const char* sArg )
+{
+    if ( sArg == NULL || sArg[0] == 0 )
+    {
+        printf( "[Error] file transport needs a path, e.g. \"file:/tmp/bld.dat\"\n" );
+        return NULL;
+    }
+    EpicsBld::BldTransportFile* pTransport = new EpicsBld::BldTransportFile( uMaxDataSize, sArg );
+    if ( !pTransport->isOpen() )
+    {
+        delete pTransport;
+        return NULL;
+    }
+    return pTransport;
+}
+
+/// Add or replace a registry entry. Caller must hold transportLock, or be transportInit()
+void addTransport( const char* sName, EpicsBld::BldNetworkClientFactory::TransportCreator pfCreate,
+  const char* sDescription )
+{
+    std::vector<BldTransportEntry>::iterator it = pvTransports->begin();
+    for ( ; it != pvTransports->end() && it->sName != sName; it++ )
+        ;
+    if ( it == pvTransports->end() )
+        it = pvTransports->insert( it, BldTransportEntry() );
+    it->sName        = sName;
+    it->pfCreate     = pfCreate;
+    it->sDescription = ( sDescription != NULL ? sDescription : "" );
+}
+
+void transportInit( void* )
+{
+    transportLock = epicsMutexMustCreate();
+    pvTransports  = new std::vector<BldTransportEntry>;
+
+    addTransport( "udp", createUdpTransport,
+      "UDP multicast to the configured address (default)" );
+    addTransport( "null", createNullTransport,
+      "count and discard packets" );
+    addTransport( "memory", createMemoryTransport,
+      "keep the last N packets in memory, memory:<N> (default 1024)" );
+    addTransport( "file", createFileTransport,
+      "append length-prefixed packets to a file, file:<path>" );
+}
+
+} // namespace
+
+/**
+ * class member definitions
+ */
+namespace EpicsBld
+{
+/**
+ * class BldNetworkClientFactory: transport registry
+ */
+int BldNetworkClientFactory::registerTransport(const char* sName, TransportCreator pfCreate,
+  const char* sDescription)
+{
+    if ( sName == NULL || sName[0] == 0 || pfCreate == NULL )
+        return 1;
+
+    epicsThreadOnce( &transportOnce, transportInit, NULL );
+
+    epicsMutexMustLock( transportLock );
+    addTransport( sName, pfCreate, sDescription );
+    epicsMutexUnlock( transportLock );
+    return 0;
+}
+
+BldNetworkClientInterface* BldNetworkClientFactory::createBldTransport(const char* sTransport,
+  unsigned int uAddr, unsigned short uPort, unsigned int uMaxDataSize, unsigned char ucTTL,
+  const char* sInterfaceIp, unsigned int uFlags)
+{
+    epicsThreadOnce( &transportOnce, transportInit, NULL );
+
+    // "<name>[:<arg>]", an empty name means udp
+    string sName( sTransport != NULL && sTransport[0] != 0 ? sTransport : "udp" );
+    string sArg;
+    size_t uColon = sName.find( ':' );
+    if ( uColon != string::npos )
+    {
+        sArg = sName.substr( uColon + 1 );
+        sName.erase( uColon );
+    }
+
+    TransportCreator pfCreate = NULL;
+    epicsMutexMustLock( transportLock );
+    for ( std::vector<BldTransportEntry>::const_iterator it = pvTransports->begin();
+      it != pvTransports->end(); it++ )
+    {
+        if ( it->sName == sName )
+            pfCreate = it->pfCreate;
+    }
+    epicsMutexUnlock( transportLock );
+
+    if ( pfCreate == NULL )
+    {
+        printf( "[Error] BldNetworkClientFactory::createBldTransport() : unknown transport \"%s\"\n",
+          sName.c_str() );
+        return NULL;
+    }
+
+    unsigned int uInterfaceIp = (
+      (sInterfaceIp == NULL || sInterfaceIp[0] == 0)?
+      0 : ntohl(inet_addr(sInterfaceIp)) );
+    return (*pfCreate)( uAddr, uPort, uMaxDataSize, ucTTL, uInterfaceIp, uFlags, sArg.c_str() );
+}
+
+void BldNetworkClientFactory::showTransports()
+{
+    epicsThreadOnce( &transportOnce, transportInit, NULL );
+
+    epicsMutexMustLock( transportLock );
+    for ( std::vector<BldTransportEntry>::const_iterator it = pvTransports->begin();
+      it != pvTransports->end(); it++ )
+        printf( "  %-10s %s\n", it->sName.c_str(), it->sDescription.c_str() );
+    epicsMutexUnlock( transportLock );
+}
+
+/**
+ * class BldTransportBase
+ */
+BldTransportBase::BldTransportBase(unsigned int uMaxDataSize) :
+  _uMaxDataSize(uMaxDataSize), _iDebugLevel(0), _lock(epicsMutexMustCreate())
+{
+    memset( &_stats, 0, sizeof(_stats) );
+}
+
+BldTransportBase::~BldTransportBase()
+{
+    epicsMutexDestroy( _lock );
+}
+
+int BldTransportBase::sendRawData(int iSizeData, const char* pData)
+{
+    struct iovec iov;
+    iov.iov_base = (caddr_t)(pData);
+    iov.iov_len  = iSizeData;
+    return sendRawDataV( &iov, 1 );
+}
+
+int BldTransportBase::sendRawDataV(const struct iovec* pIov, int iIovCount)
+{
+    size_t uSizeData = 0;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+        uSizeData += pIov[iIov].iov_len;
+
+    unsigned long long ullStartNs = BldSendStatsCounter::nowNs();
+    epicsMutexMustLock( _lock );
+    int iRetErrorCode = ( uSizeData <= _uMaxDataSize ? _write( pIov, iIovCount, uSizeData ) : EMSGSIZE );
+    _stats.uSendCalls++;
+    if ( iRetErrorCode == 0 )
+        _stats.uPktsSent++;
+    else
+        _stats.uPktsDropped++;
+    epicsMutexUnlock( _lock );
+
+    _sendStats.recordLatency( ullStartNs );
+    if ( iRetErrorCode == 0 )
+        _sendStats.recordSend( 1, uSizeData );
+    else
+        _sendStats.recordFailure( iRetErrorCode );
+    return iRetErrorCode;
+}
+
+int BldTransportBase::setBatchMode(unsigned int uMaxBatch, unsigned int uDeadlineUs)
+{
+    return 0;
+}
+
+int BldTransportBase::flush()
+{
+    epicsMutexMustLock( _lock );
+    int iRetErrorCode = _flush();
+    epicsMutexUnlock( _lock );
+    return iRetErrorCode;
+}
+
+int BldTransportBase::sendBurst(const char* pData, int iSegmentSize, int iSegmentCount)
+{
+    int iRetErrorCode = 0;
+    for ( int iSegment = 0; iSegment < iSegmentCount; iSegment++ )
+    {
+        if ( sendRawData( iSegmentSize, pData + iSegment * iSegmentSize ) != 0 )
+            iRetErrorCode = 1;
+    }
+
+    epicsMutexMustLock( _lock );
+    _stats.uBursts++;
+    _stats.uBurstPkts += iSegmentCount;
+    epicsMutexUnlock( _lock );
+    return iRetErrorCode;
+}
+
+int BldTransportBase::sendRawDataVBatch(const struct iovec* pIov, int iIovPerPacket, int iPacketCount)
+{
+    int iRetErrorCode = 0;
+    for ( int iPacket = 0; iPacket < iPacketCount; iPacket++ )
+    {
+        if ( sendRawDataV( pIov + iPacket * iIovPerPacket, iIovPerPacket ) != 0 )
+            iRetErrorCode = 1;
+    }
+    return iRetErrorCode;
+}
+
+void BldTransportBase::getBatchStats(BldBatchStats* pStats)
+{
+    if ( pStats == NULL )
+        return;
+    epicsMutexMustLock( _lock );
+    *pStats = _stats;
+    epicsMutexUnlock( _lock );
+}
+
+void BldTransportBase::resetBatchStats()
+{
+    epicsMutexMustLock( _lock );
+    memset( &_stats, 0, sizeof(_stats) );
+    epicsMutexUnlock( _lock );
+}
+
+void BldTransportBase::getBackpressureStats(BldBackpressureStats* pStats)
+{
+    if ( pStats != NULL )
+        memset( pStats, 0, sizeof(*pStats) );
+}
+
+/**
+ * class BldTransportMemory
+ */
+BldTransportMemory::BldTransportMemory(unsigned int uMaxDataSize, unsigned int uDepth) :
+  BldTransportBase(uMaxDataSize), _uDepth(uDepth), _uHead(0), _uCount(0)
+{
+    _pSlots    = new char[_uDepth * _uMaxDataSize];
+    _piSlotLen = new int[_uDepth];
+}
+
+BldTransportMemory::~BldTransportMemory()
+{
+    delete [] _pSlots;
+    delete [] _piSlotLen;
+}
+
+int BldTransportMemory::readPacket(char* pBuffer, int iBufferSize)
+{
+    epicsMutexMustLock( _lock );
+    int iSizeData = 0;
+    if ( _uCount != 0 )
+    {
+        iSizeData = _piSlotLen[_uHead];
+        if ( iSizeData > iBufferSize )
+            iSizeData = -1;
+        else
+        {
+            memcpy( pBuffer, _pSlots + _uHead * _uMaxDataSize, iSizeData );
+            _uHead = (_uHead + 1) % _uDepth;
+            _uCount--;
+        }
+    }
+    epicsMutexUnlock( _lock );
+    return iSizeData;
+}
+
+unsigned int BldTransportMemory::getPacketCount()
+{
+    epicsMutexMustLock( _lock );
+    unsigned int uCount = _uCount;
+    epicsMutexUnlock( _lock );
+    return uCount;
+}
+
+int BldTransportMemory::_write(const struct iovec* pIov, int iIovCount, size_t uSizeData)
+{
+    if ( _uCount == _uDepth )
+    {
+        // Full: the oldest packet makes room
+        _uHead = (_uHead + 1) % _uDepth;
+        _uCount--;
+        _stats.uPktsDropped++;
+    }
+
+    unsigned int uSlot = (_uHead + _uCount) % _uDepth;
+    char* pSlot = _pSlots + uSlot * _uMaxDataSize;
+    for ( int iIov = 0; iIov < iIovCount; iIov++ )
+    {
+        memcpy( pSlot, pIov[iIov].iov_base, pIov[iIov].iov_len );
+        pSlot += pIov[iIov].iov_len;
+    }
+    _piSlotLen[uSlot] = uSizeData;
+    _uCount++;
+    return 0;
+}
+
+/**
+ * class BldTransportFile
+ */
+BldTransportFile::BldTransportFile(unsigned int uMaxDataSize, const char* sPath) :
+  BldTransportBase(uMaxDataSize), _pFile(NULL), _sPath(sPath)
+{
+    _pFile = fopen( sPath, "ab" );
+    if ( _pFile == NULL )
+        printf( "[Error] BldTransportFile::BldTransportFile() : fopen(%s) failed, errno = %d (%s)\n",
+          sPath, errno, strerror(errno) );
+}
+
+BldTransportFile::~BldTransportFile()
+{
+    if ( _pFile != NULL )
+        fclose( _pFile );
+}
+
+int BldTransportFile::_write(const struct iovec* pIov, int iIovCount, size_t uSizeData)
+{
+    if ( _pFile == NULL )
+        return EBADF;
+
+    uint32_t uRecordLen = BldPacketHeader::setu32LE( (uint32_t) uSizeData );
+    int iFail = ( fwrite( &uRecordLen, sizeof(uRecordLen), 1, _pFile ) != 1 );
+    for ( int iIov = 0; iIov < iIovCount && !iFail; iIov++ )
+        iFail = ( pIov[iIov].iov_len != 0 && fwrite( pIov[iIov].iov_base, pIov[iIov].iov_len, 1, _pFile ) != 1 );
+
+    if ( !iFail )
+        return 0;
+    if ( _iDebugLevel >= 1 )
+        printf( "[Error] BldTransportFile : write to %s failed, errno = %d (%s)\n",
+          _sPath.c_str(), errno, strerror(errno) );
+    return ( errno != 0 ? errno : EIO );
+}
+
+int BldTransportFile::_flush()
+{
+    return ( _pFile != NULL && fflush( _pFile ) != 0 );
+}
+
+} // namespace EpicsBld
@@ -0,0 +1,145 @@
+#ifndef BLD_TRANSPORT_H
+#define BLD_TRANSPORT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string>
+
+#include <epicsMutex.h>
+
+#include "bldNetworkClient.h"
+
+namespace EpicsBld
+{
+/**
+ * Common base of the non-network transports
+ *
+ * Implements BldNetworkClientInterface on top of a single _write() of one
+ * datagram, so a transport only has to say where the bytes go. Packet counts
+ * are kept in the BldBatchStats fields (uPktsSent, uPktsDropped).
+ *
+ * Design Issue:
+ * 1. Batch mode and backpressure settings are accepted and ignored, every
+ *    packet is written as it arrives. Zero-copy buffers are never available.
+ * 2. The value semantics are disabled.
+ */
+class BldTransportBase : public BldNetworkClientInterface
+{
+public:
+    virtual ~BldTransportBase();
+
+    virtual int sendRawData(int iSizeData, const char* pData);
+    virtual int sendRawDataV(const struct iovec* pIov, int iIovCount);
+
+    virtual int setBatchMode(unsigned int uMaxBatch, unsigned int uDeadlineUs);
+    virtual int flush();
+    virtual int sendBurst(const char* pData, int iSegmentSize, int iSegmentCount);
+    virtual int sendRawDataVBatch(const struct iovec* pIov, int iIovPerPacket, int iPacketCount);
+    virtual void getBatchStats(BldBatchStats* pStats);
+    virtual void resetBatchStats();
+
+    virtual int setBackpressure(int iPolicy, unsigned int uSndBufPackets, unsigned int uPolicyArg) { return 0; }
+    virtual void getBackpressureStats(BldBackpressureStats* pStats);
+    virtual void resetBackpressureStats() {}
+
+    virtual char* acquireTxBuffer(unsigned int uSize) { return NULL; }
+    virtual int sendTxBuffer(char* pBuffer, int iSizeData) { return 1; }
+    virtual void releaseTxBuffer(char* pBuffer) {}
+    virtual int getZeroCopyStats(BldZeroCopyStats* pStats) { return 1; }
+
+    virtual void getSendStats(BldSendStats* pStats) { _sendStats.snapshot( pStats ); }
+    virtual void resetSendStats() { _sendStats.reset(); }
+
+    // debug information control
+    virtual void setDebugLevel(int iDebugLevel) { _iDebugLevel = iDebugLevel; }
+    virtual int getDebugLevel() { return _iDebugLevel; }
+
+protected:
+    BldTransportBase(unsigned int uMaxDataSize);
+
+    /// Deliver one datagram of uSizeData bytes, return 0 or an errno value. Called with _lock held.
+    virtual int _write(const struct iovec* pIov, int iIovCount, size_t uSizeData) = 0;
+    /// Push out anything buffered. Called with _lock held.
+    virtual int _flush() { return 0; }
+
+    unsigned int    _uMaxDataSize;
+    int             _iDebugLevel;
+    epicsMutexId    _lock;
+    BldBatchStats   _stats;
+    BldSendStatsCounter _sendStats;
+private:
+    ///  Disable value semantics. No definitions (function bodies).
+    BldTransportBase(const BldTransportBase&);
+    BldTransportBase& operator=(const BldTransportBase&);
+};
+
+/**
+ * Null transport: counts packets and discards them
+ *
+ * Measures the cost of building packets with no network below.
+ */
+class BldTransportNull : public BldTransportBase
+{
+public:
+    BldTransportNull(unsigned int uMaxDataSize) : BldTransportBase(uMaxDataSize) {}
+
+protected:
+    virtual int _write(const struct iovec* pIov, int iIovCount, size_t uSizeData) { return 0; }
+};
+
+/**
+ * Memory transport: keeps the most recent packets in a ring for inspection
+ *
+ * When the ring is full the oldest packet is overwritten and counted in uPktsDropped.
+ */
+class BldTransportMemory : public BldTransportBase
+{
+public:
+    BldTransportMemory(unsigned int uMaxDataSize, unsigned int uDepth);
+    virtual ~BldTransportMemory();
+
+    /**
+     * Remove the oldest packet from the ring
+     *
+     * @return  the packet size, 0 if the ring is empty, -1 if iBufferSize is too small
+     */
+    int readPacket(char* pBuffer, int iBufferSize);
+    unsigned int getPacketCount();
+
+protected:
+    virtual int _write(const struct iovec* pIov, int iIovCount, size_t uSizeData);
+
+private:
+    unsigned int    _uDepth;
+    unsigned int    _uHead;     /// slot of the oldest packet
+    unsigned int    _uCount;
+    char*           _pSlots;    /// _uDepth slots of _uMaxDataSize bytes
+    int*            _piSlotLen;
+};
+
+/**
+ * File transport: appends packets to a file
+ *
+ * Each record is a 32-bit little-endian length followed by the packet bytes,
+ * so a capture can be replayed or decoded offline.
+ */
+class BldTransportFile : public BldTransportBase
+{
+public:
+    BldTransportFile(unsigned int uMaxDataSize, const char* sPath);
+    virtual ~BldTransportFile();
+
+    bool isOpen() const { return _pFile != NULL; }
+
+protected:
+    virtual int _write(const struct iovec* pIov, int iIovCount, size_t uSizeData);
+    virtual int _flush();
+
+private:
+    FILE*           _pFile;
+    std::string     _sPath;
+};
+
+} // namespace EpicsBld
+
+#endif